@@ -24,7 +24,9 @@
 #include "backgroundparser.h"
 
 #include "qtcompat_p.h"
+#include <QCache>
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QList>
 #include <QMutex>
 #include <QMutexLocker>
@@ -51,6 +53,7 @@
 #include <debug.h>
 
 #include "parsejob.h"
+#include <duchain/includegraph.h>
 
 using namespace KDevelop;
 
@@ -58,6 +61,12 @@ namespace {
 
 const bool separateThreadForHighPriority = true;
 
+///How long the UI thread may spend creating parse-jobs in one go, in milliseconds
+const int maxParseJobCreationTime = 10;
+///How many documents the imports are remembered for, to order the parse-jobs. Those of the least recently
+///parsed or queued documents are forgotten first.
+const int maxKnownImports = 50000;
+
 /**
  * Elides string in @p path, e.g. "VEEERY/LONG/PATH" -> ".../LONG/PATH"
  * - probably much faster than QFontMetrics::elidedText()
@@ -186,7 +195,8 @@ class KDevelop::BackgroundParserPrivate
 {
 public:
     BackgroundParserPrivate(BackgroundParser *parser, ILanguageController *languageController)
-        :m_parser(parser), m_languageController(languageController), m_shuttingDown(false), m_mutex(QMutex::Recursive)
+        :m_parser(parser), m_languageController(languageController), m_shuttingDown(false)
+        , m_knownImports(maxKnownImports), m_mutex(QMutex::Recursive)
     {
         parser->d = this; //Set this so we can safely call back BackgroundParser from within loadSettings()
 
@@ -242,6 +252,9 @@ public:
                 break; //The additional parsing thread is reserved for higher priority parsing
             }
 
+            // A document that imports another queued or running document is only picked when there is
+            // nothing else with this priority, so that dependencies are parsed before their importers.
+            IndexedString deferredUrl;
             for (const auto& url : it1.value()) {
                 // When a document is scheduled for parsing while it is being parsed, it will be parsed
                 // again once the job finished, but not now.
@@ -259,14 +272,36 @@ public:
                     continue;
                 }
 
+                if (hasPendingImports(url)) {
+                    if (deferredUrl.isEmpty()) {
+                        deferredUrl = url;
+                    }
+                    continue;
+                }
+
                 return url;
             }
+
+            if (!deferredUrl.isEmpty()) {
+                return deferredUrl;
+            }
         }
         return {};
     }
 
+    bool hasPendingImports(const IndexedString& url) const
+    {
+        const auto imports = m_knownImports.object(url);
+        if (!imports) {
+            return false;
+        }
+        return std::any_of(imports->constBegin(), imports->constEnd(), [this] (const IndexedString& import) {
+            return m_documents.contains(import) || m_parseJobs.contains(import);
+        });
+    }
+
     /**
-     * Create a single delayed parse job
+     * Create delayed parse jobs until all parse threads are busy
      *
      * E.g. jobs for documents which have been changed by the user, but also to
      * handle initial startup where we parse all project files.
@@ -276,11 +311,43 @@ public:
         if(m_shuttingDown)
             return;
 
+        // Creating parse-jobs happens in the UI thread, and may iterate through many files
+        // without finding a language-support, so continue later when it takes too long.
+        QElapsedTimer timer;
+        timer.start();
+        while (createNextParseJob()) {
+            if (timer.hasExpired(maxParseJobCreationTime)) {
+                if (!m_documents.isEmpty()) {
+                    QMetaObject::invokeMethod(m_parser, "parseDocuments", Qt::QueuedConnection);
+                }
+                break;
+            }
+        }
+
+        if (m_documents.isEmpty()) {
+            // make sure we cleaned up properly
+            // TODO: also empty m_documentsForPriority when m_documents is empty? or do we want to keep capacity?
+            Q_ASSERT(std::none_of(m_documentsForPriority.constBegin(), m_documentsForPriority.constEnd(),
+                                    [] (const QSet<IndexedString>& docs) {
+                                    return !docs.isEmpty();
+                                    }));
+        }
+
+        m_parser->updateProgressData();
+    }
+
+    /**
+     * Create a single parse job for the next document to parse
+     *
+     * @return whether a document was taken from the queue
+     */
+    bool createNextParseJob()
+    {
         //Only create parse-jobs for up to thread-count * 2 documents, so we don't fill the memory unnecessarily
         if (m_parseJobs.count() >= m_threads+1
             || (m_parseJobs.count() >= m_threads && !separateThreadForHighPriority))
         {
-            return;
+            return false;
         }
 
         const auto& url = nextDocumentToParse();
@@ -329,22 +396,9 @@ public:
             } else {
                 --m_maxParseJobs;
             }
-
-            if (!m_documents.isEmpty()) {
-                // Only try creating one parse-job at a time, else we might iterate through thousands of files
-                // without finding a language-support, and block the UI for a long time.
-                QMetaObject::invokeMethod(m_parser, "parseDocuments", Qt::QueuedConnection);
-            } else {
-                // make sure we cleaned up properly
-                // TODO: also empty m_documentsForPriority when m_documents is empty? or do we want to keep capacity?
-                Q_ASSERT(std::none_of(m_documentsForPriority.constBegin(), m_documentsForPriority.constEnd(),
-                                        [] (const QSet<IndexedString>& docs) {
-                                        return !docs.isEmpty();
-                                        }));
-            }
+            return true;
         }
-
-        m_parser->updateProgressData();
+        return false;
     }
 
     // NOTE: you must not access any of the data structures that are protected by any of the
@@ -485,6 +539,8 @@ config.readEntry(entry, oldConfig.readEntry(entry, default))
     QMap<int, QSet<IndexedString> > m_documentsForPriority;
     // Currently running parse jobs
     QHash<IndexedString, ThreadWeaver::QObjectDecorator*> m_parseJobs;
+    // The documents imported by each parsed document, as of its last parse
+    QCache<IndexedString, QVector<IndexedString>> m_knownImports;
     // The url for each managed document. Those may temporarily differ from the real url.
     QHash<KTextEditor::Document*, IndexedString> m_managedTextDocumentUrls;
     // Projects currently in progress of loading
@@ -517,6 +573,7 @@ BackgroundParser::BackgroundParser(ILanguageController *languageController)
     connect(ICore::self()->documentController(), &IDocumentController::documentLoaded, this, &BackgroundParser::documentLoaded);
     connect(ICore::self()->documentController(), &IDocumentController::documentUrlChanged, this, &BackgroundParser::documentUrlChanged);
     connect(ICore::self()->documentController(), &IDocumentController::documentClosed, this, &BackgroundParser::documentClosed);
+    connect(ICore::self()->documentController(), &IDocumentController::documentSaved, this, &BackgroundParser::documentSaved);
     connect(ICore::self(), &ICore::aboutToShutdown, this, &BackgroundParser::aboutToQuit);
 
     QObject::connect(ICore::self()->projectController(),
@@ -635,6 +692,7 @@ void BackgroundParser::removeDocument(const IndexedString& url, QObject* notifyW
 
         if(d->m_documents[url].targets.isEmpty()) {
             d->m_documents.remove(url);
+            d->m_knownImports.remove(url);
             --d->m_maxParseJobs;
         }else{
             //Insert with an eventually different priority
@@ -662,10 +720,19 @@ void BackgroundParser::parseComplete(const ThreadWeaver::JobPointer& job)
     Q_ASSERT(parseJob);
     emit parseJobFinished(parseJob);
 
+    // Remember the imports, so the next time the importers are queued together with their imports,
+    // the imports are parsed first.
+    const QVector<IndexedString> imports = parseJob->imports();
+
     {
         QMutexLocker lock(&d->m_mutex);
 
         d->m_parseJobs.remove(parseJob->document());
+        if (imports.isEmpty()) {
+            d->m_knownImports.remove(parseJob->document());
+        } else {
+            d->m_knownImports.insert(parseJob->document(), new QVector<IndexedString>(imports));
+        }
 
         d->m_jobProgress.remove(parseJob);
 
@@ -913,6 +980,33 @@ void BackgroundParser::documentUrlChanged(IDocument* document)
         documentLoaded(document);
 }
 
+void BackgroundParser::documentSaved(IDocument* document)
+{
+    const IndexedString url(document->url());
+    const QVector<IndexedString> includers = IncludeGraph::self().transitiveIncluders(url);
+    if (includers.isEmpty()) {
+        return;
+    }
+
+    QVector<IndexedString> openIncluders;
+    {
+        QMutexLocker l(&d->m_managedMutex);
+        for (const IndexedString& includer : includers) {
+            if (d->m_managed.contains(includer)) {
+                openIncluders.append(includer);
+            }
+        }
+    }
+    if (openIncluders.isEmpty()) {
+        return;
+    }
+
+    qCDebug(LANGUAGE) << "reparsing" << openIncluders.size() << "open documents that include" << url.str();
+    for (const IndexedString& includer : qAsConst(openIncluders)) {
+        addDocument(includer, TopDUContext::AllDeclarationsContextsAndUses);
+    }
+}
+
 void BackgroundParser::startTimer(int delay) {
     if (!d->isSuspended()) {
         d->m_timer.start(delay);
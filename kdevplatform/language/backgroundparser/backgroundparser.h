@@ -220,6 +220,8 @@ public Q_SLOTS:
     void documentClosed(KDevelop::IDocument*);
     void documentLoaded(KDevelop::IDocument*);
     void documentUrlChanged(KDevelop::IDocument*);
+    /// Queues the open documents that include @p document directly or indirectly, see IncludeGraph
+    void documentSaved(KDevelop::IDocument* document);
 
     void loadSettings();
 
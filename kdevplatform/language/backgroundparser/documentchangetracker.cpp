@@ -119,6 +119,7 @@ void DocumentChangeTracker::reset()
 
     // We don't reset the insertion here, as it may continue
     m_needUpdate = false;
+    m_changedLines = KTextEditor::Range::invalid();
 
     m_revisionAtLastReset = acquireRevision(m_moving->revision());
     Q_ASSERT(m_revisionAtLastReset);
@@ -145,6 +146,36 @@ bool DocumentChangeTracker::needUpdate() const
     return m_needUpdate;
 }
 
+KTextEditor::Range DocumentChangeTracker::changedLinesSinceReset() const
+{
+    VERIFY_FOREGROUND_LOCKED
+
+    return m_changedLines;
+}
+
+void DocumentChangeTracker::updateChangedLines(int line, int removedLines, int insertedLines)
+{
+    // The lines [line, line + removedLines] were replaced by [line, line + insertedLines]
+    const int firstLine = line;
+    const int lastLine = line + insertedLines;
+
+    if (!m_changedLines.isValid()) {
+        m_changedLines = {firstLine, 0, lastLine, 0};
+        return;
+    }
+
+    auto moveLine = [&](int changedLine, int lineInChange) {
+        if (changedLine < line) {
+            return changedLine;
+        } else if (changedLine > line + removedLines) {
+            return changedLine + insertedLines - removedLines;
+        }
+        return lineInChange;
+    };
+    m_changedLines = {qMin(moveLine(m_changedLines.start().line(), firstLine), firstLine), 0,
+                      qMax(moveLine(m_changedLines.end().line(), lastLine), lastLine), 0};
+}
+
 void DocumentChangeTracker::updateChangedRange(int delay)
 {
 //     Q_ASSERT(m_moving->revision() != m_revisionAtLastReset->revision()); // May happen after reload
@@ -201,6 +232,8 @@ void DocumentChangeTracker::textInserted(Document* document, const Cursor& curso
         m_lastInsertionPosition = range.end();
     }
 
+    updateChangedLines(range.start().line(), 0, range.end().line() - range.start().line());
+
     auto delay = recommendedDelay(document, range, text, false);
     m_needUpdate = delay != ILanguageSupport::NoUpdateRequired;
     updateChangedRange(delay);
@@ -211,6 +244,8 @@ void DocumentChangeTracker::textRemoved( Document* document, const KTextEditor::
     m_currentCleanedInsertion.clear();
     m_lastInsertionPosition = KTextEditor::Cursor::invalid();
 
+    updateChangedLines(oldRange.start().line(), oldRange.end().line() - oldRange.start().line(), 0);
+
     auto delay = recommendedDelay(document, oldRange, oldText, true);
     m_needUpdate = delay != ILanguageSupport::NoUpdateRequired;
     updateChangedRange(delay);
@@ -249,6 +284,7 @@ void DocumentChangeTracker::aboutToInvalidateMovingInterfaceContent ( Document*
     qCDebug(LANGUAGE) << "clearing all revisions";
     m_revisionLocks.clear();
     m_revisionAtLastReset = RevisionReference();
+    m_changedLines = KTextEditor::Range::invalid();
     ModificationRevision::setEditorRevisionForFile(m_url, 0);
 }
 
@@ -161,6 +161,13 @@ public:
      * */
     virtual bool needUpdate() const;
 
+    /**
+     * Returns the lines that were changed since the last reset, in the current revision of the document.
+     *
+     * Only the lines of the returned range are meaningful. An invalid range is returned if nothing was changed.
+     * */
+    KTextEditor::Range changedLinesSinceReset() const;
+
     /**
      * Returns the tracked document
      **/
@@ -214,12 +221,14 @@ protected:
     QString m_currentCleanedInsertion;
     KTextEditor::Cursor m_lastInsertionPosition;
     KTextEditor::MovingRange* m_changedRange;
+    KTextEditor::Range m_changedLines;
 
     KTextEditor::Document* m_document;
     KTextEditor::MovingInterface* m_moving;
     KDevelop::IndexedString m_url;
 
     void updateChangedRange(int delay);
+    void updateChangedLines(int line, int removedLines, int insertedLines);
     int recommendedDelay(KTextEditor::Document* doc, const KTextEditor::Range& range, const QString& text, bool removal);
 public Q_SLOTS:
     void textInserted(KTextEditor::Document* document, const KTextEditor::Cursor& position, const QString& inserted);
@@ -80,6 +80,7 @@ public:
     }
 
     ReferencedTopDUContext duContext;
+    QVector<IndexedString> imports;
 
     IndexedString url;
     ILanguageSupport* languageSupport;
@@ -187,6 +188,19 @@ TopDUContext::Features ParseJob::minimumFeatures() const
 void ParseJob::setDuChain(const ReferencedTopDUContext& duChain)
 {
     d->duContext = duChain;
+
+    // Collected here in the parse thread, so the background parser can order its jobs without locking the duchain
+    d->imports.clear();
+    if (duChain) {
+        DUChainReadLocker lock;
+        if (duChain->parsingEnvironmentFile()) {
+            const auto importedFiles = duChain->parsingEnvironmentFile()->imports();
+            d->imports.reserve(importedFiles.size());
+            for (const auto& file : importedFiles) {
+                d->imports << file->url();
+            }
+        }
+    }
 }
 
 ReferencedTopDUContext ParseJob::duChain() const
@@ -194,6 +208,11 @@ ReferencedTopDUContext ParseJob::duChain() const
     return d->duContext;
 }
 
+QVector<IndexedString> ParseJob::imports() const
+{
+    return d->imports;
+}
+
 bool ParseJob::abortRequested() const
 {
     return d->abortRequested.load();
@@ -392,6 +411,26 @@ struct MovingRangeTranslator : public DUChainVisitor
     MovingInterface* moving;
 };
 
+// The DUChain must be write-locked
+static void translateRanges(TopDUContext* context, qint64 sourceRevision, qint64 targetRevision, MovingInterface* moving)
+{
+    MovingRangeTranslator translator(sourceRevision, targetRevision, moving);
+    context->visit(translator);
+
+    QList< ProblemPointer > problems = context->problems();
+    for(QList< ProblemPointer >::iterator problem = problems.begin(); problem != problems.end(); ++problem)
+    {
+        RangeInRevision r = (*problem)->range();
+        translator.translateRange(r);
+        (*problem)->setRange(r);
+    }
+
+    // Update the modification revision in the meta-data
+    ModificationRevision modRev = context->parsingEnvironmentFile()->modificationRevision();
+    modRev.revision = targetRevision;
+    context->parsingEnvironmentFile()->setModificationRevision(modRev);
+}
+
 void ParseJob::translateDUChainToRevision(TopDUContext* context)
 {
     qint64 targetRevision = d->contents.modification.revision;
@@ -446,27 +485,34 @@ void ParseJob::translateDUChainToRevision(TopDUContext* context)
             return;
         }
 
-        // Perform translation
-        MovingInterface* moving = t->documentMovingInterface();
-
         DUChainWriteLocker wLock;
+        translateRanges(context, sourceRevision, targetRevision, t->documentMovingInterface());
+    }
+}
 
-        MovingRangeTranslator translator(sourceRevision, targetRevision, moving);
-        context->visit(translator);
+bool ParseJob::translateDUChainToRevision(TopDUContext* context, DocumentChangeTracker* tracker,
+                                          qint64 sourceRevision, qint64 targetRevision)
+{
+    VERIFY_FOREGROUND_LOCKED
+    ENSURE_CHAIN_WRITE_LOCKED
 
-        QList< ProblemPointer > problems = context->problems();
-        for(QList< ProblemPointer >::iterator problem = problems.begin(); problem != problems.end(); ++problem)
-        {
-            RangeInRevision r = (*problem)->range();
-            translator.translateRange(r);
-            (*problem)->setRange(r);
-        }
+    if(sourceRevision == -1 || targetRevision == -1 || sourceRevision > targetRevision)
+    {
+        qCDebug(LANGUAGE) << "for document" << context->url().str() << ": cannot translate from revision" << sourceRevision << "to" << targetRevision;
+        return false;
+    }
 
-        // Update the modification revision in the meta-data
-        ModificationRevision modRev = context->parsingEnvironmentFile()->modificationRevision();
-        modRev.revision = targetRevision;
-        context->parsingEnvironmentFile()->setModificationRevision(modRev);
+    if(!tracker || !tracker->holdingRevision(sourceRevision) || !tracker->holdingRevision(targetRevision))
+    {
+        qCDebug(LANGUAGE) << "lost one of the translation revisions, not doing the map";
+        return false;
+    }
+
+    if(sourceRevision != targetRevision)
+    {
+        translateRanges(context, sourceRevision, targetRevision, tracker->documentMovingInterface());
     }
+    return true;
 }
 
 bool ParseJob::isUpdateRequired(const IndexedString& languageString)
@@ -43,6 +43,7 @@ class ControlFlowGraph;
 class DataAccessRepository;
 class TopDUContext;
 class ReferencedTopDUContext;
+class DocumentChangeTracker;
 class ILanguageSupport;
 
 /**
@@ -115,6 +116,20 @@ public:
      */
     void translateDUChainToRevision(TopDUContext* context);
 
+    /**
+     * Translates the given context from @p sourceRevision to @p targetRevision of the document tracked by @p tracker,
+     * without requiring readContents(). The top-context meta-data will be updated with the target revision.
+     *
+     * Both revisions must be held by the caller, and the context must currently be at @p sourceRevision.
+     *
+     * The foreground lock and the DUChain write-lock must be held when this is called, so the caller can
+     * update the translated context under the same lock.
+     *
+     * @return whether the context is at @p targetRevision afterwards
+     */
+    static bool translateDUChainToRevision(TopDUContext* context, DocumentChangeTracker* tracker,
+                                           qint64 sourceRevision, qint64 targetRevision);
+
     /**
      * Query whether this job is needed to be waited for when trying to process a job with a lower priority.
      **/
@@ -142,6 +157,8 @@ public:
     virtual void setDuChain(const ReferencedTopDUContext& duChain);
     /// Returns the set du-context, or zero of none was set.
     virtual ReferencedTopDUContext duChain() const;
+    /// Returns the documents imported by the du-context, as of the time it was set with setDuChain.
+    QVector<IndexedString> imports() const;
 
     /// Overridden to allow jobs to determine if they've been requested to abort
     void requestAbort() override;
@@ -355,6 +355,49 @@ void TestBackgroundparser::benchmarkDocumentChanges()
     doc->save();
 }
 
+void TestBackgroundparser::benchmarkProjectParse()
+{
+    // a document is opened while the whole project is being parsed, it should be highlighted without
+    // waiting for the project parse
+    m_jobPlan.clear();
+    const int projectFiles = 400;
+    for (int i = 0; i < projectFiles; ++i) {
+        m_jobPlan.addJob(JobPrototype(QUrl::fromLocalFile("/bench_project_" + QString::number(i) + ".txt"),
+                                      BackgroundParser::InitialParsePriority, ParseJob::IgnoresSequentialProcessing, 10));
+    }
+    const JobPrototype activeDocument(QUrl::fromLocalFile(QStringLiteral("/bench_active.txt")),
+                                      BackgroundParser::BestPriority, ParseJob::IgnoresSequentialProcessing, 10);
+
+    auto parser = ICore::self()->languageController()->backgroundParser();
+
+    QElapsedTimer timer;
+    timer.start();
+    m_jobPlan.addJobsToParser();
+    parser->parseDocuments();
+
+    QTest::qWait(100);
+    m_jobPlan.addJob(activeDocument);
+    const qint64 openTime = timer.elapsed();
+    parser->addDocument(activeDocument.m_url, TopDUContext::Empty, activeDocument.m_priority, &m_jobPlan,
+                        activeDocument.m_flags, 0);
+
+    qint64 timeToFirstHighlight = -1;
+    while (m_jobPlan.numFinishedJobs() != m_jobPlan.numJobs() && !timer.hasExpired(30000)) {
+        if (timeToFirstHighlight < 0 && m_jobPlan.m_finishedJobs.contains(activeDocument.m_url)) {
+            timeToFirstHighlight = timer.elapsed() - openTime;
+        }
+        QTest::qWait(1);
+    }
+    const qint64 wallTime = timer.elapsed();
+    if (timeToFirstHighlight < 0 && m_jobPlan.m_finishedJobs.contains(activeDocument.m_url)) {
+        timeToFirstHighlight = wallTime - openTime;
+    }
+
+    QCOMPARE(m_jobPlan.numFinishedJobs(), m_jobPlan.numJobs());
+    qDebug() << "project parse wall time:" << wallTime << "ms, time to first highlight of the active document:"
+             << timeToFirstHighlight << "ms";
+}
+
 // see also: http://bugs.kde.org/355100
 void TestBackgroundparser::testNoDeadlockInJobCreation()
 {
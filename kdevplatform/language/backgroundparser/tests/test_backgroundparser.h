@@ -114,6 +114,8 @@ private Q_SLOTS:
 
     void benchmarkDocumentChanges();
 
+    void benchmarkProjectParse();
+
 private:
     JobPlan m_jobPlan;
     TestLanguageSupport *m_langSupport = nullptr;
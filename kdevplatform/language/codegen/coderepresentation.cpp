@@ -19,6 +19,7 @@
 #include "coderepresentation.h"
 
 #include <QFile>
+#include <QSaveFile>
 #include <KTextEditor/Document>
 
 #include <serialization/indexedstring.h>
@@ -192,12 +193,13 @@ class FileCodeRepresentation : public CodeRepresentation {
       Q_ASSERT(!onDiskChangesForbidden);
       QString localFile(m_document.toUrl().toLocalFile());
 
-      QFile file( localFile );
+      //The file is only replaced once it was written completely, so a failure never leaves it truncated
+      QSaveFile file( localFile );
       if ( file.open(QIODevice::WriteOnly) )
       {
           QByteArray data = text.toLocal8Bit();
 
-          if(file.write(data) == data.size())
+          if(file.write(data) == data.size() && file.commit())
           {
               ModificationRevision::clearModificationCache(m_document);
               return true;
@@ -322,6 +324,10 @@ CodeRepresentation::Ptr createCodeRepresentation(const IndexedString& path) {
         return CodeRepresentation::Ptr(new FileCodeRepresentation(path));
 }
 
+CodeRepresentation::Ptr createFileCodeRepresentation(const IndexedString& path) {
+    return CodeRepresentation::Ptr(new FileCodeRepresentation(path));
+}
+
 void CodeRepresentation::setDiskChangesForbidden(bool changesForbidden)
 {
     onDiskChangesForbidden = changesForbidden;
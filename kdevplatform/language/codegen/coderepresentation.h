@@ -144,6 +144,12 @@ class KDEVPLATFORMLANGUAGE_EXPORT DynamicCodeRepresentation : public CodeReprese
   */
 KDEVPLATFORMLANGUAGE_EXPORT CodeRepresentation::Ptr createCodeRepresentation(const IndexedString& url);
 
+/**
+  * Creates a code-representation for the contents of the given url on disk, even if it is open in an editor.
+  * Unlike createCodeRepresentation, this may be called from any thread.
+  */
+KDEVPLATFORMLANGUAGE_EXPORT CodeRepresentation::Ptr createFileCodeRepresentation(const IndexedString& url);
+
 /**
   * @return true if an artificial code representation already exists for the specified URL
   */
@@ -25,6 +25,7 @@
 
 #include <QStringList>
 #include <QMimeDatabase>
+#include <QtConcurrentMap>
 
 #include <KLocalizedString>
 
@@ -67,11 +68,12 @@ public:
 
     DocumentChangeSet::ChangeResult addChange(const DocumentChangePointer& change);
     DocumentChangeSet::ChangeResult replaceOldText(CodeRepresentation* repr, const QString& newText,
-                                                   const ChangesList& sortedChangesList);
+                                                   const ChangesList& sortedChangesList) const;
     DocumentChangeSet::ChangeResult generateNewText(const IndexedString& file,
                                                     ChangesList& sortedChanges,
                                                     const CodeRepresentation* repr,
-                                                    QString& output);
+                                                    ISourceFormatter* formatter,
+                                                    QString& output) const;
     DocumentChangeSet::ChangeResult removeDuplicates(const IndexedString& file,
                                                      ChangesList& filteredChanges);
     void formatChanges();
@@ -129,6 +131,21 @@ static QString printRange(const KTextEditor::Range& r)
                  r.end().line(), r.end().column());
 }
 
+// All changes of one file, and the state of applying them
+struct FileChanges
+{
+    IndexedString file;
+    ChangesList sortedChanges;
+    ISourceFormatter* formatter = nullptr;
+    // whether the file is neither open in an editor nor artificial, so it is changed directly on disk
+    bool onDisk = false;
+    bool applied = false;
+    CodeRepresentation::Ptr repr;
+    QString oldText;
+    QString newText;
+    DocumentChangeSet::ChangeResult result = DocumentChangeSet::ChangeResult::successfulResult();
+};
+
 
 }
 
@@ -261,49 +278,96 @@ DocumentChangeSet::ChangeResult DocumentChangeSet::applyAllChanges()
         }
     }
 
-    QMap<IndexedString, CodeRepresentation::Ptr> codeRepresentations;
-    QMap<IndexedString, QString> newTexts;
-    ChangesHash filteredSortedChanges;
     ChangeResult result = ChangeResult::successfulResult();
 
     const QList<IndexedString> files(d->changes.keys());
 
-    for (const IndexedString& file : files) {
-        CodeRepresentation::Ptr repr = createCodeRepresentation(file);
-        if(!repr) {
-            return ChangeResult(QStringLiteral("Could not create a Representation for %1").arg(file.str()));
+    QVector<FileChanges> fileChanges(files.size());
+    for (int i = 0; i < files.size(); ++i) {
+        FileChanges& fileChange = fileChanges[i];
+        fileChange.file = files[i];
+
+        result = d->removeDuplicates(fileChange.file, fileChange.sortedChanges);
+        if(!result)
+            return result;
+
+        if (d->formatPolicy != NoAutoFormat && ICore::self()) {
+            fileChange.formatter = ICore::self()->sourceFormatterController()->formatterForUrl(fileChange.file.toUrl());
         }
 
-        codeRepresentations[file] = repr;
+        IDocument* document = ICore::self()->documentController()->documentForUrl(fileChange.file.toUrl());
+        fileChange.onDisk = !artificialCodeRepresentationExists(fileChange.file) && !(document && document->textDocument());
+    }
 
-        QList<DocumentChangePointer>& sortedChangesList(filteredSortedChanges[file]);
-        {
-            result = d->removeDuplicates(file, sortedChangesList);
-            if(!result)
-                return result;
+    // Files on disk are read and changed concurrently, unless a formatter has to be run on the changes
+    QtConcurrent::blockingMap(fileChanges, [this](FileChanges& fileChange) {
+        if (!fileChange.onDisk || fileChange.formatter)
+            return;
+        fileChange.repr = createFileCodeRepresentation(fileChange.file);
+        fileChange.result = d->generateNewText(fileChange.file, fileChange.sortedChanges, fileChange.repr.data(),
+                                               nullptr, fileChange.newText);
+    });
+
+    for (FileChanges& fileChange : fileChanges) {
+        if (fileChange.onDisk && !fileChange.formatter) {
+            if (!fileChange.result)
+                return fileChange.result;
+            continue;
         }
 
-        {
-            result = d->generateNewText(file, sortedChangesList, repr.data(), newTexts[file]);
-            if(!result)
-                return result;
+        fileChange.repr = fileChange.onDisk ? createFileCodeRepresentation(fileChange.file)
+                                            : createCodeRepresentation(fileChange.file);
+        if(!fileChange.repr) {
+            return ChangeResult(QStringLiteral("Could not create a Representation for %1").arg(fileChange.file.str()));
         }
-    }
 
-    QMap<IndexedString, QString> oldTexts;
+        result = d->generateNewText(fileChange.file, fileChange.sortedChanges, fileChange.repr.data(),
+                                    fileChange.formatter, fileChange.newText);
+        if(!result)
+            return result;
+    }
 
-    //Apply the changes to the files
-    for (const IndexedString& file : files) {
-        oldTexts[file] = codeRepresentations[file]->text();
+    //Apply the changes to the files, the files on disk are written concurrently and each one is replaced atomically
+    QtConcurrent::blockingMap(fileChanges, [this](FileChanges& fileChange) {
+        if (!fileChange.onDisk)
+            return;
+        fileChange.oldText = fileChange.repr->text();
+        fileChange.result = d->replaceOldText(fileChange.repr.data(), fileChange.newText, fileChange.sortedChanges);
+        fileChange.applied = fileChange.result;
+    });
+
+    auto revertAll = [&fileChanges]() {
+        for (FileChanges& fileChange : fileChanges) {
+            if (fileChange.applied) {
+                fileChange.repr->setText(fileChange.oldText);
+            }
+        }
+    };
 
-        result = d->replaceOldText(codeRepresentations[file].data(), newTexts[file], filteredSortedChanges[file]);
-        if(!result && d->replacePolicy == StopOnFailedChange) {
-            //Revert all files
-            foreach(const IndexedString &revertFile, oldTexts.keys()) {
-                codeRepresentations[revertFile]->setText(oldTexts[revertFile]);
+    for (const FileChanges& fileChange : fileChanges) {
+        if (fileChange.onDisk && !fileChange.result) {
+            result = fileChange.result;
+            if (d->replacePolicy == StopOnFailedChange) {
+                revertAll();
+                return result;
             }
+        }
+    }
 
-            return result;
+    for (FileChanges& fileChange : fileChanges) {
+        if (fileChange.onDisk)
+            continue;
+
+        fileChange.oldText = fileChange.repr->text();
+        // a failed editor change may still have replaced some of the text, so it is reverted as well
+        fileChange.applied = true;
+        fileChange.result = d->replaceOldText(fileChange.repr.data(), fileChange.newText, fileChange.sortedChanges);
+        if (!fileChange.result) {
+            result = fileChange.result;
+            if (d->replacePolicy == StopOnFailedChange) {
+                revertAll();
+                return result;
+            }
         }
     }
 
@@ -325,7 +389,7 @@ DocumentChangeSet::ChangeResult DocumentChangeSet::applyAllChanges()
 
 DocumentChangeSet::ChangeResult DocumentChangeSetPrivate::replaceOldText(CodeRepresentation* repr,
                                                                          const QString& newText,
-                                                                         const ChangesList& sortedChangesList)
+                                                                         const ChangesList& sortedChangesList) const
 {
     DynamicCodeRepresentation* dynamic = dynamic_cast<DynamicCodeRepresentation*>(repr);
     if(dynamic) {
@@ -372,20 +436,19 @@ DocumentChangeSet::ChangeResult DocumentChangeSetPrivate::replaceOldText(CodeRep
 DocumentChangeSet::ChangeResult DocumentChangeSetPrivate::generateNewText(const IndexedString & file,
                                                                           ChangesList& sortedChanges,
                                                                           const CodeRepresentation * repr,
-                                                                          QString & output)
+                                                                          ISourceFormatter* formatter,
+                                                                          QString & output) const
 {
 
-    ISourceFormatter* formatter = nullptr;
-    if(ICore::self()) {
-        formatter = ICore::self()->sourceFormatterController()->formatterForUrl(file.toUrl());
-    }
-
     //Create the actual new modified file
     QStringList textLines = repr->text().split(QLatin1Char('\n'));
 
     QUrl url = file.toUrl();
 
-    QMimeType mime = QMimeDatabase().mimeTypeForUrl(url);
+    QMimeType mime;
+    if (formatter) {
+        mime = QMimeDatabase().mimeTypeForUrl(url);
+    }
     QVector<int> removedLines;
 
     for(int pos = sortedChanges.size()-1; pos >= 0; --pos) {
@@ -394,15 +457,15 @@ DocumentChangeSet::ChangeResult DocumentChangeSetPrivate::generateNewText(const
         if(changeIsValid(change, textLines)  && //We demand this, although it should be fixed
             ((encountered = rangeText(change.m_range, textLines)) == change.m_oldText || change.m_ignoreOldText))
         {
-            ///Problem: This does not work if the other changes significantly alter the context @todo Use the changed context
-            QString leftContext = QStringList(textLines.mid(0, change.m_range.start().line()+1)).join(QLatin1Char('\n'));
-            leftContext.chop(textLines[change.m_range.start().line()].length() - change.m_range.start().column());
-
-            QString rightContext = QStringList(textLines.mid(change.m_range.end().line())).join(QLatin1Char('\n')).mid(change.m_range.end().column());
-
             if(formatter && (formatPolicy == DocumentChangeSet::AutoFormatChanges
                                 || formatPolicy == DocumentChangeSet::AutoFormatChangesKeepIndentation))
             {
+                ///Problem: This does not work if the other changes significantly alter the context @todo Use the changed context
+                QString leftContext = QStringList(textLines.mid(0, change.m_range.start().line()+1)).join(QLatin1Char('\n'));
+                leftContext.chop(textLines[change.m_range.start().line()].length() - change.m_range.start().column());
+
+                QString rightContext = QStringList(textLines.mid(change.m_range.end().line())).join(QLatin1Char('\n')).mid(change.m_range.end().column());
+
                 QString oldNewText = change.m_newText;
                 change.m_newText = formatter->formatSource(change.m_newText, url, mime, leftContext, rightContext);
 
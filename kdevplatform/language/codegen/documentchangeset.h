@@ -136,7 +136,12 @@ public:
     ///@param policy Whether the affected documents should be activated when the change is applied
     void setActivationPolicy(ActivationPolicy policy);
 
-    /// Apply all the changes registered in this changeset to the actual files
+    /**
+     * Apply all the changes registered in this changeset to the actual files
+     *
+     * Documents open in an editor are changed through the editor, all other files are changed
+     * concurrently on disk, unless their changes have to be formatted.
+     */
     ChangeResult applyAllChanges();
 
 private:
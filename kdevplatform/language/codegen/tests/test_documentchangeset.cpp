@@ -72,3 +72,27 @@ void TestDocumentchangeset::testReplaceSameLine()
     QVERIFY(result);
 }
 
+
+void TestDocumentchangeset::testReplaceMultipleFiles()
+{
+    TestFile first(QStringLiteral("abc def\nabc"), QStringLiteral("cpp"));
+    TestFile second(QStringLiteral("def abc"), QStringLiteral("cpp"));
+
+    DocumentChangeSet changes;
+    changes.setFormatPolicy(DocumentChangeSet::NoAutoFormat);
+    changes.addChange(DocumentChange(first.url(), KTextEditor::Range(0, 0, 0, 3), QStringLiteral("abc"), QStringLiteral("x")));
+    changes.addChange(DocumentChange(first.url(), KTextEditor::Range(1, 0, 1, 3), QStringLiteral("abc"), QStringLiteral("x")));
+    changes.addChange(DocumentChange(second.url(), KTextEditor::Range(0, 4, 0, 7), QStringLiteral("abc"), QStringLiteral("x")));
+
+    // an inconsistent change leaves all files untouched
+    DocumentChangeSet failingChanges = changes;
+    failingChanges.addChange(DocumentChange(second.url(), KTextEditor::Range(0, 0, 0, 3), QStringLiteral("xyz"), QStringLiteral("x")));
+    QVERIFY(!failingChanges.applyAllChanges());
+    QCOMPARE(first.fileContents(), QStringLiteral("abc def\nabc"));
+    QCOMPARE(second.fileContents(), QStringLiteral("def abc"));
+
+    DocumentChangeSet::ChangeResult result = changes.applyAllChanges();
+    QVERIFY2(result, qPrintable(result.m_failureReason));
+    QCOMPARE(first.fileContents(), QStringLiteral("x def\nx"));
+    QCOMPARE(second.fileContents(), QStringLiteral("def x"));
+}
@@ -32,6 +32,7 @@ private Q_SLOTS:
     void cleanupTestCase();
 
     void testReplaceSameLine();
+    void testReplaceMultipleFiles();
 };
 
 #endif // TESTDOCUMENTCHANGESET_H
@@ -22,10 +22,13 @@
 #include "appendedlist.h"
 #include "declaration.h"
 #include "declarationid.h"
+#include "duchainupdatebatch.h"
 #include "duchainpointer.h"
 #include <serialization/indexedstring.h>
 #include "serialization/itemrepository.h"
 
+#include <QThreadStorage>
+
 namespace KDevelop {
 
 DEFINE_LIST_MEMBER_HASH(DefinitionsItem, definitions, IndexedDeclaration)
@@ -139,6 +142,8 @@ public:
   }
   //Maps declaration-ids to definitions
   ItemRepository<DefinitionsItem, DefinitionsRequestItem> m_definitions;
+  //Changes deferred by a DUChainUpdateBatch
+  QThreadStorage<PendingRepositoryChanges<DeclarationId, IndexedDeclaration>> m_pending;
 };
 
 Definitions::Definitions() : d(new DefinitionsPrivate())
@@ -149,6 +154,13 @@ Definitions::~Definitions() = default;
 
 void Definitions::addDefinition(const DeclarationId& id, const IndexedDeclaration& definition)
 {
+  if(DUChainUpdateBatch::isActive()) {
+    d->m_pending.localData().record(id, definition, true);
+    return;
+  }
+
+  QMutexLocker lock(d->m_definitions.mutex());
+
   DefinitionsItem item;
   item.declaration = id;
   item.definitionsList().append(definition);
@@ -174,6 +186,13 @@ void Definitions::addDefinition(const DeclarationId& id, const IndexedDeclaratio
 
 void Definitions::removeDefinition(const DeclarationId& id, const IndexedDeclaration& definition)
 {
+  if(DUChainUpdateBatch::isActive()) {
+    d->m_pending.localData().record(id, definition, false);
+    return;
+  }
+
+  QMutexLocker lock(d->m_definitions.mutex());
+
   DefinitionsItem item;
   item.declaration = id;
   DefinitionsRequestItem request(item);
@@ -198,6 +217,8 @@ void Definitions::removeDefinition(const DeclarationId& id, const IndexedDeclara
 
 KDevVarLengthArray<IndexedDeclaration> Definitions::definitions(const DeclarationId& id) const
 {
+  QMutexLocker lock(d->m_definitions.mutex());
+
   KDevVarLengthArray<IndexedDeclaration> ret;
 
   DefinitionsItem item;
@@ -211,10 +232,26 @@ KDevVarLengthArray<IndexedDeclaration> Definitions::definitions(const Declaratio
     FOREACH_FUNCTION(const IndexedDeclaration& decl, repositoryItem->definitions)
       ret.append(decl);
   }
+
+  if(DUChainUpdateBatch::isActive())
+    d->m_pending.localData().applyTo(id, ret);
   
   return ret;
 }
 
+void Definitions::commitBatch()
+{
+  auto& pending = d->m_pending.localData();
+  if(pending.isEmpty())
+    return;
+
+  QMutexLocker lock(d->m_definitions.mutex());
+
+  pending.commitTo<DefinitionsItem, DefinitionsRequestItem>(d->m_definitions,
+    [](DefinitionsItem& item) { return &item.definitionsList(); },
+    [](const DefinitionsItem* item) { return qMakePair(item->definitions(), item->definitionsSize()); });
+}
+
 void Definitions::dump(const QTextStream& out)
 {
   QMutexLocker lock(d->m_definitions.mutex());
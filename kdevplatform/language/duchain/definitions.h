@@ -36,6 +36,7 @@ namespace KDevelop {
 
 /**
  * Global mapping of one Declaration-Ids to multiple Definitions, protected through DUChainLock.
+ * Each operation locks the repository by itself, see DUChainLock::lockForSharedWrite().
  * */
   class KDEVPLATFORMLANGUAGE_EXPORT Definitions {
     public:
@@ -57,6 +58,10 @@ namespace KDevelop {
     void dump(const QTextStream& out);
 
     private:
+      friend class DUChainUpdateBatch;
+      ///Applies the changes the current thread collected within a DUChainUpdateBatch
+      void commitBatch();
+
       const QScopedPointer<class DefinitionsPrivate> d;
   };
 }
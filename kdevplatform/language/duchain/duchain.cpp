@@ -30,6 +30,7 @@
 #include <QStandardPaths>
 #include <QMutex>
 #include <QTimer>
+#include <QElapsedTimer>
 
 #include <qtcompat_p.h>
 #include <interfaces/idocumentcontroller.h>
@@ -58,6 +59,7 @@
 #include "serialization/itemrepository.h"
 #include "waitforupdate.h"
 #include "importers.h"
+#include "includegraph.h"
 
 #if HAVE_MALLOC_TRIM
 #include "malloc.h"
@@ -410,6 +412,11 @@ public:
 
   QMutex m_cleanupMutex;
 
+  //Time spent serializing top-contexts during the current cleanup in nanoseconds, protected by the cleanup mutex
+  qint64 m_storeSnapshotTime = 0;
+  //Protected by m_chainsMutex
+  DUChain::StoreStatistics m_lastStoreStatistics;
+
   CleanupThread* m_cleanup;
 
   DUChain* instance;
@@ -734,6 +741,8 @@ public:
     }
 
     QTime startTime = QTime::currentTime();
+    if (lockFlag != NoLock)
+      m_storeSnapshotTime = 0;
     PersistentSymbolTable::self().clearCache();
 
     storeAllInformation(!retries, writeLock); //Puts environment-information into a repository
@@ -751,9 +760,13 @@ public:
       }
     }
 
+    QElapsedTimer snapshotTimer;
+
     foreach(TopDUContext* context, workOnContexts) {
 
+      snapshotTimer.start();
       context->m_dynamicData->store();
+      m_storeSnapshotTime += snapshotTimer.nsecsElapsed();
 
       if(retries) {
         //Eventually give other threads a chance to access the duchain
@@ -764,6 +777,16 @@ public:
       }
     }
 
+      //Unloading needs to know whether the top-context files were written. The stores never take the duchain lock,
+      //so in the final pass they are awaited while holding it, to keep the snapshot consistent.
+      if(retries) {
+        writeLock.unlock();
+        TopDUContextDynamicData::waitForStores();
+        writeLock.lock();
+      } else {
+        TopDUContextDynamicData::waitForStores();
+      }
+
       //Unload all top-contexts that don't have a reference-count and that are not imported by a referenced one
 
       QSet<IndexedString> unloadedNames;
@@ -811,7 +834,9 @@ public:
           unloadedNames.insert(unload->url());
           //Since we've released the write-lock in between, we've got to call store() again to be sure that none of the data is dynamic
           //If nothing has changed, it is only a low-cost call.
+          snapshotTimer.start();
           unload->m_dynamicData->store();
+          m_storeSnapshotTime += snapshotTimer.nsecsElapsed();
           Q_ASSERT(!unload->d_func()->m_dynamic);
           removeDocumentChainFromMemory(unload);
           workOnContexts.remove(unload);
@@ -857,6 +882,9 @@ public:
       if(retries)
         writeLock.unlock();
 
+      //The top-context files are written in the background, they must be complete before the repositories are stored
+      TopDUContextDynamicData::waitForStores();
+
       //This must be the last step, due to the on-disk reference counting
       globalItemRepositoryRegistry().store(); //Stores all repositories
 
@@ -864,7 +892,9 @@ public:
         //Store the static parsing-environment file data
         ///@todo Solve this more elegantly, using a general mechanism to store static duchain-like data
         Q_ASSERT(ParsingEnvironmentFile::m_staticData);
-        QFile f(globalItemRepositoryRegistry().path() + QLatin1String("/parsing_environment_data"));
+        const QString path = globalItemRepositoryRegistry().path() + QLatin1String("/parsing_environment_data");
+        globalItemRepositoryRegistry().journalFile(path);
+        QFile f(path);
         bool opened = f.open(QIODevice::WriteOnly);
         Q_ASSERT(opened);
         Q_UNUSED(opened);
@@ -875,7 +905,9 @@ public:
       {
         QMutexLocker lock(&m_chainsMutex);
 
-        QFile f(globalItemRepositoryRegistry().path() + QLatin1String("/available_top_context_indices"));
+        const QString path = globalItemRepositoryRegistry().path() + QLatin1String("/available_top_context_indices");
+        globalItemRepositoryRegistry().journalFile(path);
+        QFile f(path);
         bool opened = f.open(QIODevice::WriteOnly);
         Q_ASSERT(opened);
         Q_UNUSED(opened);
@@ -894,6 +926,15 @@ public:
 
         const auto elapsedMS = startTime.msecsTo(QTime::currentTime());
         qCDebug(LANGUAGE) << "time spent doing cleanup:" << elapsedMS << "ms - top-contexts still open:" << m_chainsByUrl.size() << "- retries" << retries;
+
+        DUChain::StoreStatistics statistics;
+        TopDUContextDynamicData::takeStoreStatistics(&statistics.storedTopContexts, &statistics.bytesWritten);
+        statistics.snapshotTime = m_storeSnapshotTime / 1000000;
+        statistics.flushTime = elapsedMS;
+        qCDebug(LANGUAGE) << "stored" << statistics.storedTopContexts << "top-contexts," << statistics.bytesWritten << "bytes - duchain locked for" << statistics.snapshotTime << "ms";
+
+        QMutexLocker lock(&m_chainsMutex);
+        m_lastStoreStatistics = statistics;
       }
 
       foreach(QReadWriteLock* lock, locked)
@@ -1169,6 +1210,7 @@ void DUChain::initialize()
   initInstantiationInformationRepository();
 
   Importers::self();
+  IncludeGraph::self();
 
   globalImportIdentifier();
   globalIndexedImportIdentifier();
@@ -1726,6 +1768,22 @@ void DUChain::disablePersistentStorage(bool disable) {
   sdDUChainPrivate->m_cleanupDisabled = disable;
 }
 
+void DUChain::setCompressedStorage(bool compressed)
+{
+  TopDUContextDynamicData::setCompressionEnabled(compressed);
+}
+
+bool DUChain::compressedStorage() const
+{
+  return TopDUContextDynamicData::compressionEnabled();
+}
+
+DUChain::StoreStatistics DUChain::lastStoreStatistics() const
+{
+  QMutexLocker lock(&sdDUChainPrivate->m_chainsMutex);
+  return sdDUChainPrivate->m_lastStoreStatistics;
+}
+
 void DUChain::storeToDisk() {
   bool wasDisabled = sdDUChainPrivate->m_cleanupDisabled;
   sdDUChainPrivate->m_cleanupDisabled = false;
@@ -243,10 +243,30 @@ public:
   ///If you call this, the persistent disk-storage structure will stay unaffected, and no duchain cleanup will be done.
   ///Call this from within tests.
   void disablePersistentStorage(bool disable = true);
+
+  ///Whether top-contexts are compressed when they are stored to disk. This saves disk space and I/O at the cost of CPU time.
+  ///Both formats can always be loaded. Enabled by default if the KDEV_DUCHAIN_COMPRESS environment variable is set.
+  void setCompressedStorage(bool compressed);
+  bool compressedStorage() const;
   
   ///Stores the whole duchain and all its repositories in the current state to disk
   ///The duchain must not be locked in any way
   void storeToDisk();
+
+  struct StoreStatistics
+  {
+    ///Number of top-context files that were written
+    int storedTopContexts = 0;
+    ///Bytes written to top-context files
+    qint64 bytesWritten = 0;
+    ///Milliseconds the duchain was write-locked to serialize the top-contexts. The files are written in the background.
+    qint64 snapshotTime = 0;
+    ///Milliseconds the whole store took, including writing the files and the repositories
+    qint64 flushTime = 0;
+  };
+
+  ///Statistics of the last time the duchain was stored to disk, either by storeToDisk() or by the periodic cleanup
+  StoreStatistics lastStoreStatistics() const;
   
   ///Compares the whole duchain and all its repositories in the current state to disk
   ///When the comparison fails, debug-output will show why
@@ -22,16 +22,60 @@
 #include "duchainlock.h"
 #include "duchain.h"
 
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMutex>
 #include <QThread>
 #include <QThreadStorage>
-#include <QElapsedTimer>
+#include <QWaitCondition>
 
+#include <atomic>
+
+Q_LOGGING_CATEGORY(DUCHAINLOCK, "kdevplatform.language.duchainlock", QtInfoMsg)
 
 ///@todo Always prefer exactly that lock that is requested by the thread that has the foreground mutex,
 ///           to reduce the amount of UI blocking.
 
-//Microseconds to sleep when waiting for a lock
-const uint uSleepTime = 500;
+namespace {
+
+///Milliseconds a thread sleeps at most before re-checking the lock state, as a safety net against missed wake-ups
+const unsigned long maxSleepTime = 100;
+
+///Milliseconds a new reader defers to waiting writers. Afterwards it only waits for an active writer.
+///This must be bounded: a thread holding a read-lock blocks the waiting writer, and if it waits for
+///another thread that needs a fresh read-lock, an unbounded writer preference would deadlock.
+const qint64 writerPreferenceTime = 50;
+
+///Waits that take longer than this many milliseconds are reported through the debug category
+const qint64 reportWaitTime = 100;
+
+///Bucket n of the wait histograms counts waits shorter than 2^n microseconds, the last one counts all longer waits
+const int waitHistogramBuckets = 24;
+
+enum WaitKind {
+  ReadWait,
+  WriteWait,
+  SharedWriteWait,
+  WaitKindCount
+};
+
+const char* const waitKindNames[WaitKindCount] = {"read", "write", "shared write"};
+
+enum WaitingThread {
+  ForegroundThread,
+  BackgroundThread,
+  WaitingThreadCount
+};
+
+WaitingThread currentWaitingThread()
+{
+  const auto* app = QCoreApplication::instance();
+  return (app && app->thread() == QThread::currentThread()) ? ForegroundThread : BackgroundThread;
+}
+
+}
 
 namespace KDevelop
 {
@@ -39,22 +83,234 @@ namespace KDevelop
 class DUChainLockPrivate
 {
 public:
+  struct ThreadState
+  {
+    int readerRecursion = 0;
+    ///How often this thread holds the shared write-lock
+    int sharedWriterRecursion = 0;
+    ///Read- and write-locks requested while holding the shared write-lock, they are implied by it
+    int impliedLocks = 0;
+    ///The top-context this thread builds while holding the shared write-lock, and the ones it imports
+    uint sharedTopContext = 0;
+    QVector<uint> sharedImportedTopContexts;
+  };
+
   DUChainLockPrivate()
     : m_writer(nullptr)
     , m_writerRecursion(0)
     , m_totalReaderRecursion(0)
+    , m_sharedWriters(0)
+    , m_waitingWriters(0)
+    , m_waitingReaders(0)
+    , m_sleepers(0)
   { }
 
-  int ownReaderRecursion() const
+  ThreadState& threadState()
+  {
+    return m_threadState.localData();
+  }
+
+  int ownReaderRecursion()
+  {
+    return threadState().readerRecursion;
+  }
+
+  ///@return whether the current thread holds the shared write-lock. Cheap while nobody does.
+  bool ownsSharedWriteLock()
+  {
+    return m_sharedWriters.loadAcquire() && threadState().sharedWriterRecursion;
+  }
+
+  ///@return the new total reader recursion
+  int changeOwnReaderRecursion(int difference)
+  {
+    int& recursion = threadState().readerRecursion;
+    recursion += difference;
+    Q_ASSERT(recursion >= 0);
+    return m_totalReaderRecursion.fetchAndAddOrdered(difference) + difference;
+  }
+
+  ///Must be called with the own reader recursion already increased.
+  ///@param deferToWriters whether the lock should also be refused while writers are waiting
+  bool readLockAcquired(bool deferToWriters) const
+  {
+    //Pairs with the fences of the writers, after they announced themselves
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    QThread* w = m_writer.loadAcquire();
+    if (w == QThread::currentThread()) {
+      //We hold the write lock by ourselves
+      return true;
+    }
+    return !w && !m_sharedWriters.loadAcquire() && (!deferToWriters || !m_waitingWriters.loadAcquire());
+  }
+
+  bool readLockBlocked(bool deferToWriters) const
+  {
+    return m_writer.loadAcquire() || m_sharedWriters.loadAcquire() || (deferToWriters && m_waitingWriters.loadAcquire());
+  }
+
+  bool tryWriteLock()
+  {
+    if (m_totalReaderRecursion.loadAcquire() == 0 && m_sharedWriters.loadAcquire() == 0 && m_writerRecursion.testAndSetOrdered(0, 1)) {
+      //Now we can be sure that there is no other writer, as we have increased m_writerRecursion from 0 to 1
+      m_writer.fetchAndStoreOrdered(QThread::currentThread());
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (m_totalReaderRecursion.loadAcquire() == 0 && m_sharedWriters.loadAcquire() == 0) {
+        //There is still no readers, we have successfully acquired a write-lock
+        return true;
+      }
+      //There may be readers, give up again. Readers that saw us as writer may have gone to sleep.
+      m_writer.storeRelease(nullptr);
+      m_writerRecursion.storeRelease(0);
+      wakeWaiters();
+    }
+    return false;
+  }
+
+  bool writeLockBlocked() const
+  {
+    return m_writerRecursion.loadAcquire() || m_totalReaderRecursion.loadAcquire() || m_sharedWriters.loadAcquire();
+  }
+
+  ///@param deferToWriters whether the lock should also be refused while exclusive writers are waiting
+  bool trySharedWriteLock(bool deferToWriters, uint topContext, const QVector<uint>& importedTopContexts)
+  {
+    if (sharedWritersKeepReadersOut()) {
+      return false;
+    }
+
+    {
+      QMutexLocker lock(&m_sharedTopContextsMutex);
+      if (sharedTopContextsConflict(topContext, importedTopContexts)) {
+        return false;
+      }
+      changeSharedTopContexts(topContext, importedTopContexts, 1);
+    }
+
+    //Announce ourselves first, so exclusive writers and readers see us before we check for them
+    m_sharedWriters.fetchAndAddOrdered(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!sharedWriteLockBlocked(deferToWriters)) {
+      return true;
+    }
+    releaseSharedTopContexts(topContext, importedTopContexts);
+    return false;
+  }
+
+  ///Gives up the shared write-lock, or the attempt to acquire it
+  void releaseSharedTopContexts(uint topContext, const QVector<uint>& importedTopContexts)
+  {
+    {
+      QMutexLocker lock(&m_sharedTopContextsMutex);
+      changeSharedTopContexts(topContext, importedTopContexts, -1);
+    }
+    m_sharedWriters.fetchAndAddOrdered(-1);
+    //Shared writers may wait for the top-contexts, even if other shared writers remain
+    wakeWaiters();
+  }
+
+  bool sharedWriteLockBlocked(bool deferToWriters) const
+  {
+    return m_writerRecursion.loadAcquire() || m_totalReaderRecursion.loadAcquire()
+           || (deferToWriters && m_waitingWriters.loadAcquire());
+  }
+
+  ///Readers wait for the active shared writers to finish. While they do, no further shared writers may join,
+  ///otherwise overlapping shared writers could keep the readers, including the foreground thread, out indefinitely.
+  bool sharedWritersKeepReadersOut() const
+  {
+    return m_waitingReaders.loadAcquire() && m_sharedWriters.loadAcquire();
+  }
+
+  ///Shared writers are not excluded from each other by the lock, they may only build different top-contexts.
+  ///A shared writer must also not build a top-context that another one imports, as that one reads it meanwhile.
+  ///m_sharedTopContextsMutex must be locked.
+  bool sharedTopContextsConflict(uint topContext, const QVector<uint>& importedTopContexts) const
+  {
+    if (m_sharedWrittenTopContexts.contains(topContext) || m_sharedReadTopContexts.contains(topContext)) {
+      return true;
+    }
+    for (uint imported : importedTopContexts) {
+      if (m_sharedWrittenTopContexts.contains(imported)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  ///m_sharedTopContextsMutex must be locked
+  void changeSharedTopContexts(uint topContext, const QVector<uint>& importedTopContexts, int difference)
+  {
+    auto change = [difference](QHash<uint, int>& counts, uint index) {
+      int& count = counts[index];
+      count += difference;
+      Q_ASSERT(count >= 0);
+      if (!count) {
+        counts.remove(index);
+      }
+    };
+    change(m_sharedWrittenTopContexts, topContext);
+    for (uint imported : importedTopContexts) {
+      change(m_sharedReadTopContexts, imported);
+    }
+  }
+
+  ///Wakes up all threads that sleep in waitWhile(). Must be called after every change that may unblock them.
+  void wakeWaiters()
   {
-    return m_readerRecursion.localData();
+    //The lock state was changed before, and a sleeper announces itself before checking the lock state.
+    //Release and acquire semantics allow both loads to see the old values, then the wake-up would be lost.
+    //The fences pair with the one in waitWhile(), so at least one side sees the other's change.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleepers.loadAcquire()) {
+      QMutexLocker lock(&m_waitMutex);
+      m_waitCondition.wakeAll();
+    }
   }
 
-  void changeOwnReaderRecursion(int difference)
+  ///Sleeps until @p blocked might have changed, or until @p timeout milliseconds have passed since @p timer was started.
+  ///@param timeout zero means no timeout
+  ///@return false if the timeout has been reached
+  template<typename Blocked>
+  bool waitWhile(Blocked blocked, unsigned int timeout, const QElapsedTimer& timer)
   {
-    m_readerRecursion.localData() += difference;
-    Q_ASSERT(m_readerRecursion.localData() >= 0);
-    m_totalReaderRecursion.fetchAndAddOrdered(difference);
+    unsigned long sleepTime = maxSleepTime;
+    if (timeout) {
+      const qint64 remaining = timeout - timer.elapsed();
+      if (remaining <= 0) {
+        return false;
+      }
+      sleepTime = qMin<unsigned long>(sleepTime, remaining);
+    }
+
+    m_sleepers.fetchAndAddOrdered(1);
+    //Pairs with the fence in wakeWaiters()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+      QMutexLocker lock(&m_waitMutex);
+      if (blocked()) {
+        m_waitCondition.wait(&m_waitMutex, sleepTime);
+      }
+    }
+    m_sleepers.fetchAndAddOrdered(-1);
+    return true;
+  }
+
+  void recordWait(WaitKind kind, const QElapsedTimer& timer)
+  {
+    const qint64 usecs = timer.nsecsElapsed() / 1000;
+    int bucket = 0;
+    while (bucket < waitHistogramBuckets - 1 && (qint64(1) << bucket) <= usecs) {
+      ++bucket;
+    }
+    const WaitingThread thread = currentWaitingThread();
+    m_waitHistogram[kind][thread][bucket].fetchAndAddRelaxed(1);
+
+    if (usecs / 1000 >= reportWaitTime) {
+      qCDebug(DUCHAINLOCK) << (thread == ForegroundThread ? "foreground" : "background") << "thread"
+                           << QThread::currentThread() << "waited" << usecs / 1000 << "ms for the"
+                           << waitKindNames[kind] << "lock";
+    }
   }
 
   ///Holds the writer that currently has the write-lock, or zero. Is protected by m_writerRecursion.
@@ -63,10 +319,29 @@ public:
   ///How often is the chain write-locked by the writer? This value protects m_writer,
   ///m_writer may only be changed by the thread that successfully increases this value from 0 to 1
   QAtomicInt m_writerRecursion;
-  ///How often is the chain read-locked recursively by all readers? Should be sum of all m_readerRecursion values
+  ///How often is the chain read-locked recursively by all readers? Should be sum of all readerRecursion values
   QAtomicInt m_totalReaderRecursion;
-
-  QThreadStorage<int> m_readerRecursion;
+  ///How many threads hold the shared write-lock, or are just trying to acquire it?
+  QAtomicInt m_sharedWriters;
+  ///How many threads are waiting for the (exclusive or shared) write-lock? While this is nonzero, new readers defer to the writers.
+  QAtomicInt m_waitingWriters;
+  ///How many threads are waiting for a read-lock? While this and m_sharedWriters are nonzero, no shared writers join.
+  QAtomicInt m_waitingReaders;
+  ///How many threads are sleeping on m_waitCondition?
+  QAtomicInt m_sleepers;
+
+  QThreadStorage<ThreadState> m_threadState;
+
+  ///The top-contexts that are built by threads holding the shared write-lock, and those they import,
+  ///mapped to the number of these threads
+  QHash<uint, int> m_sharedWrittenTopContexts;
+  QHash<uint, int> m_sharedReadTopContexts;
+  QMutex m_sharedTopContextsMutex;
+
+  QMutex m_waitMutex;
+  QWaitCondition m_waitCondition;
+
+  QAtomicInt m_waitHistogram[WaitKindCount][WaitingThreadCount][waitHistogramBuckets];
 };
 
 DUChainLock::DUChainLock()
@@ -74,46 +349,81 @@ DUChainLock::DUChainLock()
 {
 }
 
-DUChainLock::~DUChainLock() = default;
+DUChainLock::~DUChainLock()
+{
+  if (DUCHAINLOCK().isDebugEnabled()) {
+    qCDebug(DUCHAINLOCK).noquote() << waitStatistics();
+  }
+}
 
 bool DUChainLock::lockForRead(unsigned int timeout)
 {
+  if (d->ownsSharedWriteLock()) {
+    ++d->threadState().impliedLocks;
+    return true;
+  }
+
   ///Step 1: Increase the own reader-recursion. This will make sure no further write-locks will succeed
   d->changeOwnReaderRecursion(1);
 
-  QThread* w = d->m_writer.loadAcquire();
-  if (w == nullptr || w == QThread::currentThread()) {
-    //Successful lock: Either there is no writer, or we hold the write-lock by ourselves
-  } else {
-    ///Step 2: Start spinning until there is no writer any more
+  //Recursive read-locks must never wait for writers, a waiting writer would wait for us in turn
+  if (d->ownReaderRecursion() > 1 || d->readLockAcquired(true)) {
+    return true;
+  }
 
-    QElapsedTimer t;
-    if (timeout) {
-      t.start();
+  ///Step 2: Back off and sleep until the writers are done
+
+  QElapsedTimer t;
+  t.start();
+
+  //Keep further shared writers from joining the active ones
+  d->m_waitingReaders.fetchAndAddOrdered(1);
+  auto stopWaiting = [this]() {
+    if (d->m_waitingReaders.fetchAndAddOrdered(-1) == 1) {
+      d->wakeWaiters();
     }
+  };
 
-    while (d->m_writer.loadAcquire()) {
-      if (!timeout || t.elapsed() < timeout) {
-        QThread::usleep(uSleepTime);
-      } else {
-        //Fail!
-        d->changeOwnReaderRecursion(-1);
-        return false;
-      }
+  while (true) {
+    //A writer may be waiting for the readers to go away
+    if (d->changeOwnReaderRecursion(-1) == 0) {
+      d->wakeWaiters();
+    }
+
+    const bool deferToWriters = t.elapsed() < writerPreferenceTime;
+    if (!d->waitWhile([this, deferToWriters] { return d->readLockBlocked(deferToWriters); }, timeout, t)) {
+      //Fail!
+      stopWaiting();
+      d->recordWait(ReadWait, t);
+      return false;
     }
-  }
 
-  return true;
+    d->changeOwnReaderRecursion(1);
+    if (d->readLockAcquired(t.elapsed() < writerPreferenceTime)) {
+      stopWaiting();
+      d->recordWait(ReadWait, t);
+      return true;
+    }
+  }
 }
 
 void DUChainLock::releaseReadLock()
 {
-  d->changeOwnReaderRecursion(-1);
+  if (d->ownsSharedWriteLock()) {
+    Q_ASSERT(d->threadState().impliedLocks > 0);
+    --d->threadState().impliedLocks;
+    return;
+  }
+
+  if (d->changeOwnReaderRecursion(-1) == 0) {
+    d->wakeWaiters();
+  }
 }
 
 bool DUChainLock::currentThreadHasReadLock()
 {
-  return (bool)d->ownReaderRecursion();
+  const auto& state = d->threadState();
+  return state.readerRecursion || state.sharedWriterRecursion;
 }
 
 bool DUChainLock::lockForWrite(uint timeout)
@@ -122,53 +432,62 @@ bool DUChainLock::lockForWrite(uint timeout)
 
   Q_ASSERT(d->ownReaderRecursion() == 0);
 
+  if (d->ownsSharedWriteLock()) {
+    ++d->threadState().impliedLocks;
+    return true;
+  }
+
   if (d->m_writer.load() == QThread::currentThread()) {
     //We already hold the write lock, just increase the recursion count and return
     d->m_writerRecursion.fetchAndAddRelaxed(1);
     return true;
   }
 
-  QElapsedTimer t;
-  if (timeout) {
-    t.start();
+  if (d->tryWriteLock()) {
+    return true;
   }
 
-  while (1) {
-    //Try acquiring the write-lcok
-    if (d->m_totalReaderRecursion.load() == 0 && d->m_writerRecursion.testAndSetOrdered(0, 1)) {
-      //Now we can be sure that there is no other writer, as we have increased m_writerRecursion from 0 to 1
-      d->m_writer = QThread::currentThread();
-      if (d->m_totalReaderRecursion.load() == 0) {
-        //There is still no readers, we have successfully acquired a write-lock
-        return true;
-      } else {
-        //There may be readers.. we have to continue spinning
-        d->m_writer = nullptr;
-        d->m_writerRecursion = 0;
-      }
-    }
+  QElapsedTimer t;
+  t.start();
 
-    if (!timeout || t.elapsed() < timeout) {
-      QThread::usleep(uSleepTime);
-    } else {
+  //Make new readers wait for us
+  d->m_waitingWriters.fetchAndAddOrdered(1);
+
+  bool locked = false;
+  while (!(locked = d->tryWriteLock())) {
+    if (!d->waitWhile([this] { return d->writeLockBlocked(); }, timeout, t)) {
       //Fail!
-      return false;
+      break;
     }
   }
 
-  return false;
+  if (d->m_waitingWriters.fetchAndAddOrdered(-1) == 1) {
+    //Readers may have been deferring to us
+    d->wakeWaiters();
+  }
+
+  d->recordWait(WriteWait, t);
+  return locked;
 }
 
 void DUChainLock::releaseWriteLock()
 {
   Q_ASSERT(currentThreadHasWriteLock());
 
+  if (d->m_writer.load() != QThread::currentThread()) {
+    //Implied by the shared write-lock
+    Q_ASSERT(d->threadState().impliedLocks > 0);
+    --d->threadState().impliedLocks;
+    return;
+  }
+
   //The order is important here, m_writerRecursion protects m_writer
 
   //TODO: could testAndSet here
   if (d->m_writerRecursion.load() == 1) {
-    d->m_writer = nullptr;
-    d->m_writerRecursion = 0;
+    d->m_writer.storeRelease(nullptr);
+    d->m_writerRecursion.storeRelease(0);
+    d->wakeWaiters();
   } else {
     d->m_writerRecursion.fetchAndAddOrdered(-1);
   }
@@ -176,7 +495,98 @@ void DUChainLock::releaseWriteLock()
 
 bool DUChainLock::currentThreadHasWriteLock()
 {
-  return d->m_writer.load() == QThread::currentThread();
+  return d->m_writer.load() == QThread::currentThread() || d->ownsSharedWriteLock();
+}
+
+bool DUChainLock::lockForSharedWrite(uint topContext, const QVector<uint>& importedTopContexts, unsigned int timeout)
+{
+  auto& state = d->threadState();
+
+  //Neither read- nor exclusive write-locks can be upgraded, the shared write-lock excludes them
+  Q_ASSERT(state.readerRecursion == 0);
+  Q_ASSERT(d->m_writer.load() != QThread::currentThread());
+
+  if (state.sharedWriterRecursion) {
+    //A thread builds only one top-context at a time
+    Q_ASSERT(state.sharedTopContext == topContext);
+    ++state.sharedWriterRecursion;
+    return true;
+  }
+
+  bool locked = d->trySharedWriteLock(true, topContext, importedTopContexts);
+  if (!locked) {
+    QElapsedTimer t;
+    t.start();
+
+    //Make new readers wait for us
+    d->m_waitingWriters.fetchAndAddOrdered(1);
+
+    while (!(locked = d->trySharedWriteLock(t.elapsed() < writerPreferenceTime, topContext, importedTopContexts))) {
+      const bool deferToWriters = t.elapsed() < writerPreferenceTime;
+      auto blocked = [this, deferToWriters, topContext, &importedTopContexts] {
+        if (d->sharedWriteLockBlocked(deferToWriters) || d->sharedWritersKeepReadersOut()) {
+          return true;
+        }
+        QMutexLocker lock(&d->m_sharedTopContextsMutex);
+        return d->sharedTopContextsConflict(topContext, importedTopContexts);
+      };
+      if (!d->waitWhile(blocked, timeout, t)) {
+        //Fail!
+        break;
+      }
+    }
+
+    if (d->m_waitingWriters.fetchAndAddOrdered(-1) == 1) {
+      d->wakeWaiters();
+    }
+
+    d->recordWait(SharedWriteWait, t);
+  }
+
+  if (locked) {
+    state.sharedWriterRecursion = 1;
+    state.sharedTopContext = topContext;
+    state.sharedImportedTopContexts = importedTopContexts;
+  }
+  return locked;
+}
+
+void DUChainLock::releaseSharedWriteLock()
+{
+  auto& state = d->threadState();
+  Q_ASSERT(state.sharedWriterRecursion > 0);
+
+  if (--state.sharedWriterRecursion) {
+    return;
+  }
+
+  Q_ASSERT(state.impliedLocks == 0);
+  d->releaseSharedTopContexts(state.sharedTopContext, state.sharedImportedTopContexts);
+  state.sharedTopContext = 0;
+  state.sharedImportedTopContexts.clear();
+}
+
+bool DUChainLock::currentThreadHasSharedWriteLock()
+{
+  return d->ownsSharedWriteLock();
+}
+
+QString DUChainLock::waitStatistics() const
+{
+  QString ret = QStringLiteral("duchain lock waits (bucket: upper bound in microseconds)");
+  for (int kind = 0; kind < WaitKindCount; ++kind) {
+    for (int thread = 0; thread < WaitingThreadCount; ++thread) {
+      ret += QStringLiteral("\n%1 lock, %2 threads:").arg(QLatin1String(waitKindNames[kind]),
+                                                           thread == ForegroundThread ? QStringLiteral("foreground") : QStringLiteral("background"));
+      for (int bucket = 0; bucket < waitHistogramBuckets; ++bucket) {
+        const int count = d->m_waitHistogram[kind][thread][bucket].load();
+        if (count) {
+          ret += QStringLiteral(" %1: %2").arg(bucket < waitHistogramBuckets - 1 ? QString::number(qint64(1) << bucket) : QStringLiteral("more")).arg(count);
+        }
+      }
+    }
+  }
+  return ret;
 }
 
 DUChainReadLocker::DUChainReadLocker(DUChainLock* duChainLock, uint timeout)
@@ -265,4 +675,50 @@ void DUChainWriteLocker::unlock()
   }
 }
 
+DUChainSharedWriteLocker::DUChainSharedWriteLocker(uint topContext, const QVector<uint>& importedTopContexts,
+                                                   DUChainLock* duChainLock, uint timeout)
+  : m_lock(duChainLock ? duChainLock : DUChain::lock())
+  , m_locked(false)
+  , m_timeout(timeout)
+  , m_topContext(topContext)
+  , m_importedTopContexts(importedTopContexts)
+{
+  lock();
+}
+
+DUChainSharedWriteLocker::~DUChainSharedWriteLocker()
+{
+  unlock();
+}
+
+bool DUChainSharedWriteLocker::lock()
+{
+  if (m_locked) {
+    return true;
+  }
+
+  bool l = false;
+  if (m_lock) {
+    l = m_lock->lockForSharedWrite(m_topContext, m_importedTopContexts, m_timeout);
+    Q_ASSERT(m_timeout || l);
+  };
+
+  m_locked = l;
+
+  return l;
+}
+
+bool DUChainSharedWriteLocker::locked() const
+{
+  return m_locked;
+}
+
+void DUChainSharedWriteLocker::unlock()
+{
+  if (m_locked && m_lock) {
+    m_lock->releaseSharedWriteLock();
+    m_locked = false;
+  }
+}
+
 }
@@ -21,6 +21,8 @@
 
 #include <language/languageexport.h>
 #include <QScopedPointer>
+#include <QString>
+#include <QVector>
 
 namespace KDevelop
 {
@@ -96,10 +98,52 @@ public:
   void releaseWriteLock();
 
   /**
-   * Determines if the current thread has a write lock.
+   * Determines if the current thread has a write lock. This includes the shared write-lock.
    */
   bool currentThreadHasWriteLock();
 
+  /**
+   * Acquires the shared write-lock, which is meant for building a top-context without serializing
+   * against threads that build other top-contexts.
+   *
+   * Any number of threads can hold the shared write-lock at once, but not while any thread holds
+   * a read- or an exclusive write-lock. While a thread holds it, it is also considered to hold a read-
+   * and a write-lock, and all further read- and write-locks it requests are granted immediately.
+   *
+   * The threads holding the shared write-lock may only modify @p topContext, and only read the top-contexts
+   * in @p importedTopContexts. The lock is not granted while another thread holding it builds one of these
+   * top-contexts, or imports @p topContext. The cross-file structures they touch (PersistentSymbolTable, Uses,
+   * Definitions, Importers and the importer lists of imported contexts) synchronize themselves while a shared
+   * write-lock is held.
+   *
+   * No further threads are granted the shared write-lock while readers wait for the threads holding it.
+   *
+   * \warning The shared write-lock can NOT be acquired by threads that already have a read- or write-lock.
+   * @param topContext The index of the top-context that is built
+   * @param importedTopContexts The indices of all top-contexts that @p topContext imports recursively
+   * @param timeout A timeout in milliseconds. If zero, the lock is waited for indefinitely.
+   */
+  bool lockForSharedWrite(uint topContext, const QVector<uint>& importedTopContexts, unsigned int timeout = 0);
+
+  /**
+   * Releases a previously acquired shared write-lock.
+   */
+  void releaseSharedWriteLock();
+
+  /**
+   * Determines if the current thread has the shared write-lock.
+   */
+  bool currentThreadHasSharedWriteLock();
+
+  /**
+   * Returns histograms of the time threads had to wait for this lock, separately for read and write locks
+   * requested by the foreground and by background threads. Only contended lock requests are counted.
+   *
+   * The statistics are also printed on destruction when the "kdevplatform.language.duchainlock"
+   * debug category is enabled, which additionally reports every single wait longer than 100 milliseconds.
+   */
+  QString waitStatistics() const;
+
 private:
   const QScopedPointer<class DUChainLockPrivate> d;
 };
@@ -167,6 +211,41 @@ private:
   unsigned int m_timeout;
 };
 
+/**
+ * Customized shared write locker for the definition-use chain, see DUChainLock::lockForSharedWrite().
+ */
+class KDEVPLATFORMLANGUAGE_EXPORT DUChainSharedWriteLocker
+{
+public:
+  /**
+   * Constructor.  Attempts to acquire the shared write lock.
+   *
+   * \param topContext The index of the top-context that is built
+   * \param importedTopContexts The indices of all top-contexts that @p topContext imports recursively
+   * \param duChainLock lock to acquire. If this is left zero, DUChain::lock() is used.
+   * \param timeout Timeout in milliseconds. If this is not zero, you've got to check locked() to see whether the lock succeeded.
+   */
+  DUChainSharedWriteLocker(uint topContext, const QVector<uint>& importedTopContexts,
+                           DUChainLock* duChainLock = nullptr, unsigned int timeout = 0);
+  /// Destructor.
+  ~DUChainSharedWriteLocker();
+
+  /// Acquire the shared write lock (again). Uses the same timeout given to the constructor.
+  bool lock();
+  /// Unlock the shared write lock.
+  void unlock();
+
+  ///Returns true if a lock was requested and the lock succeeded, else false
+  bool locked() const;
+
+private:
+  DUChainLock* m_lock;
+  bool m_locked;
+  unsigned int m_timeout;
+  uint m_topContext;
+  QVector<uint> m_importedTopContexts;
+};
+
 /**
  * Like the ENSURE_CHAIN_WRITE_LOCKED and .._READ_LOCKED, except that this should be used in items that can be detached from the du-chain, like DOContext's and Declarations.
  * Those items must implement an inDUChain() function that returns whether the item is in the du-chain.
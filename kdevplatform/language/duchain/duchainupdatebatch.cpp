@@ -0,0 +1,55 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "duchainupdatebatch.h"
+
+#include "definitions.h"
+#include "duchain.h"
+#include "duchainlock.h"
+#include "uses.h"
+
+#include <QThreadStorage>
+
+namespace KDevelop {
+
+namespace {
+QThreadStorage<int> batchDepth;
+}
+
+DUChainUpdateBatch::DUChainUpdateBatch()
+{
+    ++batchDepth.localData();
+}
+
+DUChainUpdateBatch::~DUChainUpdateBatch()
+{
+    Q_ASSERT(batchDepth.localData() > 0);
+    if (--batchDepth.localData()) {
+        return;
+    }
+
+    DUChainWriteLocker lock;
+    DUChain::uses()->commitBatch();
+    DUChain::definitions()->commitBatch();
+}
+
+bool DUChainUpdateBatch::isActive()
+{
+    return batchDepth.hasLocalData() && batchDepth.localData();
+}
+
+}
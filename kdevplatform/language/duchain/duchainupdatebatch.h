@@ -0,0 +1,175 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef KDEVPLATFORM_DUCHAINUPDATEBATCH_H
+#define KDEVPLATFORM_DUCHAINUPDATEBATCH_H
+
+#include <language/languageexport.h>
+
+#include <QHash>
+#include <QVector>
+
+#include <algorithm>
+
+namespace KDevelop {
+
+/**
+ * Defers the changes the current thread makes to the global Uses and Definitions until the batch ends,
+ * and then applies them in one pass.
+ *
+ * Updating a top-context adds and removes many uses and definitions, and often removes exactly what it added back before.
+ * Within a batch, changes that cancel each other never reach the repositories. The remaining changes are applied
+ * sorted by declaration, with one lock of each repository and a single repository update per declaration.
+ *
+ * Lookups from the batching thread see its pending changes, other threads only see them once the batch has ended.
+ * Batches can be nested, the changes are applied when the outermost batch ends.
+ *
+ * Changes to the PersistentSymbolTable are not deferred, as builders resolve the declarations they just created through it.
+ *
+ * @warning The batch write-locks the DUChain when it ends, so the thread must not hold a read-lock at that point.
+ */
+class KDEVPLATFORMLANGUAGE_EXPORT DUChainUpdateBatch
+{
+public:
+    DUChainUpdateBatch();
+    ~DUChainUpdateBatch();
+
+    ///@return whether the current thread is within a batch
+    static bool isActive();
+
+private:
+    Q_DISABLE_COPY(DUChainUpdateBatch)
+};
+
+/**
+ * The changes to a repository mapping keys to lists of values, that the current thread collected within a DUChainUpdateBatch.
+ * Used by the repositories internally.
+ */
+template<typename Key, typename Value>
+class PendingRepositoryChanges
+{
+public:
+    ///Maps each changed value to true if it was added, and false if it was removed
+    using Changes = QHash<Value, bool>;
+
+    void record(const Key& key, const Value& value, bool added)
+    {
+        //Adding and removing are idempotent, so only the last change of a value matters
+        m_changes[key][value] = added;
+    }
+
+    bool isEmpty() const
+    {
+        return m_changes.isEmpty();
+    }
+
+    ///Applies the pending changes of @p key to the list of its values @p values
+    template<typename List>
+    void applyTo(const Key& key, List& values) const
+    {
+        const auto it = m_changes.constFind(key);
+        if (it == m_changes.constEnd()) {
+            return;
+        }
+        for (auto change = it->constBegin(); change != it->constEnd(); ++change) {
+            const int index = values.indexOf(change.key());
+            if (change.value() && index == -1) {
+                values.append(change.key());
+            } else if (!change.value() && index != -1) {
+                values.remove(index);
+            }
+        }
+    }
+
+    ///Calls @p apply with each key and its Changes, sorted by the hash of the key, and forgets the changes
+    template<typename Apply>
+    void commit(Apply apply)
+    {
+        QVector<Key> keys;
+        keys.reserve(m_changes.size());
+        for (auto it = m_changes.constBegin(); it != m_changes.constEnd(); ++it) {
+            keys.append(it.key());
+        }
+        std::sort(keys.begin(), keys.end(), [](const Key& lhs, const Key& rhs) {
+            return lhs.hash() < rhs.hash();
+        });
+
+        for (const Key& key : keys) {
+            apply(key, m_changes.value(key));
+        }
+        m_changes.clear();
+    }
+
+    /**
+     * Applies the pending changes to @p repository and forgets them, with a single repository update per key.
+     *
+     * The repository stores an Item for each key, in its member declaration, that is created through a Request.
+     * @p listOf returns a pointer to the list of values of a temporary Item, and @p valuesOf the values of an Item
+     * in the repository as pair of their array and their count. The mutex of the repository must be locked.
+     */
+    template<typename Item, typename Request, typename Repository, typename ListOf, typename ValuesOf>
+    void commitTo(Repository& repository, ListOf listOf, ValuesOf valuesOf)
+    {
+        commit([&](const Key& key, const Changes& changes) {
+            Item item;
+            item.declaration = key;
+            Request request(item);
+            auto list = listOf(item);
+
+            bool changed = false;
+            const uint index = repository.findIndex(item);
+            if (index) {
+                //Keep the values that were not removed
+                const auto values = valuesOf(repository.itemFromIndex(index));
+                for (uint a = 0; a < values.second; ++a) {
+                    if (changes.value(values.first[a], true)) {
+                        list->append(values.first[a]);
+                    } else {
+                        changed = true;
+                    }
+                }
+            }
+
+            for (auto it = changes.constBegin(); it != changes.constEnd(); ++it) {
+                if (it.value() && !list->contains(it.key())) {
+                    list->append(it.key());
+                    changed = true;
+                }
+            }
+
+            if (!changed) {
+                return;
+            }
+
+            if (index) {
+                repository.deleteItem(index);
+            }
+
+            //This inserts the changed item
+            if (!list->isEmpty()) {
+                repository.index(request);
+            }
+        });
+    }
+
+private:
+    QHash<Key, Changes> m_changes;
+};
+
+}
+
+#endif // KDEVPLATFORM_DUCHAINUPDATEBATCH_H
@@ -22,6 +22,7 @@
 #include <limits>
 #include <algorithm>
 
+#include <QMutex>
 #include <QSet>
 
 #include "ducontextdata.h"
@@ -298,9 +299,18 @@ bool DUContextDynamicData::removeChildContext( DUContext* context ) {
   }
 }
 
+///The imported context usually belongs to another top-context, which threads holding
+///the shared write-lock may import concurrently
+static QMutex* importersListMutex()
+{
+  static QMutex mutex;
+  return DUChain::lock()->currentThreadHasSharedWriteLock() ? &mutex : nullptr;
+}
+
 void DUContextDynamicData::addImportedChildContext( DUContext * context )
 {
 //   ENSURE_CAN_WRITE
+  QMutexLocker lock(importersListMutex());
   DUContext::Import import(m_context, context);
 
   if(import.isDirect()) {
@@ -321,6 +331,7 @@ void DUContextDynamicData::addImportedChildContext( DUContext * context )
 void DUContextDynamicData::removeImportedChildContext( DUContext * context )
 {
 //   ENSURE_CAN_WRITE
+  QMutexLocker lock(importersListMutex());
   DUContext::Import import(m_context, context);
 
   if(import.isDirect()) {
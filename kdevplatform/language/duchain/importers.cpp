@@ -117,6 +117,8 @@ Importers::~Importers() = default;
 
 void Importers::addImporter(const DeclarationId& id, const IndexedDUContext& use)
 {
+  QMutexLocker lock(d->m_importers.mutex());
+
   ImportersItem item;
   item.declaration = id;
   item.importersList().append(use);
@@ -142,6 +144,8 @@ void Importers::addImporter(const DeclarationId& id, const IndexedDUContext& use
 
 void Importers::removeImporter(const DeclarationId& id, const IndexedDUContext& use)
 {
+  QMutexLocker lock(d->m_importers.mutex());
+
   ImportersItem item;
   item.declaration = id;
   ImportersRequestItem request(item);
@@ -166,6 +170,8 @@ void Importers::removeImporter(const DeclarationId& id, const IndexedDUContext&
 
 KDevVarLengthArray<IndexedDUContext> Importers::importers(const DeclarationId& id) const
 {
+  QMutexLocker lock(d->m_importers.mutex());
+
   KDevVarLengthArray<IndexedDUContext> ret;
 
   ImportersItem item;
@@ -31,6 +31,7 @@ namespace KDevelop {
 
 /**
  * Global mapping of Declaration-Ids to contexts that import the associated context, protected through DUChainLock.
+ * Each operation locks the repository by itself, see DUChainLock::lockForSharedWrite().
  * This is used as an alternative to the local importers list within DUContext, only for indirect imports(Across different files, or with templates).
  *
  * This has the advantage that imports stay valid even if the imported context is deleted temporarily, and stored top-contexts don't need to be
@@ -0,0 +1,258 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "includegraph.h"
+
+#include "appendedlist.h"
+#include <serialization/itemrepository.h>
+#include <serialization/indexedstring.h>
+#include <serialization/referencecounting.h>
+
+#include <QSet>
+
+namespace KDevelop {
+
+DEFINE_LIST_MEMBER_HASH(IncludeGraphItem, includes, IndexedString)
+DEFINE_LIST_MEMBER_HASH(IncludeGraphItem, includers, IndexedString)
+
+class IncludeGraphItem {
+  public:
+  IncludeGraphItem() {
+    initializeAppendedLists();
+  }
+  IncludeGraphItem(const IncludeGraphItem& rhs, bool dynamic = true) : file(rhs.file) {
+    initializeAppendedLists(dynamic);
+    copyListsFrom(rhs);
+  }
+
+  ~IncludeGraphItem() {
+    freeAppendedLists();
+  }
+
+  unsigned int hash() const {
+    //We only compare the file. This allows us implementing a map, although the item-repository
+    //originally represents a set.
+    return file.index();
+  }
+
+  unsigned int itemSize() const {
+    return dynamicSize();
+  }
+
+  uint classSize() const {
+    return sizeof(IncludeGraphItem);
+  }
+
+  IndexedString file;
+
+  START_APPENDED_LISTS(IncludeGraphItem);
+  APPENDED_LIST_FIRST(IncludeGraphItem, IndexedString, includes);
+  APPENDED_LIST(IncludeGraphItem, IndexedString, includers, includes);
+  END_APPENDED_LISTS(IncludeGraphItem, includers);
+};
+
+class IncludeGraphRequestItem {
+  public:
+
+  IncludeGraphRequestItem(const IncludeGraphItem& item) : m_item(item) {
+  }
+  enum {
+    AverageSize = 40 //This should be the approximate average size of an Item
+  };
+
+  unsigned int hash() const {
+    return m_item.hash();
+  }
+
+  uint itemSize() const {
+      return m_item.itemSize();
+  }
+
+  void createItem(IncludeGraphItem* item) const {
+    Q_ASSERT(shouldDoDUChainReferenceCounting(item));
+    new (item) IncludeGraphItem(m_item, false);
+  }
+
+  static void destroy(IncludeGraphItem* item, KDevelop::AbstractItemRepository&) {
+    Q_ASSERT(shouldDoDUChainReferenceCounting(item));
+    item->~IncludeGraphItem();
+  }
+
+  static bool persistent(const IncludeGraphItem* /*item*/) {
+    return true;
+  }
+
+  bool equals(const IncludeGraphItem* item) const {
+    return m_item.file == item->file;
+  }
+
+  const IncludeGraphItem& m_item;
+};
+
+class IncludeGraphPrivate
+{
+public:
+
+  IncludeGraphPrivate() : m_repository(QStringLiteral("Include Graph")) {
+  }
+
+  ///Reads the edges of @p file, both lists are empty if the file is not in the graph
+  void edges(const IndexedString& file, QVector<IndexedString>* includes, QVector<IndexedString>* includers)
+  {
+    IncludeGraphItem item;
+    item.file = file;
+
+    uint index = m_repository.findIndex(item);
+    if(!index)
+      return;
+
+    const IncludeGraphItem* repositoryItem = m_repository.itemFromIndex(index);
+    if(includes) {
+      FOREACH_FUNCTION(const IndexedString& include, repositoryItem->includes)
+        includes->append(include);
+    }
+    if(includers) {
+      FOREACH_FUNCTION(const IndexedString& includer, repositoryItem->includers)
+        includers->append(includer);
+    }
+  }
+
+  ///Replaces the edges of @p file, the item is removed once both lists are empty
+  void setEdges(const IndexedString& file, const QVector<IndexedString>& includes, const QVector<IndexedString>& includers)
+  {
+    IncludeGraphItem item;
+    item.file = file;
+    for(const IndexedString& include : includes)
+      item.includesList().append(include);
+    for(const IndexedString& includer : includers)
+      item.includersList().append(includer);
+    IncludeGraphRequestItem request(item);
+
+    uint index = m_repository.findIndex(item);
+    if(index)
+      m_repository.deleteItem(index);
+
+    //This inserts the changed item
+    if(item.includesSize() || item.includersSize())
+      m_repository.index(request);
+  }
+
+  //Maps files to the files they include, and the files they are included by
+  ItemRepository<IncludeGraphItem, IncludeGraphRequestItem> m_repository;
+};
+
+IncludeGraph::IncludeGraph() : d(new IncludeGraphPrivate())
+{
+}
+
+IncludeGraph::~IncludeGraph() = default;
+
+void IncludeGraph::setIncludes(const IndexedString& file, const QVector<IndexedString>& includes)
+{
+  QVector<IndexedString> newIncludes;
+  newIncludes.reserve(includes.size());
+  for(const IndexedString& include : includes) {
+    if(include != file && !include.isEmpty() && !newIncludes.contains(include))
+      newIncludes.append(include);
+  }
+
+  QMutexLocker lock(d->m_repository.mutex());
+
+  QVector<IndexedString> oldIncludes;
+  QVector<IndexedString> includers;
+  d->edges(file, &oldIncludes, &includers);
+
+  if(oldIncludes == newIncludes)
+    return;
+
+  d->setEdges(file, newIncludes, includers);
+
+  //Update the reverse edges of the files that were added or removed
+  for(const IndexedString& include : oldIncludes) {
+    if(newIncludes.contains(include))
+      continue;
+    QVector<IndexedString> includeIncludes;
+    QVector<IndexedString> includeIncluders;
+    d->edges(include, &includeIncludes, &includeIncluders);
+    includeIncluders.removeAll(file);
+    d->setEdges(include, includeIncludes, includeIncluders);
+  }
+
+  for(const IndexedString& include : newIncludes) {
+    if(oldIncludes.contains(include))
+      continue;
+    QVector<IndexedString> includeIncludes;
+    QVector<IndexedString> includeIncluders;
+    d->edges(include, &includeIncludes, &includeIncluders);
+    if(includeIncluders.contains(file))
+      continue;
+    includeIncluders.append(file);
+    d->setEdges(include, includeIncludes, includeIncluders);
+  }
+}
+
+QVector<IndexedString> IncludeGraph::includes(const IndexedString& file) const
+{
+  QMutexLocker lock(d->m_repository.mutex());
+
+  QVector<IndexedString> ret;
+  d->edges(file, &ret, nullptr);
+  return ret;
+}
+
+QVector<IndexedString> IncludeGraph::includers(const IndexedString& file) const
+{
+  QMutexLocker lock(d->m_repository.mutex());
+
+  QVector<IndexedString> ret;
+  d->edges(file, nullptr, &ret);
+  return ret;
+}
+
+QVector<IndexedString> IncludeGraph::transitiveIncluders(const IndexedString& file) const
+{
+  QMutexLocker lock(d->m_repository.mutex());
+
+  QVector<IndexedString> ret;
+  QSet<IndexedString> visited;
+  visited.insert(file);
+
+  d->edges(file, nullptr, &ret);
+  for(const IndexedString& includer : ret)
+    visited.insert(includer);
+
+  //The list itself is the queue of the breadth-first search
+  for(int a = 0; a < ret.size(); ++a) {
+    QVector<IndexedString> includers;
+    d->edges(ret[a], nullptr, &includers);
+    for(const IndexedString& includer : includers) {
+      if(visited.contains(includer))
+        continue;
+      visited.insert(includer);
+      ret.append(includer);
+    }
+  }
+
+  return ret;
+}
+
+IncludeGraph& IncludeGraph::self() {
+  static IncludeGraph globalIncludeGraph;
+  return globalIncludeGraph;
+}
+
+}
@@ -0,0 +1,64 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef KDEVPLATFORM_INCLUDEGRAPH_H
+#define KDEVPLATFORM_INCLUDEGRAPH_H
+
+#include <language/languageexport.h>
+
+#include <QScopedPointer>
+#include <QVector>
+
+namespace KDevelop {
+
+  class IndexedString;
+
+/**
+ * Persistent store of the files each file includes, and of the files each file is included by.
+ *
+ * The graph is maintained by the language plugins whenever a file was parsed, so the includers of a file
+ * can be found without loading any top-context, see BackgroundParser for the reparsing of dependent documents.
+ * Each operation locks the repository by itself.
+ * */
+  class KDEVPLATFORMLANGUAGE_EXPORT IncludeGraph {
+    public:
+    IncludeGraph();
+    ~IncludeGraph();
+
+    /**
+     * Replaces the files included by @p file with @p includes, and updates their includers accordingly.
+     * An empty list removes @p file from the graph, unless it is included by another file.
+     * */
+    void setIncludes(const IndexedString& file, const QVector<IndexedString>& includes);
+
+    ///The files directly included by @p file
+    QVector<IndexedString> includes(const IndexedString& file) const;
+
+    ///The files that directly include @p file
+    QVector<IndexedString> includers(const IndexedString& file) const;
+
+    ///All files that include @p file directly or indirectly, in breadth-first order, without @p file itself
+    QVector<IndexedString> transitiveIncluders(const IndexedString& file) const;
+
+    static IncludeGraph& self();
+
+    private:
+      const QScopedPointer<class IncludeGraphPrivate> d;
+  };
+}
+
+#endif
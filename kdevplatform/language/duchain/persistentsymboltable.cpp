@@ -414,6 +414,11 @@ void PersistentSymbolTable::dump(const QTextStream& out)
   }
 }
 
+QMutex* PersistentSymbolTable::mutex() const
+{
+  return d->m_declarations.mutex();
+}
+
 PersistentSymbolTable& PersistentSymbolTable::self() {
   static PersistentSymbolTable ret;
   return ret;
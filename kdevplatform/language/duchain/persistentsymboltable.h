@@ -26,6 +26,8 @@
 #include "ducontext.h"
 #include "topducontext.h"
 
+class QMutex;
+
 namespace KDevelop {
 
 class Declaration;
@@ -127,6 +129,11 @@ struct KDEVPLATFORMLANGUAGE_EXPORT RecursiveImportCacheRepository {
     ///The returned iterator is valid as long as the duchain read lock is held
     FilteredDeclarationIterator filteredDeclarations(const IndexedQualifiedIdentifier& id, const TopDUContext::IndexedRecursiveImports& visibility) const;
 
+    ///The mutex that protects the symbol table. Threads holding the shared write-lock are not excluded from each other
+    ///by the duchain lock, so they must hold this mutex as long as they use data returned by declarations() or filteredDeclarations().
+    ///@see DUChainLock::lockForSharedWrite()
+    QMutex* mutex() const;
+
     static PersistentSymbolTable& self();
 
     //Very expensive: Checks for problems in the symbol table
@@ -25,14 +25,18 @@
 
 #include <QTest>
 #include <QElapsedTimer>
+#include <QFileInfo>
 
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
 
 #include <language/duchain/duchain.h>
 #include <language/duchain/duchainlock.h>
+#include <language/duchain/duchainupdatebatch.h>
+#include <language/duchain/uses.h>
 #include <language/duchain/persistentsymboltable.h>
 #include <language/duchain/codemodel.h>
+#include <language/duchain/includegraph.h>
 #include <language/duchain/types/typesystemdata.h>
 #include <language/duchain/types/integraltype.h>
 #include <language/duchain/types/typeregister.h>
@@ -46,10 +50,14 @@
 #include <language/util/setrepository.h>
 #include <language/util/basicsetrepository.h>
 
+#include <serialization/itemrepositoryregistry.h>
+
 // #include <typeinfo>
 #include <set>
 #include <algorithm>
 #include <iterator> // needed for std::insert_iterator on windows
+#include <thread>
+#include <vector>
 #include <QThread>
 
 //Extremely slow
@@ -710,6 +718,117 @@ void TestDUChain::testLockForReadWrite()
   QVERIFY(threads.join(1000));
 }
 
+void TestDUChain::testLockForSharedWrite()
+{
+  DUChainLock lock;
+  // builds top-context 1, which imports 2
+  QVERIFY(lock.lockForSharedWrite(1, {2}));
+  QVERIFY(lock.currentThreadHasSharedWriteLock());
+  QVERIFY(lock.currentThreadHasWriteLock());
+  QVERIFY(lock.currentThreadHasReadLock());
+  {
+    // implied by the shared write-lock
+    DUChainWriteLocker writeLock(&lock, 100);
+    QVERIFY(writeLock.locked());
+    DUChainReadLocker readLock(&lock, 100);
+    QVERIFY(readLock.locked());
+  }
+
+  bool sharedWriteLocked = false;
+  bool readLocked = true;
+  bool writeLocked = true;
+  bool conflictingLocked = true;
+  std::thread other([&] {
+    sharedWriteLocked = lock.lockForSharedWrite(3, {2}, 100);
+    if (sharedWriteLocked) {
+      lock.releaseSharedWriteLock();
+    }
+    // top-context 2 is read by the other shared writer, and 1 is built by it
+    conflictingLocked = lock.lockForSharedWrite(2, {}, 100) || lock.lockForSharedWrite(4, {1}, 100);
+    readLocked = lock.lockForRead(100);
+    if (readLocked) {
+      lock.releaseReadLock();
+    }
+    writeLocked = lock.lockForWrite(100);
+    if (writeLocked) {
+      lock.releaseWriteLock();
+    }
+  });
+  other.join();
+  QVERIFY(sharedWriteLocked);
+  QVERIFY(!conflictingLocked);
+  QVERIFY(!readLocked);
+  QVERIFY(!writeLocked);
+
+  lock.releaseSharedWriteLock();
+  QVERIFY(!lock.currentThreadHasWriteLock());
+  QVERIFY(!lock.currentThreadHasReadLock());
+
+  std::thread writer([&] {
+    writeLocked = lock.lockForWrite(100);
+    if (writeLocked) {
+      lock.releaseWriteLock();
+    }
+  });
+  writer.join();
+  QVERIFY(writeLocked);
+
+  // no new shared writers join while a reader waits for the active ones
+  QVERIFY(lock.lockForSharedWrite(1, {}));
+  std::thread reader([&] {
+    readLocked = lock.lockForRead(1000);
+    if (readLocked) {
+      lock.releaseReadLock();
+    }
+  });
+  QTest::qWait(50);
+  std::thread sharedWriter([&] {
+    sharedWriteLocked = lock.lockForSharedWrite(2, {}, 100);
+    if (sharedWriteLocked) {
+      lock.releaseSharedWriteLock();
+    }
+  });
+  sharedWriter.join();
+  QVERIFY(!sharedWriteLocked);
+  lock.releaseSharedWriteLock();
+  reader.join();
+  QVERIFY(readLocked);
+}
+
+void TestDUChain::testUpdateBatch()
+{
+  const DeclarationId id(IndexedQualifiedIdentifier(QualifiedIdentifier(QStringLiteral("testUpdateBatch"))));
+  const IndexedTopDUContext first(1000);
+  const IndexedTopDUContext second(1001);
+  Uses* uses = DUChain::uses();
+
+  {
+    DUChainUpdateBatch batch;
+    uses->addUse(id, first);
+    uses->addUse(id, second);
+    uses->removeUse(id, second);
+    // the pending changes are only visible to the batching thread
+    QCOMPARE(uses->uses(id).size(), 1);
+    bool otherThreadSeesUses = true;
+    std::thread other([&] {
+      otherThreadSeesUses = uses->hasUses(id);
+    });
+    other.join();
+    QVERIFY(!otherThreadSeesUses);
+  }
+
+  const auto committed = uses->uses(id);
+  QCOMPARE(committed.size(), 1);
+  QVERIFY(committed[0] == first);
+
+  {
+    DUChainUpdateBatch batch;
+    uses->removeUse(id, first);
+    QVERIFY(!uses->hasUses(id));
+  }
+  QVERIFY(!uses->hasUses(id));
+}
+
 void TestDUChain::testProblemSerialization()
 {
   DUChain::self()->disablePersistentStorage(false);
@@ -903,6 +1022,39 @@ void TestDUChain::testImportCache()
 
 #endif
 
+void TestDUChain::testIncludeGraph()
+{
+  const IndexedString source("testIncludeGraph/source.cpp");
+  const IndexedString header("testIncludeGraph/header.h");
+  const IndexedString base("testIncludeGraph/base.h");
+  const IndexedString other("testIncludeGraph/other.h");
+
+  IncludeGraph& graph = IncludeGraph::self();
+  graph.setIncludes(source, {header, other});
+  graph.setIncludes(header, {base});
+
+  QCOMPARE(graph.includes(source), QVector<IndexedString>({header, other}));
+  QCOMPARE(graph.includers(header), QVector<IndexedString>{source});
+  QCOMPARE(graph.includers(base), QVector<IndexedString>{header});
+  QCOMPARE(graph.transitiveIncluders(base), QVector<IndexedString>({header, source}));
+
+  // a cycle doesn't end up in the result twice
+  graph.setIncludes(base, {header});
+  QCOMPARE(graph.transitiveIncluders(base), QVector<IndexedString>({header, source}));
+  graph.setIncludes(base, {});
+
+  graph.setIncludes(source, {other});
+  QVERIFY(graph.includers(header).isEmpty());
+  QCOMPARE(graph.includers(other), QVector<IndexedString>{source});
+  QCOMPARE(graph.transitiveIncluders(base), QVector<IndexedString>{header});
+
+  graph.setIncludes(source, {});
+  graph.setIncludes(header, {});
+  QVERIFY(graph.includes(source).isEmpty());
+  QVERIFY(graph.includers(other).isEmpty());
+  QVERIFY(graph.transitiveIncluders(base).isEmpty());
+}
+
 void TestDUChain::benchCodeModel()
 {
   const IndexedString file("testFile");
@@ -983,6 +1135,50 @@ void TestDUChain::benchDuchainWriteLocker()
   }
 }
 
+void TestDUChain::benchDUChainLockContention_data()
+{
+  QTest::addColumn<int>("readers");
+  QTest::addColumn<int>("writers");
+
+  QTest::newRow("8 readers") << 8 << 0;
+  QTest::newRow("8 readers, 1 writer") << 8 << 1;
+  QTest::newRow("8 readers, 4 writers") << 8 << 4;
+  QTest::newRow("32 readers, 2 writers") << 32 << 2;
+  QTest::newRow("4 writers") << 0 << 4;
+}
+
+void TestDUChain::benchDUChainLockContention()
+{
+  QFETCH(int, readers);
+  QFETCH(int, writers);
+
+  QBENCHMARK_ONCE {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i) {
+      threads.emplace_back([] {
+        for (int j = 0; j < 10000; ++j) {
+          DUChainReadLocker lock;
+          // nested read locks must never wait for pending writers
+          DUChainReadLocker nested;
+        }
+      });
+    }
+    for (int i = 0; i < writers; ++i) {
+      threads.emplace_back([] {
+        for (int j = 0; j < 1000; ++j) {
+          DUChainWriteLocker lock;
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  QVERIFY(!DUChain::lock()->currentThreadHasReadLock());
+  QVERIFY(!DUChain::lock()->currentThreadHasWriteLock());
+  qDebug() << DUChain::lock()->waitStatistics();
+}
+
 void TestDUChain::benchDUChainItemFactory_copy()
 {
   DUChainItemFactory<Declaration, DeclarationData> factory;
@@ -1030,5 +1226,79 @@ void TestDUChain::benchDeclarationQualifiedIdentifier()
   QVERIFY(count > 0);
 }
 
+void TestDUChain::benchTopContextStorage_data()
+{
+  QTest::addColumn<bool>("compressed");
+  QTest::newRow("raw") << false;
+  QTest::newRow("compressed") << true;
+}
+
+void TestDUChain::benchTopContextStorage()
+{
+  QFETCH(bool, compressed);
+
+  const int contextCount = 500;
+  const int declarationsPerContext = 20;
+
+  DUChain::self()->disablePersistentStorage(false);
+  const bool wasCompressed = DUChain::self()->compressedStorage();
+  DUChain::self()->setCompressedStorage(compressed);
+
+  const IndexedString url(QStringLiteral("/bench/storage.cpp"));
+  uint topIndex = 0;
+  {
+    DUChainWriteLocker lock;
+    auto file = new ParsingEnvironmentFile(url);
+    auto top = new TopDUContext(url, RangeInRevision(0, 0, contextCount * declarationsPerContext, 0), file);
+    DUChain::self()->addDocumentChain(top);
+    topIndex = top->ownIndex();
+
+    for (int i = 0; i < contextCount; ++i) {
+      const int line = i * declarationsPerContext;
+      auto ctx = new DUContext(RangeInRevision(line, 0, line + declarationsPerContext - 1, 0), top);
+      ctx->setLocalScopeIdentifier(QualifiedIdentifier(QStringLiteral("scope%1").arg(i)));
+      for (int j = 0; j < declarationsPerContext; ++j) {
+        auto decl = new Declaration(RangeInRevision(line + j, 0, line + j, 10), ctx);
+        decl->setIdentifier(Identifier(QStringLiteral("declaration%1").arg(j)));
+        decl->setAbstractType(AbstractType::Ptr(new IntegralType(IntegralType::TypeInt)));
+      }
+    }
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  // stores the new top-context and unloads it, as it is not referenced
+  DUChain::self()->storeToDisk();
+  const qint64 storeTime = timer.elapsed();
+
+  const QFileInfo storedFile(globalItemRepositoryRegistry().path() + QLatin1String("/topcontexts/") + QString::number(topIndex));
+  QVERIFY(storedFile.exists());
+
+  const auto statistics = DUChain::self()->lastStoreStatistics();
+  QVERIFY(statistics.storedTopContexts >= 1);
+  QVERIFY(statistics.bytesWritten >= storedFile.size());
+  QVERIFY(statistics.snapshotTime <= statistics.flushTime);
+
+  int declarationCount = 0;
+  timer.restart();
+  {
+    DUChainWriteLocker lock;
+    auto top = DUChain::self()->chainForDocument(url);
+    QVERIFY(top);
+    foreach (DUContext* ctx, top->childContexts()) {
+      declarationCount += ctx->localDeclarations().size();
+    }
+    const qint64 loadTime = timer.elapsed();
+    qDebug() << (compressed ? "compressed:" : "raw:") << storedFile.size() << "bytes on disk, stored in"
+             << storeTime << "ms (" << statistics.snapshotTime << "ms locked), loaded in" << loadTime << "ms";
+
+    DUChain::self()->removeDocumentChain(top);
+  }
+  QCOMPARE(declarationCount, contextCount * declarationsPerContext);
+
+  DUChain::self()->setCompressedStorage(wasCompressed);
+  DUChain::self()->disablePersistentStorage(true);
+}
+
 #include "test_duchain.moc"
 #include "moc_test_duchain.cpp"
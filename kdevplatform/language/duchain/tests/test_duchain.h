@@ -44,8 +44,11 @@ private Q_SLOTS:
     void testLockForWrite();
     void testLockForRead();
     void testLockForReadWrite();
+    void testLockForSharedWrite();
+    void testUpdateBatch();
     void testProblemSerialization();
     void testIdentifiers();
+    void testIncludeGraph();
     ///NOTE: these are not "automated"!
 //     void testImportCache();
 
@@ -54,9 +57,13 @@ private Q_SLOTS:
     void benchTypeRegistry_data();
     void benchDuchainWriteLocker();
     void benchDuchainReadLocker();
+    void benchDUChainLockContention_data();
+    void benchDUChainLockContention();
     void benchDUChainItemFactory_copy();
     void benchDUChainItemFactory_copy_data();
     void benchDeclarationQualifiedIdentifier();
+    void benchTopContextStorage_data();
+    void benchTopContextStorage();
 };
 
 #endif // KDEVPLATFORM_TEST_DUCHAIN_H
@@ -623,6 +623,13 @@ void TopDUContext::setParsingEnvironmentFile(ParsingEnvironmentFile* file)
   }
 }
 
+///Threads holding the shared write-lock may modify the symbol table concurrently,
+///so they have to keep it locked while iterating its data. Everybody else is protected by the duchain lock.
+static QMutex* symbolTableIterationMutex()
+{
+  return DUChain::lock()->currentThreadHasSharedWriteLock() ? PersistentSymbolTable::self().mutex() : nullptr;
+}
+
 struct TopDUContext::FindDeclarationsAcceptor {
   FindDeclarationsAcceptor(const TopDUContext* _top, DeclarationList& _target, const DeclarationChecker& _check, SearchFlags _flags) : top(_top), target(_target), check(_check) {
     flags = _flags;
@@ -641,6 +648,8 @@ struct TopDUContext::FindDeclarationsAcceptor {
 
     //This is used if filtering is disabled
     PersistentSymbolTable::Declarations::Iterator unchecked;
+
+    QMutexLocker symbolTableLock(symbolTableIterationMutex());
     if(check.flags & DUContext::NoImportsCheck) {
       allDecls = PersistentSymbolTable::self().declarations(id);
       unchecked = allDecls.iterator();
@@ -763,6 +772,7 @@ bool TopDUContext::applyAliases( const QualifiedIdentifier& previous, const Sear
 #endif
 
     if(aliasId.inRepository()) {
+      QMutexLocker symbolTableLock(symbolTableIterationMutex());
     //This iterator efficiently filters the visible declarations out of all declarations
       PersistentSymbolTable::FilteredDeclarationIterator filter = PersistentSymbolTable::self().filteredDeclarations(aliasId, recursiveImportIndices());
 
@@ -844,6 +854,7 @@ bool TopDUContext::applyAliases( const QualifiedIdentifier& previous, const Sear
 #endif
 
     if(importId.inRepository()) {
+      QMutexLocker symbolTableLock(symbolTableIterationMutex());
       //This iterator efficiently filters the visible declarations out of all declarations
       PersistentSymbolTable::FilteredDeclarationIterator filter = PersistentSymbolTable::self().filteredDeclarations(importId, recursiveImportIndices());
 
@@ -23,6 +23,12 @@
 #include <typeinfo>
 #include <QFile>
 #include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include "declaration.h"
 #include "declarationdata.h"
@@ -44,6 +50,42 @@ using namespace KDevelop;
 
 namespace {
 
+///Uncompressed top-context files start with the size of the top-context data, which is always smaller than this.
+///Compressed files start with this value followed by that size. The lowest byte is the version of the compressed format.
+const uint compressedFormatMagic = 0xffffff01;
+
+///Minimum size of the arrays the data is stored in. In the compressed format every array is compressed separately,
+///so this is also the granularity of the decompression on demand.
+const uint dataArraySize = 10000;
+const uint compressedDataArraySize = 64 * 1024;
+
+///zlib compression level, the top-contexts are stored often, so it should be fast
+const int compressionLevel = 1;
+
+bool storeCompressed = qEnvironmentVariableIsSet("KDEV_DUCHAIN_COMPRESS");
+
+uint newDataArraySize(uint minimumSize)
+{
+  return std::max(minimumSize, storeCompressed ? compressedDataArraySize : dataArraySize);
+}
+
+///Reads the header of a top-context file
+///@param compressed is set to whether the file has the compressed format
+///@return the size of the top-context data that follows the header
+uint readTopContextDataSize(QFile* file, bool* compressed = nullptr)
+{
+  uint readValue = 0;
+  file->read((char*)&readValue, sizeof(uint));
+  const bool isCompressed = readValue == compressedFormatMagic;
+  if (isCompressed) {
+    file->read((char*)&readValue, sizeof(uint));
+  }
+  if (compressed) {
+    *compressed = isCompressed;
+  }
+  return readValue;
+}
+
 /**
  * Serialize @p item into @p data and update @p totalDataOffset.
  *
@@ -67,7 +109,7 @@ void saveDUChainItem(QVector<TopDUContextDynamicData::ArrayWithPosition>& data,
 
   if(data.back().array.size() - int(data.back().position) < size)
       //Create a new data item
-      data.append({QByteArray(size > 10000 ? size : 10000, 0), 0u});
+      data.append({QByteArray(newDataArraySize(size), 0), 0u});
 
   uint pos = data.back().position;
   data.back().position += size;
@@ -166,6 +208,179 @@ QString pathForTopContext(const uint topContextIndex)
   return basePath() + QString::number(topContextIndex);
 }
 
+///The serialized state of a top-context that still has to be written to its file
+struct TopContextFileWrite
+{
+  ///Everything in front of the content data: the format header, the top-context data and the item offsets
+  QByteArray header;
+  QVector<TopDUContextDynamicData::ArrayWithPosition> data;
+  bool compressed = false;
+};
+
+///@return the size of the written file, or -1 if the file could not be written
+qint64 writeTopContextFile(const QString& path, const TopContextFileWrite& write)
+{
+  //Keep the previous file, so it can be restored if the application crashes before the repositories are consistent again
+  globalItemRepositoryRegistry().journalFile(path);
+
+  QFile file(path);
+  if(!file.open(QIODevice::WriteOnly)) {
+    qCWarning(LANGUAGE) << "Cannot open top-context for writing";
+    return -1;
+  }
+
+  file.resize(0);
+  file.write(write.header);
+
+  if(write.compressed) {
+    //The top-context data and the offsets stay uncompressed, they are needed for every load.
+    //The content data is stored as a table of sections followed by the compressed sections.
+    QVector<QByteArray> sections;
+    sections.reserve(write.data.size());
+    foreach(const TopDUContextDynamicData::ArrayWithPosition& pos, write.data)
+      sections << qCompress(reinterpret_cast<const uchar*>(pos.array.constData()), pos.position, compressionLevel);
+
+    const uint sectionCount = sections.size();
+    file.write((char*)&sectionCount, sizeof(uint));
+    for(uint a = 0; a < sectionCount; ++a) {
+      const uint compressedSize = sections[a].size();
+      file.write((char*)&write.data[a].position, sizeof(uint));
+      file.write((char*)&compressedSize, sizeof(uint));
+    }
+    foreach(const QByteArray& section, sections)
+      file.write(section);
+  } else {
+    foreach(const TopDUContextDynamicData::ArrayWithPosition& pos, write.data)
+      file.write(pos.array.constData(), pos.position);
+  }
+
+  file.flush();
+  if(file.error() != QFileDevice::NoError) {
+    qCWarning(LANGUAGE) << "Failed to write top-context" << path << file.errorString();
+    return -1;
+  }
+
+  const qint64 size = file.size();
+  if (size == 0) {
+    qCWarning(LANGUAGE) << "Saving zero size top ducontext data";
+  }
+  return size;
+}
+
+/**
+ * Writes the files of stored top-contexts on a thread pool, so the duchain lock
+ * is only held while the top-contexts are serialized.
+ *
+ * At most one write per top-context is in flight, and the file of a top-context
+ * is only accessed again once its write has finished. The outcome of each write
+ * is kept until the owning top-context collects it with takeResult().
+ */
+class TopContextStoreQueue
+{
+public:
+  void enqueue(uint topContextIndex, const QString& path, const TopContextFileWrite& write)
+  {
+    QMutexLocker lock(&m_mutex);
+    //Keep the writes of the same top-context in order
+    while(m_pending.contains(topContextIndex))
+      m_finished.wait(&m_mutex);
+    m_pending.insert(topContextIndex);
+    m_results.remove(topContextIndex);
+    lock.unlock();
+
+    m_pool.start(new Writer(this, topContextIndex, path, write));
+  }
+
+  void waitFor(uint topContextIndex)
+  {
+    QMutexLocker lock(&m_mutex);
+    while(m_pending.contains(topContextIndex))
+      m_finished.wait(&m_mutex);
+  }
+
+  /**
+   * Collects the outcome of the last write of the given top-context.
+   * @return false if the write is still in flight, or if there is no outcome to collect
+   */
+  bool takeResult(uint topContextIndex, bool* success)
+  {
+    QMutexLocker lock(&m_mutex);
+    auto it = m_results.find(topContextIndex);
+    if(it == m_results.end())
+      return false;
+    *success = *it;
+    m_results.erase(it);
+    return true;
+  }
+
+  void waitForAll()
+  {
+    QMutexLocker lock(&m_mutex);
+    while(!m_pending.isEmpty())
+      m_finished.wait(&m_mutex);
+  }
+
+  void takeStatistics(int* storedCount, qint64* bytesWritten)
+  {
+    QMutexLocker lock(&m_mutex);
+    *storedCount = m_storedCount;
+    *bytesWritten = m_bytesWritten;
+    m_storedCount = 0;
+    m_bytesWritten = 0;
+  }
+
+private:
+  class Writer : public QRunnable
+  {
+  public:
+    Writer(TopContextStoreQueue* queue, uint topContextIndex, const QString& path, const TopContextFileWrite& write)
+      : m_queue(queue), m_topContextIndex(topContextIndex), m_path(path), m_write(write)
+    {
+    }
+
+    void run() override
+    {
+      const qint64 bytesWritten = writeTopContextFile(m_path, m_write);
+      //Release the data before the top-context may be changed again
+      m_write = TopContextFileWrite();
+      m_queue->finished(m_topContextIndex, bytesWritten);
+    }
+
+  private:
+    TopContextStoreQueue* const m_queue;
+    const uint m_topContextIndex;
+    const QString m_path;
+    TopContextFileWrite m_write;
+  };
+
+  void finished(uint topContextIndex, qint64 bytesWritten)
+  {
+    QMutexLocker lock(&m_mutex);
+    m_pending.remove(topContextIndex);
+    m_results.insert(topContextIndex, bytesWritten >= 0);
+    if(bytesWritten >= 0) {
+      ++m_storedCount;
+      m_bytesWritten += bytesWritten;
+    }
+    m_finished.wakeAll();
+  }
+
+  QMutex m_mutex;
+  QWaitCondition m_finished;
+  QSet<uint> m_pending;
+  QHash<uint, bool> m_results;
+  int m_storedCount = 0;
+  qint64 m_bytesWritten = 0;
+  //Declared last, so it is destroyed first and waits for the writers while the members above still exist
+  QThreadPool m_pool;
+};
+
+TopContextStoreQueue& topContextStoreQueue()
+{
+  static TopContextStoreQueue queue;
+  return queue;
+}
+
 enum LoadType {
   PartialLoad, ///< Only load the direct member data
   FullLoad     ///< Load everything, including appended lists
@@ -173,14 +388,13 @@ enum LoadType {
 template<typename F>
 void loadTopDUContextData(const uint topContextIndex, LoadType loadType, F callback)
 {
+  topContextStoreQueue().waitFor(topContextIndex);
   QFile file(pathForTopContext(topContextIndex));
   if (!file.open(QIODevice::ReadOnly)) {
     return;
   }
 
-  uint readValue;
-  file.read((char*)&readValue, sizeof(uint));
-  // now readValue is filled with the top-context data size
+  const uint readValue = readTopContextDataSize(&file);
   Q_ASSERT(readValue >= sizeof(TopDUContextData));
   const QByteArray data = file.read(loadType == FullLoad ? readValue : sizeof(TopDUContextData));
   const TopDUContextData* topData = reinterpret_cast<const TopDUContextData*>(data.constData());
@@ -448,15 +662,18 @@ void TopDUContextDynamicData::DUChainItemStorage<Item>::loadData(QFile* file) co
 }
 
 template<class Item>
-void TopDUContextDynamicData::DUChainItemStorage<Item>::writeData(QFile* file)
+void TopDUContextDynamicData::DUChainItemStorage<Item>::writeData(QByteArray* target)
 {
   uint writeValue = offsets.size();
-  file->write((char*)&writeValue, sizeof(uint));
-  file->write((char*)offsets.data(), sizeof(ItemDataInfo) * offsets.size());
+  target->append((char*)&writeValue, sizeof(uint));
+  target->append((char*)offsets.constData(), sizeof(ItemDataInfo) * offsets.size());
 }
 
 //END DUChainItemStorage
 
+//Protects the decompression on demand, items may be loaded from multiple threads at the same time
+static QMutex decompressionMutex;
+
 const char* TopDUContextDynamicData::pointerInData(uint totalOffset) const
 {
   Q_ASSERT(!m_mappedData || m_data.isEmpty());
@@ -464,9 +681,56 @@ const char* TopDUContextDynamicData::pointerInData(uint totalOffset) const
   if(m_mappedData && m_mappedDataSize)
     return (char*)m_mappedData + totalOffset;
 
+  if(!m_compressedSections.isEmpty()) {
+    QMutexLocker lock(&decompressionMutex);
+    uint sectionOffset = totalOffset;
+    for(int a = 0; a < m_data.size() && a < m_compressedSections.size(); ++a) {
+      if(sectionOffset < m_data[a].position) {
+        if(m_data[a].array.isEmpty()) {
+          m_data[a].array = qUncompress(m_compressedSections[a]);
+          Q_ASSERT(uint(m_data[a].array.size()) >= m_data[a].position);
+          m_compressedSections[a].clear();
+        }
+        break;
+      }
+      sectionOffset -= m_data[a].position;
+    }
+    return ::pointerInData(m_data, totalOffset);
+  }
+
   return ::pointerInData(m_data, totalOffset);
 }
 
+void TopDUContextDynamicData::decompressAllSections() const
+{
+  QMutexLocker lock(&decompressionMutex);
+  for(int a = 0; a < m_compressedSections.size(); ++a) {
+    if(m_data[a].array.isEmpty())
+      m_data[a].array = qUncompress(m_compressedSections[a]);
+  }
+  m_compressedSections.clear();
+}
+
+void TopDUContextDynamicData::setCompressionEnabled(bool enabled)
+{
+  storeCompressed = enabled;
+}
+
+bool TopDUContextDynamicData::compressionEnabled()
+{
+  return storeCompressed;
+}
+
+void TopDUContextDynamicData::waitForStores()
+{
+  topContextStoreQueue().waitForAll();
+}
+
+void TopDUContextDynamicData::takeStoreStatistics(int* storedCount, qint64* bytesWritten)
+{
+  topContextStoreQueue().takeStatistics(storedCount, bytesWritten);
+}
+
 TopDUContextDynamicData::TopDUContextDynamicData(TopDUContext* topContext)
   : m_deleting(false)
   , m_topContext(topContext)
@@ -474,6 +738,7 @@ TopDUContextDynamicData::TopDUContextDynamicData(TopDUContext* topContext)
   , m_declarations(this)
   , m_problems(this)
   , m_onDisk(false)
+  , m_storePending(false)
   , m_dataLoaded(true)
   , m_mappedFile(nullptr)
   , m_mappedData(nullptr)
@@ -503,6 +768,7 @@ void KDevelop::TopDUContextDynamicData::unmap() {
 
 bool TopDUContextDynamicData::fileExists(uint topContextIndex)
 {
+  topContextStoreQueue().waitFor(topContextIndex);
   return QFile::exists(pathForTopContext(topContextIndex));
 }
 
@@ -545,6 +811,8 @@ void TopDUContextDynamicData::loadData() const {
   Q_ASSERT(!m_dataLoaded);
   Q_ASSERT(m_data.isEmpty());
 
+  topContextStoreQueue().waitFor(m_topContext->ownIndex());
+
   QFile* file = new QFile(pathForTopContext(m_topContext->ownIndex()));
   bool open = file->open(QIODevice::ReadOnly);
   Q_UNUSED(open);
@@ -553,14 +821,33 @@ void TopDUContextDynamicData::loadData() const {
 
   //Skip the offsets, we're already read them
   //Skip top-context data
-  uint readValue;
-  file->read((char*)&readValue, sizeof(uint));
+  bool compressed = false;
+  const uint readValue = readTopContextDataSize(file, &compressed);
   file->seek(readValue + file->pos());
 
   m_contexts.loadData(file);
   m_declarations.loadData(file);
   m_problems.loadData(file);
 
+  if(compressed) {
+    //Only read the compressed sections, they are decompressed on demand in pointerInData()
+    uint sectionCount = 0;
+    file->read((char*)&sectionCount, sizeof(uint));
+    QVector<uint> compressedSizes(sectionCount);
+    m_data.resize(sectionCount);
+    for(uint a = 0; a < sectionCount; ++a) {
+      file->read((char*)&m_data[a].position, sizeof(uint));
+      file->read((char*)&compressedSizes[a], sizeof(uint));
+    }
+    m_compressedSections.resize(sectionCount);
+    for(uint a = 0; a < sectionCount; ++a)
+      m_compressedSections[a] = file->read(compressedSizes[a]);
+
+    delete file;
+    m_dataLoaded = true;
+    return;
+  }
+
 #ifdef USE_MMAP
 
   m_mappedData = file->map(file->pos(), file->size() - file->pos());
@@ -584,6 +871,7 @@ void TopDUContextDynamicData::loadData() const {
 }
 
 TopDUContext* TopDUContextDynamicData::load(uint topContextIndex) {
+  topContextStoreQueue().waitFor(topContextIndex);
   QFile file(pathForTopContext(topContextIndex));
   if(file.open(QIODevice::ReadOnly)) {
     if(file.size() == 0) {
@@ -591,9 +879,7 @@ TopDUContext* TopDUContextDynamicData::load(uint topContextIndex) {
       return nullptr;
     }
 
-    uint readValue;
-    file.read((char*)&readValue, sizeof(uint));
-    //now readValue is filled with the top-context data size
+    const uint readValue = readTopContextDataSize(&file);
     QByteArray topContextData = file.read(readValue);
 
     DUChainBaseData* topData = reinterpret_cast<DUChainBaseData*>(topContextData.data());
@@ -608,6 +894,8 @@ TopDUContext* TopDUContextDynamicData::load(uint topContextIndex) {
     target.m_data.clear();
     target.m_dataLoaded = false;
     target.m_onDisk = true;
+    bool success;
+    topContextStoreQueue().takeResult(topContextIndex, &success); //The outcome of an earlier write is stale now
     ret->rebuildDynamicData(nullptr, topContextIndex);
     target.m_topContextData.append({topContextData, (uint)0});
     return ret;
@@ -616,7 +904,26 @@ TopDUContext* TopDUContextDynamicData::load(uint topContextIndex) {
   }
 }
 
+void TopDUContextDynamicData::collectStoreResult(bool wait) const {
+  if(!m_storePending)
+    return;
+
+  const uint index = m_topContext->ownIndex();
+  if(wait)
+    topContextStoreQueue().waitFor(index);
+
+  bool success;
+  if(!topContextStoreQueue().takeResult(index, &success))
+    return;
+
+  m_storePending = false;
+  m_onDisk = success;
+  if(!success)
+    qCWarning(LANGUAGE) << "Storing top-context" << index << "failed, it will be stored again";
+}
+
 bool TopDUContextDynamicData::isOnDisk() const {
+  collectStoreResult(true);
   return m_onDisk;
 }
 
@@ -636,7 +943,8 @@ void TopDUContextDynamicData::deleteOnDisk() {
 
   m_onDisk = false;
 
-  bool successfullyRemoved = QFile::remove(filePath());
+  topContextStoreQueue().waitFor(m_topContext->ownIndex());
+  bool successfullyRemoved = globalItemRepositoryRegistry().journalFile(filePath()) || QFile::remove(filePath());
   Q_UNUSED(successfullyRemoved);
   Q_ASSERT(successfullyRemoved);
   qCDebug(LANGUAGE) << "deletion ready";
@@ -648,7 +956,9 @@ QString KDevelop::TopDUContextDynamicData::filePath() const {
 
 bool TopDUContextDynamicData::hasChanged() const
 {
-  return !m_onDisk || m_topContext->d_func()->m_dynamic
+  //A write that is still in flight already contains the current state
+  collectStoreResult(false);
+  return (!m_onDisk && !m_storePending) || m_topContext->d_func()->m_dynamic
         || m_contexts.itemsHaveChanged() || m_declarations.itemsHaveChanged()
         || m_problems.itemsHaveChanged();
 }
@@ -668,6 +978,9 @@ void TopDUContextDynamicData::store() {
   if(!m_dataLoaded)
     loadData();
 
+  //The old data is copied over, and the file is overwritten
+  decompressAllSections();
+
   ///If the data is mapped, and we re-write the file, we must make sure that the data is copied out of the map,
   ///even if only metadata is changed.
   ///@todo If we split up data and metadata, we don't need to do this
@@ -696,7 +1009,11 @@ void TopDUContextDynamicData::store() {
         newDataSize += array.position;
     }
 
-    newDataSize = std::max(newDataSize, 10000u);
+    newDataSize = std::max(newDataSize, dataArraySize);
+    if(storeCompressed) {
+      //Keep the arrays small, they are the sections that are decompressed on demand
+      newDataSize = std::min(newDataSize, compressedDataArraySize);
+    }
 
     //We always put 1 byte to the front, so we don't have zero data-offsets, since those are used for "invalid".
     uint currentDataOffset = 1;
@@ -720,31 +1037,28 @@ void TopDUContextDynamicData::store() {
 
     QDir().mkpath(basePath());
 
-    QFile file(filePath());
-    if(file.open(QIODevice::WriteOnly)) {
-
-      file.resize(0);
+    //Only the serialization needs the duchain lock, the file is written in the background.
+    //The arrays in m_data are implicitly shared with the pending write, and are only ever replaced, never modified in place.
+    TopContextFileWrite write;
+    write.compressed = storeCompressed;
+    if(write.compressed)
+      write.header.append((char*)&compressedFormatMagic, sizeof(uint));
 
-      file.write((char*)&topContextDataSize, sizeof(uint));
-      foreach(const ArrayWithPosition& pos, m_topContextData)
-        file.write(pos.array.constData(), pos.position);
+    write.header.append((char*)&topContextDataSize, sizeof(uint));
+    foreach(const ArrayWithPosition& pos, m_topContextData)
+      write.header.append(pos.array.constData(), pos.position);
 
-      m_contexts.writeData(&file);
-      m_declarations.writeData(&file);
-      m_problems.writeData(&file);
+    m_contexts.writeData(&write.header);
+    m_declarations.writeData(&write.header);
+    m_problems.writeData(&write.header);
 
-      foreach(const ArrayWithPosition& pos, m_data)
-        file.write(pos.array.constData(), pos.position);
+    write.data = m_data;
 
-      m_onDisk = true;
+    topContextStoreQueue().enqueue(m_topContext->ownIndex(), filePath(), write);
 
-      if (file.size() == 0) {
-        qCWarning(LANGUAGE) << "Saving zero size top ducontext data";
-      }
-      file.close();
-    } else {
-      qCWarning(LANGUAGE) << "Cannot open top-context for writing";
-    }
+    //The file only counts as stored once the write has succeeded, see collectStoreResult()
+    m_onDisk = false;
+    m_storePending = true;
 //   qCDebug(LANGUAGE) << "stored" << m_topContext->url().str() << m_topContext->ownIndex() << "import-count:" << m_topContext->importedParentContexts().size();
 }
 
@@ -756,7 +1070,7 @@ TopDUContextDynamicData::ItemDataInfo TopDUContextDynamicData::writeDataInfo(con
 
   if(m_data.back().array.size() - m_data.back().position < size) {
       //Create a new m_data item
-      m_data.append({QByteArray(std::max(size, 10000u), 0), 0u});
+      m_data.append({QByteArray(newDataArraySize(size), 0), 0u});
   }
 
   ret.dataOffset = totalDataOffset;
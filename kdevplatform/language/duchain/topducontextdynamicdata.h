@@ -85,7 +85,8 @@ class TopDUContextDynamicData {
   ///Stores all remainings of this top-context that are on disk. The top-context will be fully dynamic after this.
   void deleteOnDisk();
   
-  ///Whether this top-context is on disk(Either has been loaded, or has been stored)
+  ///Whether this top-context is on disk(Either has been loaded, or has been stored successfully).
+  ///If the top-context is still being written, this waits for the write to finish.
   bool isOnDisk() const;
   
   ///Loads the top-context from disk, or returns zero on failure. The top-context will not be registered anywhere, and will have no ParsingEnvironmentFile assigned.
@@ -102,6 +103,20 @@ class TopDUContextDynamicData {
   
   static QList<IndexedDUContext> loadImports(uint topContextIndex);
 
+  ///Whether store() writes the compressed format. Both formats can always be loaded.
+  static void setCompressionEnabled(bool enabled);
+  static bool compressionEnabled();
+
+  /**
+   * store() only serializes the top-context, the file is written in the background.
+   * This blocks until all files of previously stored top-contexts have been written.
+   * Files of single top-contexts are waited for automatically when they are loaded or deleted.
+   */
+  static void waitForStores();
+
+  ///Returns how many top-context files and bytes were written in the background since the last call.
+  static void takeStoreStatistics(int* storedCount, qint64* bytesWritten);
+
   bool isTemporaryContextIndex(uint index) const;
   bool isTemporaryDeclarationIndex(uint index) const ;
   
@@ -120,6 +135,8 @@ class TopDUContextDynamicData {
 
   private:
     bool hasChanged() const;
+    ///Picks up the outcome of a pending background write of this top-context, optionally waiting for it
+    void collectStoreResult(bool wait) const;
 
     void unmap();
     //Converts away from an mmap opened file to a data array
@@ -130,6 +147,9 @@ class TopDUContextDynamicData {
 
     const char* pointerInData(uint offset) const;
 
+    ///Decompresses all sections of m_data that were loaded in the compressed format
+    void decompressAllSections() const;
+
     ItemDataInfo writeDataInfo(const ItemDataInfo& info, const DUChainBaseData* data, uint& totalDataOffset);
 
     TopDUContext* m_topContext;
@@ -154,7 +174,7 @@ class TopDUContextDynamicData {
       bool isItemForIndexLoaded(uint index) const;
 
       void loadData(QFile* file) const;
-      void writeData(QFile* file);
+      void writeData(QByteArray* target);
 
       //May contain zero items if they were deleted
       mutable QVector<Item> items;
@@ -170,8 +190,14 @@ class TopDUContextDynamicData {
     //For temporary declarations that will not be stored to disk, like template instantiations
 
     mutable QVector<ArrayWithPosition> m_data;
+    //When loaded in the compressed format, the compressed content of the m_data entries that have not been needed yet.
+    //Those are decompressed on demand, until then their array is empty while their position is already valid.
+    mutable QVector<QByteArray> m_compressedSections;
     mutable QVector<ArrayWithPosition> m_topContextData;
-    bool m_onDisk;
+    //Only true once the file has been written successfully
+    mutable bool m_onDisk;
+    //Whether a background write of this top-context has not been collected yet
+    mutable bool m_storePending;
     mutable bool m_dataLoaded;
 
     mutable QFile* m_mappedFile;
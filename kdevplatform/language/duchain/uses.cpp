@@ -19,10 +19,13 @@
 #include "uses.h"
 
 #include "declarationid.h"
+#include "duchainupdatebatch.h"
 #include "duchainpointer.h"
 #include "serialization/itemrepository.h"
 #include "topducontext.h"
 
+#include <QThreadStorage>
+
 namespace KDevelop {
 
 DEFINE_LIST_MEMBER_HASH(UsesItem, uses, IndexedTopDUContext)
@@ -107,6 +110,8 @@ public:
   }
   //Maps declaration-ids to Uses
   ItemRepository<UsesItem, UsesRequestItem> m_uses;
+  //Changes deferred by a DUChainUpdateBatch
+  QThreadStorage<PendingRepositoryChanges<DeclarationId, IndexedTopDUContext>> m_pending;
 };
 
 Uses::Uses() : d(new UsesPrivate())
@@ -117,6 +122,13 @@ Uses::~Uses() = default;
 
 void Uses::addUse(const DeclarationId& id, const IndexedTopDUContext& use)
 {
+  if(DUChainUpdateBatch::isActive()) {
+    d->m_pending.localData().record(id, use, true);
+    return;
+  }
+
+  QMutexLocker lock(d->m_uses.mutex());
+
   UsesItem item;
   item.declaration = id;
   item.usesList().append(use);
@@ -142,6 +154,13 @@ void Uses::addUse(const DeclarationId& id, const IndexedTopDUContext& use)
 
 void Uses::removeUse(const DeclarationId& id, const IndexedTopDUContext& use)
 {
+  if(DUChainUpdateBatch::isActive()) {
+    d->m_pending.localData().record(id, use, false);
+    return;
+  }
+
+  QMutexLocker lock(d->m_uses.mutex());
+
   UsesItem item;
   item.declaration = id;
   UsesRequestItem request(item);
@@ -166,6 +185,11 @@ void Uses::removeUse(const DeclarationId& id, const IndexedTopDUContext& use)
 
 bool Uses::hasUses(const DeclarationId& id) const
 {
+  if(DUChainUpdateBatch::isActive() && !d->m_pending.localData().isEmpty())
+    return !uses(id).isEmpty();
+
+  QMutexLocker lock(d->m_uses.mutex());
+
   UsesItem item;
   item.declaration = id;
   return (bool) d->m_uses.findIndex(item);
@@ -173,6 +197,8 @@ bool Uses::hasUses(const DeclarationId& id) const
 
 KDevVarLengthArray<IndexedTopDUContext> Uses::uses(const DeclarationId& id) const
 {
+  QMutexLocker lock(d->m_uses.mutex());
+
   KDevVarLengthArray<IndexedTopDUContext> ret;
 
   UsesItem item;
@@ -186,9 +212,25 @@ KDevVarLengthArray<IndexedTopDUContext> Uses::uses(const DeclarationId& id) cons
     FOREACH_FUNCTION(const IndexedTopDUContext& decl, repositoryItem->uses)
       ret.append(decl);
   }
+
+  if(DUChainUpdateBatch::isActive())
+    d->m_pending.localData().applyTo(id, ret);
   
   return ret;
 }
 
+void Uses::commitBatch()
+{
+  auto& pending = d->m_pending.localData();
+  if(pending.isEmpty())
+    return;
+
+  QMutexLocker lock(d->m_uses.mutex());
+
+  pending.commitTo<UsesItem, UsesRequestItem>(d->m_uses,
+    [](UsesItem& item) { return &item.usesList(); },
+    [](const UsesItem* item) { return qMakePair(item->uses(), item->usesSize()); });
+}
+
 
 }
@@ -31,6 +31,7 @@ namespace KDevelop {
 
 /**
  * Global mapping of Declaration-Ids to top-contexts, protected through DUChainLock.
+ * The operations are additionally atomic on their own, so they can be used by threads holding the shared write-lock.
  *
  * To retrieve the actual uses, query the duchain for the files.
  * */
@@ -57,6 +58,10 @@ namespace KDevelop {
     KDevVarLengthArray<IndexedTopDUContext> uses(const DeclarationId& id) const;
 
     private:
+      friend class DUChainUpdateBatch;
+      ///Applies the changes the current thread collected within a DUChainUpdateBatch
+      void commitBatch();
+
       const QScopedPointer<class UsesPrivate> d;
   };
 }
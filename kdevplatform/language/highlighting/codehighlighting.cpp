@@ -46,13 +46,25 @@
 
 #include <KTextEditor/Document>
 #include <KTextEditor/MovingInterface>
+#include <KTextEditor/View>
+
+#include <algorithm>
 
 using namespace KTextEditor;
 
 static const float highlightingZDepth = -500;
+// The number of ranges that are applied at once, after the visible ones
+static const int highlightingBatchSize = 1000;
 
 #define ifDebug(x)
 
+static void sortByStart(QVector<KTextEditor::MovingRange*>* ranges)
+{
+  std::sort(ranges->begin(), ranges->end(), [] (const KTextEditor::MovingRange* lhs, const KTextEditor::MovingRange* rhs) {
+    return lhs->start().toCursor() < rhs->start().toCursor();
+  });
+}
+
 namespace KDevelop {
 
 ///@todo Don't highlighting everything, only what is visible on-demand
@@ -499,6 +511,7 @@ void CodeHighlighting::clearHighlightingForDocument(const IndexedString& documen
   {
     disconnect(tracker, &DocumentChangeTracker::destroyed, this, &CodeHighlighting::trackerDestroyed);
     qDeleteAll(m_highlights[tracker]->m_highlightedRanges);
+    qDeleteAll(remainingOldRanges(*m_highlights[tracker]));
     delete m_highlights[tracker];
     m_highlights.remove(tracker);
   }
@@ -530,8 +543,15 @@ void CodeHighlighting::applyHighlighting(void* _highlighting)
 
   if(m_highlights.contains(tracker))
   {
-    oldHighlightedRanges = m_highlights[tracker]->m_highlightedRanges;
-    delete m_highlights[tracker];
+    DocumentHighlighting* previous = m_highlights[tracker];
+    oldHighlightedRanges = previous->m_highlightedRanges;
+    if(!previous->m_batches.isEmpty()) {
+      // The previous highlighting was not completely applied yet, so its ranges are not sorted yet
+      // and the ones it did not get to are matched as well
+      oldHighlightedRanges += remainingOldRanges(*previous);
+      sortByStart(&oldHighlightedRanges);
+    }
+    delete previous;
   }else{
     // we newly add this tracker, so add the connection
     // This can't use new style connect syntax since MovingInterface is not a QObject
@@ -544,19 +564,96 @@ void CodeHighlighting::applyHighlighting(void* _highlighting)
 
   m_highlights[tracker] = highlighting;
 
+  highlighting->m_revision = tracker->acquireRevision(highlighting->m_waitingRevision);
+  highlighting->m_oldRanges = oldHighlightedRanges;
+  createBatches(tracker, highlighting);
+
+  // The visible part is highlighted right away, the rest follows from the event loop,
+  // so large documents don't block the editor
+  applyBatch(tracker, highlighting);
+  queueBatches();
+}
+
+QVector<MovingRange*> CodeHighlighting::remainingOldRanges(const DocumentHighlighting& highlighting)
+{
+  QVector<MovingRange*> ranges;
+  for(const HighlightingBatch& batch : highlighting.m_batches)
+    ranges += highlighting.m_oldRanges.mid(batch.oldBegin, batch.oldEnd - batch.oldBegin);
+  return ranges;
+}
+
+void CodeHighlighting::createBatches(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting) const
+{
+  const QVector<HighlightedRange>& waiting = highlighting->m_waiting;
+  const QVector<MovingRange*>& oldRanges = highlighting->m_oldRanges;
+
+  auto waitingBound = [&waiting] (const CursorInRevision& cursor) {
+    return int(std::lower_bound(waiting.begin(), waiting.end(), cursor, [] (const HighlightedRange& range, const CursorInRevision& cursor) {
+      return range.range.start < cursor;
+    }) - waiting.begin());
+  };
+
+  // The ranges on the lines shown in the active view come first
+  int visibleBegin = 0;
+  int visibleEnd = 0;
+  if(KTextEditor::View* view = tracker->document()->activeView()) {
+    visibleBegin = waitingBound(highlighting->m_revision->transformFromCurrentRevision(KTextEditor::Cursor(view->firstDisplayedLine(), 0)));
+    visibleEnd = waitingBound(highlighting->m_revision->transformFromCurrentRevision(KTextEditor::Cursor(view->lastDisplayedLine() + 1, 0)));
+  }
+
+  QVector<HighlightingBatch> batches;
+  if(visibleBegin < visibleEnd)
+    batches.append({visibleBegin, visibleEnd, 0, 0});
+  for(int begin = 0; begin < visibleBegin; begin += highlightingBatchSize)
+    batches.append({begin, qMin(begin + highlightingBatchSize, visibleBegin), 0, 0});
+  for(int begin = visibleEnd; begin < waiting.size(); begin += highlightingBatchSize)
+    batches.append({begin, qMin(begin + highlightingBatchSize, waiting.size()), 0, 0});
+  if(batches.isEmpty())
+    batches.append({0, 0, 0, 0});
+
+  // Every old range belongs to the batch the waiting ranges around it belong to, so all of them are either
+  // matched or deleted once all batches are applied
+  auto oldBound = [&] (int waitingIndex) -> int {
+    if(waitingIndex == 0)
+      return 0;
+    if(waitingIndex == waiting.size())
+      return oldRanges.size();
+    const KTextEditor::Cursor start = highlighting->m_revision->transformToCurrentRevision(waiting[waitingIndex].range.start);
+    return int(std::lower_bound(oldRanges.begin(), oldRanges.end(), start, [] (const MovingRange* range, const KTextEditor::Cursor& cursor) {
+      return range->start().toCursor() < cursor;
+    }) - oldRanges.begin());
+  };
+
+  for(HighlightingBatch& batch : batches) {
+    batch.oldBegin = oldBound(batch.waitingBegin);
+    batch.oldEnd = oldBound(batch.waitingEnd);
+  }
+
+  highlighting->m_batches = batches;
+}
+
+void CodeHighlighting::applyBatch(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting)
+{
+  if(highlighting->m_batches.isEmpty())
+    return;
+
+  const HighlightingBatch batch = highlighting->m_batches.takeFirst();
+
   // Now create MovingRanges (match old ones with the incoming ranges)
 
   KTextEditor::Range tempRange;
 
-  QVector<MovingRange*>::iterator movingIt = oldHighlightedRanges.begin();
-  QVector<HighlightedRange>::iterator rangeIt = highlighting->m_waiting.begin();
+  QVector<MovingRange*>::iterator movingIt = highlighting->m_oldRanges.begin() + batch.oldBegin;
+  const QVector<MovingRange*>::iterator movingEnd = highlighting->m_oldRanges.begin() + batch.oldEnd;
+  QVector<HighlightedRange>::iterator rangeIt = highlighting->m_waiting.begin() + batch.waitingBegin;
+  const QVector<HighlightedRange>::iterator rangeEnd = highlighting->m_waiting.begin() + batch.waitingEnd;
 
-  while(rangeIt != highlighting->m_waiting.end())
+  while(rangeIt != rangeEnd)
   {
     // Translate the range into the current revision
-    KTextEditor::Range transformedRange = tracker->transformToCurrentRevision(rangeIt->range, highlighting->m_waitingRevision);
+    KTextEditor::Range transformedRange = highlighting->m_revision->transformToCurrentRevision(rangeIt->range);
 
-    while(movingIt != oldHighlightedRanges.end() &&
+    while(movingIt != movingEnd &&
       ((*movingIt)->start().line() < transformedRange.start().line() ||
       ((*movingIt)->start().line() == transformedRange.start().line() && (*movingIt)->start().column() < transformedRange.start().column())))
     {
@@ -567,7 +664,7 @@ void CodeHighlighting::applyHighlighting(void* _highlighting)
 
     tempRange = transformedRange;
 
-    if(movingIt == oldHighlightedRanges.end() ||
+    if(movingIt == movingEnd ||
       transformedRange.start().line() != (*movingIt)->start().line() ||
       transformedRange.start().column() != (*movingIt)->start().column() ||
       transformedRange.end().line() != (*movingIt)->end().line() ||
@@ -581,17 +678,52 @@ void CodeHighlighting::applyHighlighting(void* _highlighting)
     }
     else
     {
-      // Update the existing moving range
-      (*movingIt)->setAttribute(rangeIt->attribute);
-      (*movingIt)->setRange(tempRange);
+      // Reuse the existing moving range, it only needs to be repainted when its attribute changed
+      const KTextEditor::Attribute::Ptr attribute = (*movingIt)->attribute();
+      if(!attribute || !rangeIt->attribute || (attribute != rangeIt->attribute && *attribute != *rangeIt->attribute))
+        (*movingIt)->setAttribute(rangeIt->attribute);
       highlighting->m_highlightedRanges.push_back(*movingIt);
       ++movingIt;
     }
     ++rangeIt;
   }
 
-  for(; movingIt != oldHighlightedRanges.end(); ++movingIt)
+  for(; movingIt != movingEnd; ++movingIt)
     delete *movingIt; // Delete unmatched moving ranges behind
+
+  if(highlighting->m_batches.isEmpty()) {
+    // Completely applied, the visible ranges were added first
+    sortByStart(&highlighting->m_highlightedRanges);
+    highlighting->m_oldRanges.clear();
+    highlighting->m_waiting.clear();
+    highlighting->m_revision.reset();
+  }
+}
+
+void CodeHighlighting::queueBatches()
+{
+  if(m_batchesQueued)
+    return;
+
+  for(auto it = m_highlights.constBegin(); it != m_highlights.constEnd(); ++it) {
+    if(!it.value()->m_batches.isEmpty()) {
+      m_batchesQueued = true;
+      QMetaObject::invokeMethod(this, "applyPendingBatches", Qt::QueuedConnection);
+      return;
+    }
+  }
+}
+
+void CodeHighlighting::applyPendingBatches()
+{
+  VERIFY_FOREGROUND_LOCKED
+  QMutexLocker lock(&m_dataMutex);
+  m_batchesQueued = false;
+
+  for(auto it = m_highlights.constBegin(); it != m_highlights.constEnd(); ++it)
+    applyBatch(it.key(), it.value());
+
+  queueBatches();
 }
 
 void CodeHighlighting::trackerDestroyed(QObject* object)
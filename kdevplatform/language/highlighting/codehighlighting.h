@@ -174,6 +174,15 @@ class KDEVPLATFORMLANGUAGE_EXPORT CodeHighlighting : public QObject, public KDev
 
   private:
 
+    /// A part of the waiting ranges, together with the previously highlighted ranges at the same place
+    struct HighlightingBatch
+    {
+      int waitingBegin;
+      int waitingEnd;
+      int oldBegin;
+      int oldEnd;
+    };
+
     /// Highlighting of one specific document
     struct DocumentHighlighting
     {
@@ -182,9 +191,21 @@ class KDEVPLATFORMLANGUAGE_EXPORT CodeHighlighting : public QObject, public KDev
       // The ranges are sorted by range start, so they can easily be matched
       QVector<HighlightedRange> m_waiting;
       QVector<KTextEditor::MovingRange*> m_highlightedRanges;
+      // While the waiting ranges are applied in batches: the highlighted ranges of the previous highlighting,
+      // sorted by range start, the batches that are not applied yet, and a lock on the waiting revision
+      QVector<KTextEditor::MovingRange*> m_oldRanges;
+      QVector<HighlightingBatch> m_batches;
+      RevisionReference m_revision;
     };
 
+    /// The old ranges of the batches that are not applied yet
+    static QVector<KTextEditor::MovingRange*> remainingOldRanges(const DocumentHighlighting& highlighting);
+    void createBatches(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting) const;
+    void applyBatch(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting);
+    void queueBatches();
+
     QMap<DocumentChangeTracker*, DocumentHighlighting*> m_highlights;
+    bool m_batchesQueued = false;
 
 
     friend class CodeHighlightingInstance;
@@ -203,6 +224,7 @@ class KDEVPLATFORMLANGUAGE_EXPORT CodeHighlighting : public QObject, public KDev
   private Q_SLOTS:
     void clearHighlightingForDocument(const KDevelop::IndexedString& document);
     void applyHighlighting(void* highlighting);
+    void applyPendingBatches();
 
     void trackerDestroyed(QObject* object);
 
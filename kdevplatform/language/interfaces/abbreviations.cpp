@@ -20,8 +20,12 @@ Boston, MA 02110-1301, USA.
 #include "abbreviations.h"
 
 #include <QStringList>
+#include <QtAlgorithms>
+#include <QtConcurrentMap>
 #include <util/path.h>
 
+#include <numeric>
+
 namespace KDevelop {
 
 // Taken and adapted for kdevelop from katecompletionmodel.cpp
@@ -233,4 +237,97 @@ int matchPathFilter(const Path &toFilter, const QStringList &text, const Path &p
     }
 }
 
+void forEachChunk(int count, int chunkSize, const std::function<void(int begin, int end)>& function)
+{
+    if (count <= chunkSize) {
+        function(0, count);
+        return;
+    }
+
+    QVector<QPair<int, int>> chunks;
+    chunks.reserve(count / chunkSize + 1);
+    for (int begin = 0; begin < count; begin += chunkSize) {
+        chunks.append(qMakePair(begin, qMin(begin + chunkSize, count)));
+    }
+    QtConcurrent::blockingMap(chunks, [&function](const QPair<int, int>& chunk) {
+        function(chunk.first, chunk.second);
+    });
+}
+
+quint64 FilterIndex::signature(const QString& text)
+{
+    quint64 ret = 0;
+    for (const QChar c : text) {
+        ushort unicode = c.unicode();
+        // only ASCII characters are part of the signature, non-ASCII characters matching
+        // an ASCII character when ignoring case are treated like that character
+        if (unicode >= 0x80) {
+            unicode = c.toLower().unicode();
+            if (unicode >= 0x80) {
+                unicode = c.toCaseFolded().unicode();
+            }
+        }
+        if (unicode >= 'A' && unicode <= 'Z') {
+            ret |= quint64(1) << (unicode - 'A');
+        } else if (unicode >= 'a' && unicode <= 'z') {
+            ret |= quint64(1) << (unicode - 'a');
+        } else if (unicode >= '0' && unicode <= '9') {
+            ret |= quint64(1) << (26 + unicode - '0');
+        } else if (unicode > ' ' && unicode < 0x7f) {
+            ret |= quint64(1) << (36 + unicode % 28);
+        }
+    }
+    return ret;
+}
+
+void FilterIndex::clear()
+{
+    m_signatures.clear();
+    m_items.clear();
+}
+
+void FilterIndex::append(quint64 signature)
+{
+    m_signatures.append(signature);
+    if (!m_items.isEmpty()) {
+        for (quint64 bits = signature; bits; bits &= bits - 1) {
+            m_items[qCountTrailingZeroBits(bits)].append(m_signatures.size() - 1);
+        }
+    }
+}
+
+QVector<int> FilterIndex::candidates(quint64 textSignature)
+{
+    if (m_items.isEmpty()) {
+        m_items.resize(64);
+        for (int i = 0, c = m_signatures.size(); i < c; ++i) {
+            for (quint64 bits = m_signatures.at(i); bits; bits &= bits - 1) {
+                m_items[qCountTrailingZeroBits(bits)].append(i);
+            }
+        }
+    }
+
+    // walk the items of the rarest character of the text
+    const QVector<int>* rarest = nullptr;
+    for (int bit = 0; bit < 64; ++bit) {
+        if ((textSignature & (quint64(1) << bit)) && (!rarest || m_items.at(bit).size() < rarest->size())) {
+            rarest = &m_items.at(bit);
+        }
+    }
+
+    QVector<int> ret;
+    if (!rarest) {
+        ret.resize(m_signatures.size());
+        std::iota(ret.begin(), ret.end(), 0);
+        return ret;
+    }
+
+    for (const int item : *rarest) {
+        if (canMatch(m_signatures.at(item), textSignature)) {
+            ret.append(item);
+        }
+    }
+    return ret;
+}
+
 } // namespace KDevelop
@@ -21,6 +21,9 @@ Boston, MA 02110-1301, USA.
 #define KDEVPLATFORM_ABBREVIATIONS_H
 
 #include <QVarLengthArray>
+#include <QVector>
+
+#include <functional>
 
 #include <language/languageexport.h>
 
@@ -52,6 +55,57 @@ KDEVPLATFORMLANGUAGE_EXPORT bool matchesAbbreviationMulti(const QString& word, c
  * @return -1 when no match is found, otherwise a positive integer, higher values mean lower quality
  */
 KDEVPLATFORMLANGUAGE_EXPORT int matchPathFilter(const Path& toFilter, const QStringList& text, const Path& prefixPath);
+
+/**
+ * @brief Calls @p function for consecutive ranges of at most @p chunkSize indices, covering [0, @p count).
+ * When there is more than one range they are processed in parallel on the global thread pool.
+ * Returns once all ranges are processed.
+ */
+KDEVPLATFORMLANGUAGE_EXPORT void forEachChunk(int count, int chunkSize, const std::function<void(int begin, int end)>& function);
+
+/**
+ * @brief Index over the characters of a list of items, to find the items that can match a filter text.
+ *
+ * All the matchers above only match an item when it contains every character of the typed text,
+ * ignoring case. Each item is described by a signature of its characters, and the items are
+ * indexed by the characters of their signature, so the candidates for a filter text can be
+ * found without looking at all items.
+ */
+class KDEVPLATFORMLANGUAGE_EXPORT FilterIndex
+{
+public:
+    /// @return the signature of the characters in @p text
+    static quint64 signature(const QString& text);
+
+    /// @return true when an item with signature @p itemSignature can match a text with signature @p textSignature
+    static inline bool canMatch(quint64 itemSignature, quint64 textSignature)
+    {
+        return (itemSignature & textSignature) == textSignature;
+    }
+
+    void clear();
+
+    /// Appends an item with the given signature, items are numbered in the order they are appended
+    void append(quint64 signature);
+
+    int size() const
+    {
+        return m_signatures.size();
+    }
+
+    quint64 itemSignature(int item) const
+    {
+        return m_signatures.at(item);
+    }
+
+    /// @return the items that can match a text with signature @p textSignature, in ascending order
+    QVector<int> candidates(quint64 textSignature);
+
+private:
+    QVector<quint64> m_signatures;
+    // items containing each character of the signature, built on first use
+    QVector<QVector<int>> m_items;
+};
 }
 
 #endif
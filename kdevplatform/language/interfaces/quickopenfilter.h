@@ -28,6 +28,8 @@
 
 #include <util/path.h>
 
+#include <algorithm>
+
 namespace KDevelop {
 
 /**
@@ -67,6 +69,7 @@ public:
     void clearFilter()
     {
         m_filtered = m_items;
+        m_filteredSignatures.clear();
         m_oldFilterText.clear();
     }
 
@@ -74,6 +77,7 @@ public:
     void setItems(const QVector<Item>& data)
     {
         m_items = data;
+        m_index.clear();
         clearFilter();
     }
 
@@ -99,11 +103,14 @@ public:
             return;
         }
 
-        const QVector<Item> filterBase = text.startsWith(m_oldFilterText) ?
+        const bool refine = !m_oldFilterText.isEmpty() && text.startsWith(m_oldFilterText);
+        const QVector<Item> filterBase = refine ?
             m_filtered :
             m_items; //Start filtering based on the whole data
+        const QVector<quint64> signatureBase = m_filteredSignatures;
 
         m_filtered.clear();
+        m_filteredSignatures.clear();
 
         QStringList typedFragments = text.split(QStringLiteral("::"), QString::SkipEmptyParts);
         if (typedFragments.isEmpty()) {
@@ -119,10 +126,36 @@ public:
             clearFilter();
             return;
         }
-        for (const Item& data : filterBase) {
+        quint64 signature = 0;
+        for (int i = 0, c = typedFragments.size(); i < c; ++i) {
+            signature |= FilterIndex::signature(typedFragments.at(i));
+        }
+
+        QVector<int> candidates;
+        if (refine) {
+            //The signatures of the filtered items are known, they were matched before
+            candidates.reserve(filterBase.size());
+            for (int i = 0, c = filterBase.size(); i < c; ++i) {
+                if (FilterIndex::canMatch(signatureBase.at(i), signature)) {
+                    candidates << i;
+                }
+            }
+        } else {
+            if (m_index.size() != m_items.size()) {
+                m_index.clear();
+                for (int i = 0, c = m_items.size(); i < c; ++i) {
+                    m_index.append(FilterIndex::signature(itemText(m_items.at(i))));
+                }
+            }
+            candidates = m_index.candidates(signature);
+        }
+
+        for (const int i : candidates) {
+            const Item& data = filterBase.at(i);
             const QString& itemData = itemText( data );
             if( itemData.contains(text, Qt::CaseInsensitive) || matchesAbbreviationMulti(itemData, typedFragments) ) {
                 m_filtered << data;
+                m_filteredSignatures << (refine ? signatureBase.at(i) : m_index.itemSignature(i));
             }
         }
 
@@ -136,9 +169,21 @@ protected:
 private:
     QString m_oldFilterText;
     QVector<Item> m_filtered;
+    // signatures of m_filtered, empty when the filter is cleared
+    QVector<quint64> m_filteredSignatures;
     QVector<Item> m_items;
+    FilterIndex m_index;
 };
 
+/**
+ * Filter for items identified by a path, the filtered items are sorted by the quality of their match.
+ *
+ * Matching a large number of items is done in parallel, and only the best matches are sorted
+ * right away, the others are sorted once they are accessed through filteredItem().
+ *
+ * @tparam Parent has to provide itemPath(..) and itemPrefixPath(..), which are called from
+ * multiple threads, and may shadow itemSignature(..).
+ */
 template<class Item, class Parent>
 class PathFilter
 {
@@ -146,7 +191,9 @@ public:
     ///Clears the filter, but not the data.
     void clearFilter()
     {
-        m_filtered = m_items;
+        m_matches.clear();
+        m_sortedMatches = 0;
+        m_filtered.clear();
         m_oldFilterText.clear();
     }
 
@@ -154,6 +201,7 @@ public:
     void setItems(const QVector<Item>& data)
     {
         m_items = data;
+        m_index.clear();
         clearFilter();
     }
 
@@ -165,9 +213,31 @@ public:
     ///Returns the data that is left after the filtering
     const QVector<Item>& filteredItems() const
     {
+        if (m_oldFilterText.isEmpty()) {
+            return m_items;
+        }
+        sortMatches(m_matches.size());
         return m_filtered;
     }
 
+    ///Returns the number of items that are left after the filtering, without sorting them
+    int filteredItemCount() const
+    {
+        return m_oldFilterText.isEmpty() ? m_items.size() : m_matches.size();
+    }
+
+    ///Returns the filtered item at @p row, only sorting the matches up to it
+    const Item& filteredItem(int row) const
+    {
+        if (m_oldFilterText.isEmpty()) {
+            return m_items.at(row);
+        }
+        if (row >= m_sortedMatches) {
+            sortMatches(qMax(row + 1, m_sortedMatches + sortedMatchesBatch));
+        }
+        return m_filtered.at(row);
+    }
+
     ///Changes the filter-text and refilters the data
     void setFilter( const QStringList& text )
     {
@@ -179,10 +249,10 @@ public:
             return;
         }
 
-        QVector<Item> filterBase = m_filtered;
+        bool refine = true;
 
         if ( m_oldFilterText.isEmpty()) {
-            filterBase = m_items;
+            refine = false;
         } else if (m_oldFilterText.mid(0, m_oldFilterText.count() - 1) == text.mid(0, text.count() - 1)
                    && text.last().startsWith(m_oldFilterText.last())) {
             //Good, the prefix is the same, and the last item has been extended
@@ -190,36 +260,105 @@ public:
             //Good, an item has been added
         } else {
             //Start filtering based on the whole data, there was a big change to the filter
-            filterBase = m_items;
+            refine = false;
         }
 
-        QVector<QPair<int, int>> matches;
-        for (int i = 0, c = filterBase.size(); i < c; ++i) {
-            const auto& data = filterBase.at(i);
-            const auto matchQuality = matchPathFilter(static_cast<Parent*>(this)->itemPath(data), text,
-                                                      static_cast<Parent*>(this)->itemPrefixPath(data));
-            if (matchQuality == -1) {
-                continue;
+        quint64 signature = 0;
+        for (const QString& segment : text) {
+            signature |= FilterIndex::signature(segment);
+        }
+
+        if (m_index.size() != m_items.size()) {
+            m_index.clear();
+            for (int i = 0, c = m_items.size(); i < c; ++i) {
+                m_index.append(static_cast<Parent*>(this)->itemSignature(m_items.at(i)));
+            }
+        }
+
+        QVector<int> candidates;
+        if (refine) {
+            //The matched items of the previous filter, their order does not matter as the matches are sorted below
+            candidates.reserve(m_matches.size());
+            for (int i = 0, c = m_matches.size(); i < c; ++i) {
+                const int index = m_matches.at(i).second;
+                if (FilterIndex::canMatch(m_index.itemSignature(index), signature)) {
+                    candidates << index;
+                }
+            }
+        } else {
+            candidates = m_index.candidates(signature);
+        }
+
+        //Pairs of match quality and item index, every chunk only writes its own range
+        QVector<QPair<int, int>> matches(candidates.size());
+        QPair<int, int>* const matchData = matches.data();
+        Parent* const parent = static_cast<Parent*>(this);
+        const QVector<Item>& items = m_items;
+        forEachChunk(candidates.size(), matchChunkSize, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                const int index = candidates.at(i);
+                const auto& data = items.at(index);
+                matchData[i] = qMakePair(matchPathFilter(parent->itemPath(data), text, parent->itemPrefixPath(data)),
+                                         index);
             }
-            matches.push_back({matchQuality, i});
-        }
-        std::stable_sort(matches.begin(), matches.end(),
-                  [](const QPair<int, int>& lhs, const QPair<int, int>& rhs)
-                  {
-                    return lhs.first < rhs.first;
-                  });
-        m_filtered.resize(matches.size());
-        std::transform(matches.begin(), matches.end(), m_filtered.begin(),
-                       [&filterBase](const QPair<int, int>& match) {
-                            return filterBase.at(match.second);
-                       });
+        });
+        matches.erase(std::remove_if(matches.begin(), matches.end(),
+                                     [](const QPair<int, int>& match) {
+                                         return match.first == -1;
+                                     }),
+                      matches.end());
+
+        m_matches = matches;
+        m_sortedMatches = 0;
+        m_filtered.clear();
         m_oldFilterText = text;
+        sortMatches(sortedMatchesBatch);
+    }
+
+    ///Returns the signature of the characters an item can be matched by, see FilterIndex.
+    ///The parent class can shadow this to provide precomputed signatures.
+    quint64 itemSignature(const Item& data) const
+    {
+        quint64 signature = 0;
+        const Path path = static_cast<const Parent*>(this)->itemPath(data);
+        for (const QString& segment : path.segments()) {
+            signature |= FilterIndex::signature(segment);
+        }
+        return signature;
     }
 
 private:
+    enum {
+        ///The number of matches sorted at once
+        sortedMatchesBatch = 500,
+        ///The number of items matched by one thread at once
+        matchChunkSize = 5000
+    };
+
+    ///Sorts the first @p count matches by their quality, and then by the position of the item.
+    ///The sorted matches are followed by matches that are not better than any of them.
+    void sortMatches(int count) const
+    {
+        count = qMin(count, m_matches.size());
+        if (count <= m_sortedMatches) {
+            return;
+        }
+        std::partial_sort(m_matches.begin() + m_sortedMatches, m_matches.begin() + count, m_matches.end());
+        m_filtered.reserve(m_matches.size());
+        for (int i = m_sortedMatches; i < count; ++i) {
+            m_filtered.append(m_items.at(m_matches.at(i).second));
+        }
+        m_sortedMatches = count;
+    }
+
     QStringList m_oldFilterText;
-    QVector<Item> m_filtered;
+    // pairs of match quality and index into m_items, only the first m_sortedMatches are sorted
+    mutable QVector<QPair<int, int>> m_matches;
+    mutable int m_sortedMatches = 0;
+    // the items of the sorted matches
+    mutable QVector<Item> m_filtered;
     QVector<Item> m_items;
+    FilterIndex m_index;
 };
 
 }
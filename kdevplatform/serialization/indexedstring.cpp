@@ -151,7 +151,7 @@ inline char indexToChar(uint index)
 }
 
 using IndexedStringRepository = ItemRepository<IndexedStringData, IndexedStringRepositoryItemRequest, false, false>;
-using IndexedStringRepositoryManagerBase = RepositoryManager<IndexedStringRepository, true, false>;
+using IndexedStringRepositoryManagerBase = RepositoryManager<IndexedStringRepository, false, false>;
 class IndexedStringRepositoryManager : public IndexedStringRepositoryManagerBase
 {
 public:
@@ -159,6 +159,8 @@ public:
       : IndexedStringRepositoryManagerBase(QStringLiteral("String Index"))
     {
         repository()->setMutex(&m_mutex);
+        // the string data never changes once it is created, so it can be read without locking
+        repository()->enableLockFreeReads();
     }
 
 private:
@@ -172,12 +174,16 @@ IndexedStringRepository* globalIndexedStringRepository()
     return manager.repository();
 }
 
-template<typename ReadAction>
-auto readRepo(ReadAction action) -> decltype(action(globalIndexedStringRepository()))
+///@param index must be valid(nonzero and not a single char index)
+inline const IndexedStringData* itemFromIndex(uint index)
 {
     const auto* repo = globalIndexedStringRepository();
+    if (const auto* item = repo->publishedItemFromIndex(index)) {
+        return item;
+    }
+    // the bucket is not loaded yet, doing so publishes it for the next lookups
     QMutexLocker lock(repo->mutex());
-    return action(repo);
+    return repo->itemFromIndex(index);
 }
 
 template<typename EditAction>
@@ -310,10 +316,7 @@ QString IndexedString::str() const
     } else if (isSingleCharIndex(m_index)) {
         return QString(QLatin1Char(indexToChar(m_index)));
     } else {
-        const uint index = m_index;
-        return readRepo([index] (const IndexedStringRepository* repo) {
-            return stringFromItem(repo->itemFromIndex(index));
-        });
+        return stringFromItem(itemFromIndex(m_index));
     }
 }
 
@@ -329,9 +332,7 @@ int IndexedString::lengthFromIndex(uint index)
     } else if (isSingleCharIndex(index)) {
         return 1;
     } else {
-        return readRepo([index] (const IndexedStringRepository* repo) {
-            return repo->itemFromIndex(index)->length;
-        });
+        return itemFromIndex(index)->length;
     }
 }
 
@@ -347,10 +348,7 @@ const char* IndexedString::c_str() const
 #endif
         return reinterpret_cast<const char*>(&m_index) + offset;
     } else {
-        const uint index = m_index;
-        return readRepo([index] (const IndexedStringRepository* repo) {
-            return c_strFromItem(repo->itemFromIndex(index));
-        });
+        return c_strFromItem(itemFromIndex(m_index));
     }
 
 }
@@ -362,10 +360,7 @@ QByteArray IndexedString::byteArray() const
     } else if (isSingleCharIndex(m_index)) {
         return QByteArray(1, indexToChar(m_index));
     } else {
-        const uint index = m_index;
-        return readRepo([index] (const IndexedStringRepository* repo) {
-            return arrayFromItem(repo->itemFromIndex(index));
-        });
+        return arrayFromItem(itemFromIndex(m_index));
     }
 }
 
@@ -19,6 +19,7 @@
 #ifndef KDEVPLATFORM_ITEMREPOSITORY_H
 #define KDEVPLATFORM_ITEMREPOSITORY_H
 
+#include <QAtomicPointer>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
@@ -131,6 +132,8 @@ class Bucket {
     {
     }
     ~Bucket() {
+      if(m_publishSlot)
+        m_publishSlot->storeRelease(nullptr);
       if(m_data != m_mappedData) {
         delete[] m_data;
         delete[] m_nextBucketHash;
@@ -154,6 +157,7 @@ class Bucket {
         m_changed = true;
         m_dirty = false;
         m_lastUsed = 0;
+        publishData();
       }
     }
 
@@ -182,6 +186,30 @@ class Bucket {
           m_changed = false;
           m_lastUsed = 0;
           VERIFY(current - start == (DataSize - ItemRepositoryBucketSize));
+          publishData();
+      }
+    }
+
+    ///Reads the bucket from the current position of @p file directly into private heap memory.
+    ///Used for buckets that are not covered by the memory-map of the repository file.
+    void initializeFromFile(QFile* file) {
+      if(!m_data) {
+          file->read((char*)&m_monsterBucketExtent, sizeof(unsigned int));
+          file->read((char*)&m_available, sizeof(unsigned int));
+          m_objectMap = new short unsigned int[ObjectMapSize];
+          file->read((char*)m_objectMap, sizeof(short unsigned int) * ObjectMapSize);
+          m_nextBucketHash = new short unsigned int[NextBucketHashSize];
+          file->read((char*)m_nextBucketHash, sizeof(short unsigned int) * NextBucketHashSize);
+          file->read((char*)&m_largestFreeItem, sizeof(short unsigned int));
+          file->read((char*)&m_freeItemCount, sizeof(unsigned int));
+          file->read((char*)&m_dirty, sizeof(bool));
+          m_data = new char[dataSize()];
+          file->read(m_data, dataSize());
+
+          //The data equals the state on disk, so there is no need to store it again
+          m_changed = false;
+          m_lastUsed = 0;
+          publishData();
       }
     }
 
@@ -256,6 +284,25 @@ class Bucket {
       return m_data;
     }
 
+    ///From now on, the current data pointer is stored into @p slot whenever it changes, and reset on destruction.
+    ///This allows reading items without locking, see ItemRepository::enableLockFreeReads().
+    void setPublishSlot(QAtomicPointer<char>* slot) {
+      m_publishSlot = slot;
+      publishData();
+    }
+
+    ///Returns whether the data of this bucket is served directly from the read-only memory-map
+    bool isMapped() const {
+      return m_data && m_data == m_mappedData;
+    }
+
+    ///Returns whether this bucket was loaded from the given memory-map. Lock-free readers may still read
+    ///through the map even once the data of the bucket has been made private.
+    bool isLoadedFrom(const uchar* map, qint64 size) const {
+      const uchar* data = reinterpret_cast<const uchar*>(m_mappedData);
+      return data && data >= map && data < map + size;
+    }
+
     inline uint dataSize() const {
       return ItemRepositoryBucketSize + m_monsterBucketExtent * DataSize;
     }
@@ -806,9 +853,16 @@ class Bucket {
         memcpy(m_data, m_mappedData, ItemRepositoryBucketSize + m_monsterBucketExtent * DataSize);
         memcpy(m_objectMap, oldObjectMap, ObjectMapSize * sizeof(short unsigned int));
         memcpy(m_nextBucketHash, oldNextBucketHash, NextBucketHashSize * sizeof(short unsigned int));
+        //Lock-free readers that still use the mapped data read the same contents, the map stays valid
+        publishData();
       }
     }
 
+    void publishData() {
+      if(m_publishSlot)
+        m_publishSlot->storeRelease(m_data);
+    }
+
     ///Merges the given index item, which must have a freeSize() set, to surrounding free items, and inserts the result.
     ///The given index itself should not be in the free items chain yet.
     ///Returns whether the item was inserted somewhere.
@@ -968,6 +1022,7 @@ class Bucket {
     bool m_dirty = false; //Whether the data was changed since the last finalCleanup
     bool m_changed  = false; //Whether this bucket was changed since it was last stored to disk
     mutable int m_lastUsed = 0; //How many ticks ago this bucket was last accessed
+    QAtomicPointer<char>* m_publishSlot = nullptr; //Where m_data is published for lock-free readers, if enabled
 };
 
 template<bool lock>
@@ -1083,6 +1138,7 @@ class ItemRepository : public AbstractItemRepository {
     if(m_registry)
       m_registry->unRegisterRepository(this);
     close();
+    delete[] m_publishedBuckets;
   }
 
   ///Unloading of buckets is enabled by default. Use this to disable it. When unloading is enabled, the data
@@ -1091,6 +1147,54 @@ class ItemRepository : public AbstractItemRepository {
       m_unloadingEnabled = enabled;
   }
 
+  ///Allows reading items through publishedItemFromIndex() without locking the mutex.
+  ///The data pointer of every loaded bucket is published atomically, and buckets are not unloaded anymore,
+  ///so items stay readable at the returned address until they are deleted or the repository is closed.
+  ///Items are never moved within a bucket, so this is safe for reading data that does not change after createItem().
+  void enableLockFreeReads() {
+    QMutexLocker lock(m_mutex);
+    if(m_publishedBuckets)
+      return;
+    m_unloadingEnabled = false;
+    m_publishedBuckets = new QAtomicPointer<char>[ItemRepositoryBucketLimit];
+    for(int a = 0; a < m_buckets.size(); ++a)
+      if(m_buckets[a])
+        m_buckets[a]->setPublishSlot(&m_publishedBuckets[a]);
+  }
+
+  ///Returns the item without locking the mutex, or nullptr if its bucket has not been loaded yet.
+  ///In that case, lock mutex() and use itemFromIndex(), which also publishes the bucket.
+  ///@param index The index. It must be valid(match an existing item), and nonzero.
+  ///@warning enableLockFreeReads() must have been called, and the item must be kept alive while it is used.
+  ///         Only read the immutable parts of the item.
+  inline const Item* publishedItemFromIndex(unsigned int index) const {
+    Q_ASSERT(m_publishedBuckets);
+    const char* data = m_publishedBuckets[index >> 16].loadAcquire();
+    return data ? reinterpret_cast<const Item*>(data + (index & 0xffff)) : nullptr;
+  }
+
+  ///Loading of buckets through a read-only memory-map of the repository file is enabled by default.
+  ///While it is enabled, unchanged buckets are served straight from the mapping, and are only copied into
+  ///private memory once they are changed. Disabling it only affects buckets that are loaded afterwards.
+  void setMappedLoadingEnabled(bool enabled) {
+    QMutexLocker lock(m_mutex);
+    m_mappedLoadingEnabled = enabled;
+    if(enabled && m_file && !m_fileMap && m_file->open(QFile::ReadOnly)) {
+      mapFile();
+      m_file->close();
+    }
+  }
+
+  ///Returns how many of the currently loaded buckets are served from the memory-map
+  uint mappedBuckets() const {
+    ThisLocker lock(m_mutex);
+    uint mapped = 0;
+    for(int a = 0; a < m_buckets.size(); ++a)
+      if(m_buckets[a] && m_buckets[a]->isMapped())
+        ++mapped;
+    return mapped;
+  }
+
   ///Returns the index for the given item. If the item is not in the repository yet, it is inserted.
   ///The index can never be zero. Zero is reserved for your own usage as invalid
   ///@param request Item to retrieve the index from
@@ -1166,15 +1270,14 @@ class ItemRepository : public AbstractItemRepository {
 
     //The item isn't in the repository yet, find a new bucket for it
     while(1) {
+      if(useBucket >= 0xfffe) { //We have reserved the last bucket index 0xffff for special purposes
+        //the repository has overflown.
+        qWarning() << "Found no room for an item in" << m_repositoryName << "size of the item:" << request.itemSize();
+        return 0;
+      }
       if(useBucket >= m_buckets.size()) {
-          if(m_buckets.size() >= 0xfffe) { //We have reserved the last bucket index 0xffff for special purposes
-          //the repository has overflown.
-          qWarning() << "Found no room for an item in" << m_repositoryName << "size of the item:" << request.itemSize();
-          return 0;
-        }else{
-          //Allocate new buckets
-          m_buckets.resize(m_buckets.size() + 10);
-        }
+        //Allocate new buckets
+        m_buckets.resize(m_buckets.size() + 10);
       }
       MyBucket* bucketPtr = m_buckets.at(useBucket);
       if(!bucketPtr) {
@@ -1231,6 +1334,10 @@ class ItemRepository : public AbstractItemRepository {
           //Create a new monster-bucket at the end of the data
           int needMonsterExtent = (totalSize - ItemRepositoryBucketSize) / MyBucket::DataSize + 1;
           Q_ASSERT(needMonsterExtent);
+          if(m_currentBucket + needMonsterExtent + 1 > 0xfffe) {
+            qWarning() << "Found no room for a monster-bucket in" << m_repositoryName << "size of the item:" << request.itemSize();
+            return 0;
+          }
           if(m_currentBucket + needMonsterExtent + 1 > m_buckets.size()) {
             m_buckets.resize(m_buckets.size() + 10 + needMonsterExtent + 1);
           }
@@ -1687,7 +1794,7 @@ class ItemRepository : public AbstractItemRepository {
           if(m_buckets[a]->changed()) {
             storeBucket(a);
           }
-          if(m_unloadingEnabled) {
+          if(m_unloadingEnabled && !m_publishedBuckets) {
             const int unloadAfterTicks = 2;
             if(m_buckets[a]->lastUsed() > unloadAfterTicks) {
                 delete m_buckets[a];
@@ -1702,6 +1809,11 @@ class ItemRepository : public AbstractItemRepository {
       if(m_metaDataChanged) {
         Q_ASSERT(m_dynamicFile);
 
+        if(m_registry) {
+          m_registry->journalRegion(m_file, 0, BucketStartOffset);
+          m_registry->journalRegion(m_dynamicFile, 0, m_dynamicFile->size());
+        }
+
         m_file->seek(0);
         m_file->write((char*)&m_repositoryVersion, sizeof(uint));
         uint hashSize = bucketHashSize;
@@ -1727,6 +1839,14 @@ class ItemRepository : public AbstractItemRepository {
       m_dynamicFile->close();
       Q_ASSERT(!m_file->isOpen());
       Q_ASSERT(!m_dynamicFile->isOpen());
+
+      //Extend the memory-map over buckets that were appended, so they can be served from it once unloaded.
+      if(m_mappedLoadingEnabled && m_file->size() > BucketStartOffset + m_fileMapSize && m_file->open(QFile::ReadOnly)) {
+        mapFile();
+        m_file->close();
+      }
+      //Buckets may have been unloaded, which can free previous mappings
+      releaseRetiredFileMaps();
     }
   }
 
@@ -1862,6 +1982,8 @@ class ItemRepository : public AbstractItemRepository {
       m_buckets[bucketNumber] = new MyBucket();
 
       m_buckets[bucketNumber]->initialize(extent);
+      if(m_publishedBuckets)
+        m_buckets[bucketNumber]->setPublishSlot(&m_publishedBuckets[bucketNumber]);
 
 #ifdef DEBUG_MONSTERBUCKETS
 
@@ -1881,6 +2003,8 @@ class ItemRepository : public AbstractItemRepository {
         m_buckets[index] = new MyBucket();
 
         m_buckets[index]->initialize(0);
+        if(m_publishedBuckets)
+          m_buckets[index]->setPublishSlot(&m_publishedBuckets[index]);
         Q_ASSERT(!m_buckets[index]->monsterBucketExtent());
       }
     }
@@ -1987,19 +2111,11 @@ class ItemRepository : public AbstractItemRepository {
 
     m_fileMapSize = 0;
     m_fileMap = nullptr;
+    m_retiredFileMaps.clear();
+
+    if(m_mappedLoadingEnabled)
+      mapFile();
 
-#ifdef ITEMREPOSITORY_USE_MMAP_LOADING
-    if(m_file->size() > BucketStartOffset){
-      m_fileMap = m_file->map(BucketStartOffset, m_file->size() - BucketStartOffset);
-      Q_ASSERT(m_file->isOpen());
-      Q_ASSERT(m_file->size() >= BucketStartOffset);
-      if(m_fileMap){
-        m_fileMapSize = m_file->size() - BucketStartOffset;
-      }else{
-        qWarning() << "mapping" << m_file->fileName() << "FAILED!";
-      }
-    }
-#endif
     //To protect us from inconsistency due to crashes. flush() is not enough.
     m_file->close();
     m_dynamicFile->close();
@@ -2007,6 +2123,42 @@ class ItemRepository : public AbstractItemRepository {
     return true;
   }
 
+  ///Maps the bucket area of m_file read-only into memory, replacing the current mapping. m_file must be open in read-only mode.
+  ///The previous mapping is only released once no loaded bucket points into it any more, see releaseRetiredFileMaps().
+  void mapFile() {
+    Q_ASSERT(m_file->isOpen());
+    if(m_file->size() <= BucketStartOffset)
+      return;
+
+    const qint64 mapSize = m_file->size() - BucketStartOffset;
+    uchar* fileMap = m_file->map(BucketStartOffset, mapSize);
+    if(fileMap) {
+      if(m_fileMap)
+        m_retiredFileMaps.append({m_fileMap, m_fileMapSize});
+      m_fileMap = fileMap;
+      m_fileMapSize = mapSize;
+      releaseRetiredFileMaps();
+    }else{
+      qWarning() << "mapping" << m_file->fileName() << "FAILED!";
+    }
+  }
+
+  ///Unmaps the previous mappings of m_file that none of the loaded buckets was loaded from
+  void releaseRetiredFileMaps() {
+    for(auto it = m_retiredFileMaps.begin(); it != m_retiredFileMaps.end(); ) {
+      bool used = false;
+      for(int a = 0; a < m_buckets.size() && !used; ++a)
+        used = m_buckets[a] && m_buckets[a]->isLoadedFrom(it->data, it->size);
+
+      if(used) {
+        ++it;
+      }else{
+        m_file->unmap(it->data);
+        it = m_retiredFileMaps.erase(it);
+      }
+    }
+  }
+
   ///@warning by default, this does not store the current state to disk.
   void close(bool doStore = false) override {
 
@@ -2015,10 +2167,12 @@ class ItemRepository : public AbstractItemRepository {
 
     if(m_file)
       m_file->close();
+    //Deleting the file releases all of its mappings
     delete m_file;
     m_file = nullptr;
     m_fileMap = nullptr;
     m_fileMapSize = 0;
+    m_retiredFileMaps.clear();
 
     if(m_dynamicFile)
       m_dynamicFile->close();
@@ -2090,11 +2244,15 @@ class ItemRepository : public AbstractItemRepository {
 
     if(!m_buckets[bucketNumber]) {
       m_buckets[bucketNumber] = new MyBucket();
+      if(m_publishedBuckets)
+        m_buckets[bucketNumber]->setPublishSlot(&m_publishedBuckets[bucketNumber]);
 
-      bool doMMapLoading = (bool)m_fileMap;
+      const bool doMMapLoading = m_mappedLoadingEnabled && m_fileMap;
 
-      uint offset = ((bucketNumber-1) * MyBucket::DataSize);
-      if(m_file && offset < m_fileMapSize && doMMapLoading && *reinterpret_cast<uint*>(m_fileMap + offset) == 0) {
+      qint64 offset = qint64(bucketNumber-1) * MyBucket::DataSize;
+      //Monster-buckets can be served from the map as well, as long as their whole extent is covered by it
+      if(m_file && doMMapLoading && offset < m_fileMapSize
+         && offset + (1 + qint64(*reinterpret_cast<uint*>(m_fileMap + offset))) * MyBucket::DataSize <= m_fileMapSize) {
 //         qDebug() << "loading bucket mmap:" << bucketNumber;
         m_buckets[bucketNumber]->initializeFromMap(reinterpret_cast<char*>(m_fileMap + offset));
       } else if(m_file) {
@@ -2106,13 +2264,7 @@ class ItemRepository : public AbstractItemRepository {
           VERIFY(res);
           offset += BucketStartOffset;
           m_file->seek(offset);
-          uint monsterBucketExtent;
-          m_file->read((char*)(&monsterBucketExtent), sizeof(unsigned int));
-          m_file->seek(offset);
-          ///FIXME: use the data here instead of copying it again in prepareChange
-          QByteArray data = m_file->read((1+monsterBucketExtent) * MyBucket::DataSize);
-          m_buckets[bucketNumber]->initializeFromMap(data.data());
-          m_buckets[bucketNumber]->prepareChange();
+          m_buckets[bucketNumber]->initializeFromFile(m_file);
         }else{
           m_buckets[bucketNumber]->initialize(0);
         }
@@ -2138,7 +2290,10 @@ class ItemRepository : public AbstractItemRepository {
   //m_file must be opened
   void storeBucket(int bucketNumber) const {
     if(m_file && m_buckets[bucketNumber]) {
-      m_buckets[bucketNumber]->store(m_file, BucketStartOffset + (bucketNumber-1) * MyBucket::DataSize);
+      const qint64 offset = BucketStartOffset + qint64(bucketNumber-1) * MyBucket::DataSize;
+      if(m_registry)
+        m_registry->journalRegion(m_file, offset, (1 + qint64(m_buckets[bucketNumber]->monsterBucketExtent())) * MyBucket::DataSize);
+      m_buckets[bucketNumber]->store(m_file, offset);
     }
   }
 
@@ -2234,11 +2389,24 @@ class ItemRepository : public AbstractItemRepository {
   //File that contains the buckets
   QFile* m_file;
   uchar* m_fileMap;
-  uint m_fileMapSize;
+  qint64 m_fileMapSize;
+  struct FileMap {
+    uchar* data;
+    qint64 size;
+  };
+  //Previous mappings of m_file that loaded buckets may still point into
+  QVector<FileMap> m_retiredFileMaps;
   //File that contains more dynamic data, like the list of buckets with deleted items
   QFile* m_dynamicFile;
   uint m_repositoryVersion;
   bool m_unloadingEnabled;
+  //Data pointers of the loaded buckets, indexed by bucket number. Only allocated when lock-free reads are enabled.
+  QAtomicPointer<char>* m_publishedBuckets = nullptr;
+#ifdef ITEMREPOSITORY_USE_MMAP_LOADING
+  bool m_mappedLoadingEnabled = true;
+#else
+  bool m_mappedLoadingEnabled = false;
+#endif
   AbstractRepositoryManager* m_manager;
   friend class ::TestItemRepository;
 };
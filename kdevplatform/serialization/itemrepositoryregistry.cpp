@@ -22,7 +22,10 @@
 #include <QProcessEnvironment>
 #include <QCoreApplication>
 #include <QDataStream>
+#include <QElapsedTimer>
+#include <QSet>
 #include <QStandardPaths>
+#include <QVector>
 
 #include <KLocalizedString>
 
@@ -46,6 +49,95 @@ void setCrashCounter(QFile& crashesFile, int count)
   writeStream << count;
 }
 
+/**
+ * While the directory is locked for writing, the journal records how to undo every change to the files in it.
+ * It consists of records of a type, a payload and a checksum of the payload. A record is written and flushed
+ * before the change it describes is done, so a broken record at the end was never followed by its change.
+ */
+enum JournalRecordType : quint8 {
+  RegionRecord = 1,  ///< Relative file path, file size, offset and the data that was overwritten
+  MovedFileRecord,   ///< Relative file path, and the relative path the previous file was moved to
+  CreatedFileRecord  ///< Relative file path of a file that did not exist before
+};
+
+void appendJournalRecord(QFile& journal, JournalRecordType type, const QByteArray& payload)
+{
+  QDataStream stream(&journal);
+  stream << static_cast<quint8>(type) << payload << qChecksum(payload.constData(), payload.size());
+  journal.flush();
+}
+
+void removeJournal(const QDir& dir)
+{
+  QFile::remove(dir.filePath(QStringLiteral("journal")));
+  QDir(dir.filePath(QStringLiteral("journal_files"))).removeRecursively();
+}
+
+///Undoes all changes recorded in the journal, in reverse order
+bool rollBackJournal(const QDir& dir)
+{
+  QFile journal(dir.filePath(QStringLiteral("journal")));
+  if (!journal.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  QVector<QPair<quint8, QByteArray>> records;
+  QDataStream stream(&journal);
+  while (!stream.atEnd()) {
+    quint8 type;
+    QByteArray payload;
+    quint16 checksum;
+    stream >> type >> payload >> checksum;
+    if (stream.status() != QDataStream::Ok || checksum != qChecksum(payload.constData(), payload.size())) {
+      //The record that was written during the crash, the change it describes was not done yet
+      break;
+    }
+    records.append(qMakePair(type, payload));
+  }
+
+  for (auto it = records.crbegin(); it != records.crend(); ++it) {
+    QDataStream record(it->second);
+    QString fileName;
+    record >> fileName;
+    const QString filePath = dir.filePath(fileName);
+
+    switch (it->first) {
+      case RegionRecord: {
+        qint64 fileSize, offset;
+        QByteArray data;
+        record >> fileSize >> offset >> data;
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadWrite) || !file.seek(offset) || file.write(data) != data.size() || !file.resize(fileSize)) {
+          qCWarning(SERIALIZATION) << "failed to restore" << filePath;
+          return false;
+        }
+        break;
+      }
+      case MovedFileRecord: {
+        QString backupName;
+        record >> backupName;
+        const QString backupPath = dir.filePath(backupName);
+        //If the backup does not exist, the crash happened before the file was moved
+        if (QFile::exists(backupPath)) {
+          QFile::remove(filePath);
+          if (!QFile::rename(backupPath, filePath)) {
+            qCWarning(SERIALIZATION) << "failed to restore" << filePath;
+            return false;
+          }
+        }
+        break;
+      }
+      case CreatedFileRecord:
+        QFile::remove(filePath);
+        break;
+      default:
+        return false;
+    }
+  }
+
+  return true;
+}
+
 bool shouldClear(const QString& path)
 {
   QDir dir(path);
@@ -59,7 +151,7 @@ bool shouldClear(const QString& path)
     return true;
   }
 
-  if (dir.exists(QStringLiteral("is_writing"))) {
+  if (!ItemRepositoryRegistry::recoverInterruptedWrite(path)) {
     qCWarning(SERIALIZATION) << "repository" << path << "was write-locked, it probably is inconsistent";
     return true;
   }
@@ -117,6 +209,12 @@ public:
   QMap<QString, QAtomicInt*> m_customCounters;
   mutable QMutex m_mutex;
 
+  //Open while the directory is locked for writing. Journaling is also done from background threads,
+  //so it is protected by its own mutex, which is never held while locking anything else.
+  QFile m_journal;
+  QSet<QString> m_journaledFiles;
+  QMutex m_journalMutex;
+
   explicit ItemRepositoryRegistryPrivate(ItemRepositoryRegistry* owner)
   : m_owner(owner)
   , m_shallDelete(false)
@@ -126,6 +224,7 @@ public:
 
   void lockForWriting();
   void unlockForWriting();
+  void closeJournal();
   void deleteDataDirectory(const QString& path, bool recreate = true);
 
   /// @param path  A shared directory-path that the item-repositories are to be loaded from.
@@ -220,6 +319,18 @@ QString ItemRepositoryRegistry::path() const
 void ItemRepositoryRegistryPrivate::lockForWriting()
 {
   QMutexLocker lock(&m_mutex);
+  {
+    //Start the journal before marking the directory, so a marked directory always has one
+    QMutexLocker journalLock(&m_journalMutex);
+    if (!m_journal.isOpen()) {
+      QDir(m_path).mkpath(QStringLiteral("journal_files"));
+      m_journal.setFileName(m_path + QLatin1String("/journal"));
+      if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(SERIALIZATION) << "Could not open journal for writing";
+      }
+      m_journaledFiles.clear();
+    }
+  }
   //Create is_writing
   QFile f(m_path + QLatin1String("/is_writing"));
   f.open(QIODevice::WriteOnly);
@@ -236,6 +347,83 @@ void ItemRepositoryRegistryPrivate::unlockForWriting()
   QMutexLocker lock(&m_mutex);
   //Delete is_writing
   QFile::remove(m_path + QLatin1String("/is_writing"));
+
+  //The directory is consistent again, so the journal is not needed any more
+  closeJournal();
+  removeJournal(QDir(m_path));
+}
+
+void ItemRepositoryRegistryPrivate::closeJournal()
+{
+  QMutexLocker journalLock(&m_journalMutex);
+  m_journal.close();
+  m_journaledFiles.clear();
+}
+
+void ItemRepositoryRegistry::journalRegion(QFile* file, qint64 offset, qint64 size)
+{
+  QMutexLocker journalLock(&d->m_journalMutex);
+  if (!d->m_journal.isOpen()) {
+    return;
+  }
+
+  const qint64 fileSize = file->size();
+  QByteArray data;
+  if (offset < fileSize && file->seek(offset)) {
+    data = file->read(qMin(size, fileSize - offset));
+  }
+
+  QByteArray payload;
+  QDataStream stream(&payload, QIODevice::WriteOnly);
+  stream << QDir(d->m_path).relativeFilePath(file->fileName()) << fileSize << offset << data;
+  appendJournalRecord(d->m_journal, RegionRecord, payload);
+}
+
+bool ItemRepositoryRegistry::journalFile(const QString& path)
+{
+  QMutexLocker journalLock(&d->m_journalMutex);
+  //Files that were already journaled have been written during this lock, they don't need to be restored
+  if (!d->m_journal.isOpen() || d->m_journaledFiles.contains(path)) {
+    return false;
+  }
+  d->m_journaledFiles.insert(path);
+
+  const QDir dir(d->m_path);
+  QByteArray payload;
+  QDataStream stream(&payload, QIODevice::WriteOnly);
+  stream << dir.relativeFilePath(path);
+
+  if (!QFile::exists(path)) {
+    appendJournalRecord(d->m_journal, CreatedFileRecord, payload);
+    return false;
+  }
+
+  const QString backupName = QStringLiteral("journal_files/%1").arg(d->m_journaledFiles.size());
+  stream << backupName;
+  appendJournalRecord(d->m_journal, MovedFileRecord, payload);
+  return QFile::rename(path, dir.filePath(backupName));
+}
+
+bool ItemRepositoryRegistry::recoverInterruptedWrite(const QString& repositoryPath)
+{
+  const QDir dir(repositoryPath);
+  if (!dir.exists(QStringLiteral("is_writing"))) {
+    //A journal left over from a crash after the write was completed
+    removeJournal(dir);
+    return true;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  if (!rollBackJournal(dir)) {
+    return false;
+  }
+
+  removeJournal(dir);
+  QFile::remove(dir.filePath(QStringLiteral("is_writing")));
+  qCWarning(SERIALIZATION) << "repository" << repositoryPath << "was write-locked, rolled back to the last consistent state in"
+                           << timer.elapsed() << "ms";
+  return true;
 }
 
 void ItemRepositoryRegistry::unlockForWriting()
@@ -261,6 +449,7 @@ void ItemRepositoryRegistryPrivate::deleteDataDirectory(const QString& path, boo
   lockForWriting();
 
   bool result = QDir(path).removeRecursively();
+  closeJournal();
   Q_ASSERT(result);
   Q_UNUSED(result);
   // Just recreate the directory then; leave old path (as it is dependent on appname and session only).
@@ -326,6 +515,7 @@ void ItemRepositoryRegistry::store()
   }
 
   //Store all custom counter values
+  journalFile(d->m_path + QLatin1String("/Counters"));
   QFile f(d->m_path + QLatin1String("/Counters"));
   if(f.open(QIODevice::WriteOnly)) {
     f.resize(0);
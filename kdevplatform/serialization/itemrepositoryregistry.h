@@ -26,6 +26,7 @@
 class QString;
 class QMutex;
 class QAtomicInt;
+class QFile;
 
 namespace KDevelop {
 
@@ -86,6 +87,20 @@ class KDEVPLATFORMSERIALIZATION_EXPORT ItemRepositoryRegistry {
     /// Removes the inconsistency mark set by @ref lockForWriting().
     void unlockForWriting();
 
+    /// While locked for writing, records the current content of @p size bytes at @p offset in the open @p file,
+    /// so the write that follows can be rolled back when the application crashes before @ref unlockForWriting().
+    void journalRegion(QFile* file, qint64 offset, qint64 size);
+
+    /// While locked for writing, moves the file at @p path out of the way, so it can be restored when the
+    /// application crashes before @ref unlockForWriting(). The caller then creates the file anew, or leaves it removed.
+    /// @returns Whether the file was moved.
+    bool journalFile(const QString& path);
+
+    /// If the application crashed while the repository directory at @p repositoryPath was locked for writing,
+    /// restores the state of the last completed write using the journal. Done automatically when the directory is opened.
+    /// @returns False if the directory is inconsistent and has to be cleared.
+    static bool recoverInterruptedWrite(const QString& repositoryPath);
+
     /// Returns a custom counter persistently stored as part of item-repositories in the
     /// same directory, possibly creating it.
     /// @param identity     The string used to identify a counter.
@@ -27,6 +27,8 @@
 #include <serialization/indexedstring.h>
 
 #include <algorithm>
+#include <thread>
+#include <vector>
 #include <QTest>
 
 QTEST_GUILESS_MAIN(BenchItemRepository)
@@ -218,3 +220,85 @@ void BenchItemRepository::lookupValue()
   }
 }
 
+
+void BenchItemRepository::coldLookup_data()
+{
+  QTest::addColumn<bool>("mappedLoading");
+
+  QTest::newRow("read") << false;
+  QTest::newRow("mmap") << true;
+}
+
+void BenchItemRepository::coldLookup()
+{
+  QFETCH(bool, mappedLoading);
+
+  const QVector<QString> data = generateData();
+  QVector<uint> indices;
+  {
+    TestDataRepository repo("TestDataRepositoryColdLookup");
+    indices = insertData(data, repo);
+    repo.store();
+  }
+  srand(0);
+  std::random_shuffle(indices.begin(), indices.end());
+  QBENCHMARK_ONCE {
+    // re-open the repository, so that every bucket has to be loaded from disk again
+    TestDataRepository repo("TestDataRepositoryColdLookup");
+    repo.setMappedLoadingEnabled(mappedLoading);
+    for (uint index : qAsConst(indices)) {
+      repo.itemFromIndex(index);
+    }
+    for (const QString& item : data) {
+      const QByteArray byteArray = item.toUtf8();
+      repo.findIndex(TestDataRepositoryItemRequest(byteArray.constData(), byteArray.length()));
+    }
+    QCOMPARE(repo.mappedBuckets() > 0, mappedLoading);
+  }
+}
+
+static void insertAndLookupConcurrently(const QVector<QByteArray>& data, TestDataRepository& repo, int numThreads)
+{
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads);
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&data, &repo, numThreads, t]() {
+      for (int i = t; i < data.size(); i += numThreads) {
+        repo.index(TestDataRepositoryItemRequest(data[i].constData(), data[i].length()));
+      }
+      // look up a slice of the items that were inserted by another thread
+      for (int i = (t + 1) % numThreads; i < data.size(); i += numThreads) {
+        repo.findIndex(TestDataRepositoryItemRequest(data[i].constData(), data[i].length()));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void BenchItemRepository::concurrentInsertLookup_data()
+{
+  QTest::addColumn<int>("numThreads");
+
+  for (int numThreads = 1; numThreads <= 32; numThreads *= 2) {
+    QTest::newRow(qPrintable(QString::number(numThreads))) << numThreads;
+  }
+}
+
+void BenchItemRepository::concurrentInsertLookup()
+{
+  QFETCH(int, numThreads);
+
+  QVector<QByteArray> data;
+  for (const QString& item : generateData()) {
+    data << item.toUtf8();
+  }
+
+  const QString name = QStringLiteral("TestDataRepositoryConcurrent%1").arg(QTest::currentDataTag());
+  TestDataRepository repo(name);
+  QBENCHMARK_ONCE {
+    insertAndLookupConcurrently(data, repo, numThreads);
+  }
+  QCOMPARE(repo.statistics().totalItems, uint(data.size()));
+}
@@ -37,6 +37,10 @@ private Q_SLOTS:
     void removeDisk();
     void lookupKey();
     void lookupValue();
+    void coldLookup_data();
+    void coldLookup();
+    void concurrentInsertLookup_data();
+    void concurrentInsertLookup();
 
 private:
     QString m_repositoryPath = QDir::tempPath() + QStringLiteral("/bench_itemrepository");
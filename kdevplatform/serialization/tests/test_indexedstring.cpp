@@ -26,7 +26,9 @@
 #include <serialization/indexedstring.h>
 #include <QTest>
 
+#include <thread>
 #include <utility>
+#include <vector>
 
 QTEST_GUILESS_MAIN(TestIndexedString)
 
@@ -205,6 +207,41 @@ void TestIndexedString::bench_qSet()
   }
 }
 
+void TestIndexedString::bench_concurrentStrIndex_data()
+{
+  QTest::addColumn<int>("numThreads");
+  for (int numThreads = 1; numThreads <= 16; numThreads *= 2) {
+    QTest::newRow(qPrintable(QString::number(numThreads))) << numThreads;
+  }
+}
+
+void TestIndexedString::bench_concurrentStrIndex()
+{
+  QFETCH(int, numThreads);
+  const QVector<uint> indices = setupTest();
+  const QVector<QString> data = generateData();
+  QBENCHMARK {
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (int t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&indices, &data, numThreads, t]() {
+        // every thread reads all strings, while also interning its share of new ones
+        for (int i = 0; i < indices.size(); ++i) {
+          const QString str = IndexedString::fromIndex(indices[i]).str();
+          Q_UNUSED(str);
+          if (i % numThreads == t) {
+            IndexedString idx(data[i] + QLatin1String("/storm"));
+            Q_UNUSED(idx);
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+}
+
 void TestIndexedString::test()
 {
   QFETCH(QString, data);
@@ -44,6 +44,8 @@ private Q_SLOTS:
     void bench_hashString();
     void bench_kdevhash();
     void bench_qSet();
+    void bench_concurrentStrIndex_data();
+    void bench_concurrentStrIndex();
 
     void test();
     void test_data();
@@ -2,9 +2,16 @@
 #include <QTest>
 #include <serialization/itemrepository.h>
 #include <serialization/indexedstring.h>
+#include <QElapsedTimer>
 #include <stdlib.h>
 #include <time.h>
 
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 using namespace KDevelop;
 
 struct TestItem {
@@ -359,6 +366,74 @@ class TestItemRepository : public QObject {
        */
     }
 
+    void recoverFromCrashDuringStore()
+    {
+#ifndef Q_OS_UNIX
+      QSKIP("This test needs fork()");
+#else
+      const uint itemCount = 2000;
+      QVector<TestItem*> items;
+      QVector<uint> indices;
+      {
+        ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("CrashRecovery"));
+        for(uint i = 1; i <= itemCount; ++i) {
+          items << createItem(i, (i % 1000) + sizeof(TestItem));
+          indices << repository.index(TestItemRequest(*items.back(), true));
+        }
+        globalItemRepositoryRegistry().lockForWriting();
+        repository.store();
+        globalItemRepositoryRegistry().unlockForWriting();
+
+        const pid_t pid = fork();
+        QVERIFY(pid >= 0);
+        if(pid == 0) {
+          //Change the repository, and get killed before the directory is consistent again
+          for(uint i = 0; i < itemCount; i += 2)
+            repository.deleteItem(indices[i]);
+          for(uint i = 1; i <= itemCount; ++i) {
+            QScopedArrayPointer<TestItem> item(createItem(itemCount + i, (i % 1000) + sizeof(TestItem)));
+            repository.index(TestItemRequest(*item, true));
+          }
+          globalItemRepositoryRegistry().lockForWriting();
+          repository.store();
+          kill(getpid(), SIGKILL);
+        }
+
+        int status = 0;
+        QCOMPARE(waitpid(pid, &status, 0), pid);
+        QVERIFY(WIFSIGNALED(status));
+        //The repository is closed here without being stored, its state on disk is the one of the killed process
+      }
+
+      const QString path = globalItemRepositoryRegistry().path();
+      QVERIFY(QFile::exists(path + QLatin1String("/is_writing")));
+      {
+        //A record that was only partially written when the process was killed
+        QFile journal(path + QLatin1String("/journal"));
+        QVERIFY(journal.open(QIODevice::Append));
+        journal.write("\x01\x00\x00", 3);
+      }
+
+      QElapsedTimer timer;
+      timer.start();
+      QVERIFY(ItemRepositoryRegistry::recoverInterruptedWrite(path));
+      qDebug() << "recovered in" << timer.elapsed() << "ms";
+      QVERIFY(!QFile::exists(path + QLatin1String("/is_writing")));
+      QVERIFY(!QFile::exists(path + QLatin1String("/journal")));
+
+      ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("CrashRecovery"));
+      for(uint i = 0; i < itemCount; ++i) {
+        QCOMPARE(repository.findIndex(TestItemRequest(*items[i], true)), indices[i]);
+        QVERIFY(items[i]->equals(repository.itemFromIndex(indices[i])));
+        delete[] items[i];
+      }
+      for(uint i = 1; i <= itemCount; ++i) {
+        QScopedArrayPointer<TestItem> item(createItem(itemCount + i, (i % 1000) + sizeof(TestItem)));
+        QVERIFY(!repository.findIndex(TestItemRequest(*item, true)));
+      }
+#endif
+    }
+
 private:
     QString m_repositoryPath = QDir::tempPath() + QStringLiteral("/test_itemrepository");
 };
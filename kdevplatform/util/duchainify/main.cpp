@@ -31,7 +31,10 @@
 #include <language/duchain/problem.h>
 #include <language/duchain/persistentsymboltable.h>
 
+#include <serialization/itemrepositoryregistry.h>
+
 #include <interfaces/ilanguagecontroller.h>
+#include <interfaces/iplugincontroller.h>
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
 
@@ -40,11 +43,19 @@
 #include <QCommandLineOption>
 #include <QDebug>
 #include <QDirIterator>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QStringList>
+#include <QThread>
 #include <QTimer>
 
 #include <stdio.h>
 
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
 #include <KAboutData>
 #include <KLocalizedString>
 
@@ -77,13 +88,58 @@ void messageOutput(QtMsgType type, const QMessageLogContext& context, const QStr
 }
 
 
+/// Reads the canonical paths of the files in the compilation database @p fileName
+static bool readCompilationDatabaseFiles(const QString& fileName, QStringList* files)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::cerr << "Could not open " << qPrintable(fileName) << ": " << qPrintable(file.errorString()) << std::endl;
+        return false;
+    }
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error) {
+        std::cerr << "Invalid compilation database " << qPrintable(fileName) << ": " << qPrintable(error.errorString()) << std::endl;
+        return false;
+    }
+    if (!document.isArray()) {
+        std::cerr << "Invalid compilation database " << qPrintable(fileName) << ": the top-level value is not an array of compile commands" << std::endl;
+        return false;
+    }
+
+    QSet<QString> seen;
+    foreach (const QJsonValue& value, document.array()) {
+        const QJsonObject object = value.toObject();
+        const QDir directory(object.value(QStringLiteral("directory")).toString());
+        const QString path = QFileInfo(directory, object.value(QStringLiteral("file")).toString()).canonicalFilePath();
+        if (!path.isEmpty() && !seen.contains(path)) {
+            seen.insert(path);
+            *files << path;
+        }
+    }
+    return true;
+}
+
 Manager::Manager(QCommandLineParser* args) : m_total(0), m_args(args), m_allFilesAdded(0)
 {
 }
 
 void Manager::init()
 {
-    if(m_args->positionalArguments().isEmpty()) {
+    if (m_args->isSet(QStringLiteral("compile-commands"))) {
+        m_useCompilationDatabase = true;
+        if (!readCompilationDatabaseFiles(m_args->value(QStringLiteral("compile-commands")), &m_compilationDatabaseFiles)) {
+            QCoreApplication::exit(4);
+            return;
+        }
+        // the defines and includes manager provides the include paths and defines of the database, see main()
+        if (!ICore::self()->pluginController()->pluginForExtension(QStringLiteral("org.kdevelop.IDefinesAndIncludesManager"))) {
+            std::cerr << "The defines and includes manager plugin is not loaded, cannot use the compilation database" << std::endl;
+            QCoreApplication::exit(4);
+            return;
+        }
+    } else if(m_args->positionalArguments().isEmpty()) {
         std::cerr << "Need file or directory to duchainify" << std::endl;
         QCoreApplication::exit(1);
     }
@@ -137,6 +193,8 @@ void Manager::init()
             QCoreApplication::exit(3);
             return;
         }
+    } else if (m_useCompilationDatabase) {
+        ICore::self()->languageController()->backgroundParser()->setThreadCount(QThread::idealThreadCount());
     }
 
     // quit when everything is done
@@ -146,7 +204,27 @@ void Manager::init()
     // and quit when it's emitted
     connect(ICore::self()->languageController()->backgroundParser(), &BackgroundParser::hideProgress, this, &Manager::finish);
 
-    foreach (const auto& file, m_args->positionalArguments()) {
+    // with a compilation database, the paths given restrict the files to parse
+    QStringList files = m_args->positionalArguments();
+    if (m_useCompilationDatabase) {
+        const QStringList& databaseFiles = m_compilationDatabaseFiles;
+        if (files.isEmpty()) {
+            files = databaseFiles;
+        } else {
+            QStringList filtered;
+            foreach (const QString& path, files) {
+                const QString canonicalPath = QFileInfo(path).canonicalFilePath();
+                foreach (const QString& file, databaseFiles) {
+                    if (file == canonicalPath || file.startsWith(canonicalPath + QLatin1Char('/'))) {
+                        filtered << file;
+                    }
+                }
+            }
+            files = filtered;
+        }
+    }
+
+    foreach (const auto& file, files) {
         addToBackgroundParser(file, (TopDUContext::Features)features);
     }
     m_allFilesAdded = 1;
@@ -155,6 +233,7 @@ void Manager::init()
         std::cerr << "Added " << m_total << " files to the background parser" << std::endl;
         const int threads = ICore::self()->languageController()->backgroundParser()->threadCount();
         std::cerr << "parsing with " << threads << " threads" << std::endl;
+        m_timer.start();
         ICore::self()->languageController()->backgroundParser()->parseDocuments();
     } else {
         std::cerr << "no files added to the background parser" << std::endl;
@@ -168,6 +247,7 @@ void Manager::updateReady(const IndexedString& url, const ReferencedTopDUContext
     qDebug() << "finished" << url.toUrl().toLocalFile() << "success: " << (bool)topContext;
 
     m_waiting.remove(url.toUrl());
+    m_parsedBytes += QFileInfo(url.str()).size();
 
     std::cerr << "processed " << (m_total - m_waiting.size()) << " out of " << m_total << "\n";
     dump(topContext);
@@ -261,8 +341,67 @@ QSet< QUrl > Manager::waiting()
     return m_waiting;
 }
 
+void Manager::printStatistics()
+{
+    const double seconds = qMax<qint64>(m_timer.elapsed(), 1) / 1000.;
+    const uint processed = m_total - m_waiting.size();
+    std::cerr << "processed " << processed << " files in " << seconds << "s: "
+              << processed / seconds << " files/s, "
+              << m_parsedBytes / (1024. * 1024.) / seconds << " MB/s" << std::endl;
+
+#ifdef Q_OS_UNIX
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_DARWIN
+        const double peakRss = usage.ru_maxrss;
+#else
+        // kilobytes on Linux and the BSDs
+        const double peakRss = usage.ru_maxrss * 1024.;
+#endif
+        std::cerr << "peak RSS: " << peakRss / (1024. * 1024.) << " MB" << std::endl;
+    }
+#endif
+}
+
+bool Manager::exportCache(const QString& target)
+{
+    const QDir source(globalItemRepositoryRegistry().path());
+    if (!QDir().mkpath(target)) {
+        return false;
+    }
+
+    QDirIterator it(source.path(), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString sourceFile = it.next();
+        const QString targetFile = QDir(target).filePath(source.relativeFilePath(sourceFile));
+        QDir().mkpath(QFileInfo(targetFile).path());
+        QFile::remove(targetFile);
+        if (!QFile::copy(sourceFile, targetFile)) {
+            std::cerr << "could not copy " << qPrintable(sourceFile) << " to " << qPrintable(targetFile) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
 void Manager::finish()
 {
+    if (m_timer.isValid()) {
+        printStatistics();
+    }
+
+    if (m_args->isSet(QStringLiteral("export-cache"))) {
+        const QString target = m_args->value(QStringLiteral("export-cache"));
+        // write everything, then the cache can be copied consistently
+        DUChain::self()->storeToDisk();
+        if (!exportCache(target)) {
+            QCoreApplication::exit(5);
+            return;
+        }
+        std::cerr << "exported the DUChain cache to " << qPrintable(target) << std::endl;
+        std::cerr << "copy it into the DUChain cache directory of a session that sees the sources at the same paths" << std::endl;
+    }
+
     std::cerr << "ready" << std::endl;
     QApplication::quit();
 }
@@ -288,6 +427,8 @@ int main(int argc, char** argv)
     parser.addOption(QCommandLineOption{QStringList{QStringLiteral("u"), QStringLiteral("force-update")}, i18n("Enforce an update of the top-contexts corresponding to the given files")});
     parser.addOption(QCommandLineOption{QStringList{QStringLiteral("r"), QStringLiteral("force-update-recursive")}, i18n("Enforce an update of the top-contexts corresponding to the given files and all included files")});
     parser.addOption(QCommandLineOption{QStringList{QStringLiteral("t"), QStringLiteral("threads")}, i18n("Number of threads to use"), QStringLiteral("count")});
+    parser.addOption(QCommandLineOption{QStringList{QStringLiteral("c"), QStringLiteral("compile-commands")}, i18n("Parse the files of a compile_commands.json with their include paths and defines. Given paths only select the files to parse."), QStringLiteral("file")});
+    parser.addOption(QCommandLineOption{QStringList{QStringLiteral("export-cache")}, i18n("Copy the DUChain cache to the given directory when done"), QStringLiteral("directory")});
     parser.addOption(QCommandLineOption{QStringList{QStringLiteral("f"), QStringLiteral("features")}, i18n("Features to build. Options: empty, simplified-visible-declarations, visible-declarations (default), all-declarations, all-declarations-and-uses, all-declarations-and-uses-and-AST"), QStringLiteral("features")});
 
     parser.addOption(QCommandLineOption{QStringList{QStringLiteral("dump-context")}, i18n("Print complete Definition-Use Chain on successful parse")});
@@ -306,6 +447,11 @@ int main(int argc, char** argv)
     warnings = parser.isSet(QStringLiteral("warnings"));
     qInstallMessageHandler(messageOutput);
 
+    // read by the defines and includes manager plugin when it is loaded
+    if (parser.isSet(QStringLiteral("compile-commands"))) {
+        qputenv("KDEV_COMPILATION_DATABASE", QFile::encodeName(QFileInfo(parser.value(QStringLiteral("compile-commands"))).absoluteFilePath()));
+    }
+
     AutoTestShell::init();
     TestCore::initialize(Core::NoUi, QStringLiteral("duchainify"));
     Manager manager(&parser);
@@ -22,6 +22,7 @@
 
 #include <QObject>
 #include <QAtomicInt>
+#include <QElapsedTimer>
 #include <QUrl>
 
 #include <language/duchain/topducontext.h>
@@ -36,10 +37,18 @@ class Manager : public QObject {
         void addToBackgroundParser(const QString& path, KDevelop::TopDUContext::Features features);
         QSet<QUrl> waiting();
     private:
+        void printStatistics();
+        bool exportCache(const QString& target);
+
         QSet<QUrl> m_waiting;
         uint m_total;
         QCommandLineParser* m_args;
         QAtomicInt m_allFilesAdded;
+        // the files of the compilation database given with --compile-commands
+        QStringList m_compilationDatabaseFiles;
+        bool m_useCompilationDatabase = false;
+        QElapsedTimer m_timer;
+        qint64 m_parsedBytes = 0;
 
     public Q_SLOTS:
         // delay init into event loop so the DUChain can always shutdown gracefully
@@ -116,6 +116,24 @@ Path userDefinedPchIncludeForFile(const QString& sourcefile)
     return paths.isEmpty() ? Path() : paths.first();
 }
 
+/**
+ * @returns the start of @p sourcefile, enough to find its leading includes
+ */
+QByteArray leadingContents(const QString& sourcefile, const QVector<UnsavedFile>& unsavedFiles)
+{
+    for (const auto& unsavedFile : unsavedFiles) {
+        if (unsavedFile.fileName() == sourcefile) {
+            return unsavedFile.contents().join(QLatin1Char('\n')).toUtf8();
+        }
+    }
+
+    QFile file(sourcefile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.read(64 * 1024);
+}
+
 ProjectFileItem* findProjectFileItem(const IndexedString& url, bool* hasBuildSystemInfo)
 {
     ProjectFileItem* file = nullptr;
@@ -208,7 +226,13 @@ ClangParseJob::ClangParseJob(const IndexedString& url, ILanguageSupport* languag
     }
 
     if (auto tracker = trackerForUrl(url)) {
+        if (url == tuUrl) {
+            m_tracker = tracker;
+            m_changedLines = tracker->changedLinesSinceReset();
+            m_previousRevision = tracker->revisionAtLastReset();
+        }
         tracker->reset();
+        m_revision = tracker->revisionAtLastReset();
     }
 }
 
@@ -238,6 +262,10 @@ void ClangParseJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread*
         m_environment.addFrameworkDirectories(IDefinesAndIncludesManager::manager()->frameworkDirectoriesInBackground(tuUrlStr));
         m_environment.addDefines(IDefinesAndIncludesManager::manager()->definesInBackground(tuUrlStr));
         m_environment.setPchInclude(userDefinedPchIncludeForFile(tuUrlStr));
+        if (!m_environment.pchInclude().isValid() && ClangPreambleCache::isEnabled() && !ClangHelpers::isHeader(tuUrlStr)) {
+            const auto contents = leadingContents(tuUrlStr, m_unsavedFiles);
+            m_environment.setPchInclude(clang()->index()->preambleCache().prefixHeader(m_environment, contents));
+        }
     }
 
     if (abortRequested()) {
@@ -321,9 +349,17 @@ void ClangParseJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread*
 
     auto context = ClangHelpers::buildDUChain(session.mainFile(), imports, session,
                                               minimumFeatures(), includedFiles,
-                                              clang()->index(), [this] { return abortRequested(); });
+                                              clang()->index(), [this] { return abortRequested(); },
+                                              [this] (TopDUContext* context, qint64 previousRevision) {
+                                                  return changedLinesOfTranslationUnit(context, previousRevision);
+                                              });
     setDuChain(context);
 
+    const auto statistics = session.buildStatistics();
+    clangDebug() << "built" << statistics.builtFiles << "files with" << statistics.visitedCursors << "cursors for" << document()
+                 << "- skipped" << statistics.skippedFiles << "up-to-date files with" << statistics.skippedCursors << "top-level cursors"
+                 << "- updated" << statistics.updatedFunctionBodies << "function bodies only";
+
     if (abortRequested()) {
         return;
     }
@@ -377,7 +413,37 @@ void ClangParseJob::run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread*
 
 ParseSessionData::Ptr ClangParseJob::createSessionData() const
 {
-    return ParseSessionData::Ptr(new ParseSessionData(m_unsavedFiles, clang()->index(), m_environment, ParseSessionData::NoOption));
+    ParseSessionData::Options options = ParseSessionData::NoOption;
+    // documents open in an editor need a translation unit that can be reparsed
+    if (!(minimumFeatures() & (TopDUContext::AST | AttachASTWithoutUpdating)) && !m_tuDocumentIsUnsaved
+        && !trackerForUrl(m_environment.translationUnitUrl()))
+    {
+        options |= ParseSessionData::ParseInWorker;
+    }
+    return ParseSessionData::Ptr(new ParseSessionData(m_unsavedFiles, clang()->index(), m_environment, options));
+}
+
+RangeInRevision ClangParseJob::changedLinesOfTranslationUnit(TopDUContext* context, qint64 previousRevision)
+{
+    if (!m_changedLines.isValid() || !m_previousRevision || !m_revision
+        || (minimumFeatures() & TopDUContext::ForceUpdate))
+    {
+        return RangeInRevision::invalid();
+    }
+
+    // The lines were taken from the tracker when this job was created. They only describe all the changes
+    // of the duchain if it was built for the revision of the previous job, otherwise that job was aborted
+    // before building the lines it had taken, and everything is built again.
+    if (previousRevision != m_previousRevision->revision()) {
+        return RangeInRevision::invalid();
+    }
+
+    // the ranges of the existing DUChain must match the parsed contents, before only a part of it gets updated
+    if (!translateDUChainToRevision(context, m_tracker.data(), previousRevision, m_revision->revision())) {
+        return RangeInRevision::invalid();
+    }
+
+    return {m_changedLines.start().line(), 0, m_changedLines.end().line(), 0};
 }
 
 const ParsingEnvironment* ClangParseJob::environment() const
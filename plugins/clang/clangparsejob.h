@@ -26,6 +26,7 @@
 #include <QHash>
 
 #include <language/backgroundparser/parsejob.h>
+#include <language/backgroundparser/documentchangetracker.h>
 #include "duchain/clangparsingenvironment.h"
 #include "duchain/unsavedfile.h"
 
@@ -54,11 +55,17 @@ protected:
 
 private:
     QExplicitlySharedDataPointer<ParseSessionData> createSessionData() const;
+    KDevelop::RangeInRevision changedLinesOfTranslationUnit(KDevelop::TopDUContext* context, qint64 previousRevision);
 
     ClangParsingEnvironment m_environment;
     QVector<UnsavedFile> m_unsavedFiles;
     bool m_tuDocumentIsUnsaved = false;
     QHash<KDevelop::IndexedString, KDevelop::ModificationRevision> m_unsavedRevisions;
+    // the lines of the translation unit that were edited since its DUChain was built, and the revisions before and after
+    QPointer<KDevelop::DocumentChangeTracker> m_tracker;
+    KTextEditor::Range m_changedLines;
+    KDevelop::RevisionReference m_previousRevision;
+    KDevelop::RevisionReference m_revision;
 };
 
 #endif // CLANGPARSEJOB_H
@@ -55,8 +55,10 @@
 #include "../duchain/navigationwidget.h"
 #include "../clangsettings/clangsettingsmanager.h"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
+#include <numeric>
 
 #include <KTextEditor/Document>
 #include <KTextEditor/View>
@@ -933,6 +935,44 @@ QList<CompletionTreeItemPointer> ClangCodeCompletionContext::completionItems(boo
         return {};
     }
 
+    QVector<uint> indices(m_results->NumResults);
+    std::iota(indices.begin(), indices.end(), 0u);
+    return createItems(abort, indices, true);
+}
+
+QList<CompletionTreeItemPointer> ClangCodeCompletionContext::bestMatchItems(bool& abort, int count)
+{
+    if (!m_valid || !m_duContext || !m_results) {
+        return {};
+    }
+
+    QVector<QPair<uint, uint>> ranked;
+    ranked.reserve(m_results->NumResults);
+    for (uint i = 0; i < m_results->NumResults; ++i) {
+        const auto& result = m_results->Results[i];
+        if (result.CursorKind == CXCursor_MacroDefinition || result.CursorKind == CXCursor_NotImplemented) {
+            continue;
+        }
+        ranked.append({clang_getCompletionPriority(result.CompletionString), i});
+    }
+    const auto end = ranked.begin() + qMin(count, ranked.size());
+    std::partial_sort(ranked.begin(), end, ranked.end());
+
+    QVector<uint> indices;
+    indices.reserve(end - ranked.begin());
+    for (auto it = ranked.begin(); it != end; ++it) {
+        indices.append(it->second);
+    }
+    return createItems(abort, indices, false);
+}
+
+int ClangCodeCompletionContext::resultCount() const
+{
+    return m_results ? m_results->NumResults : 0;
+}
+
+QList<CompletionTreeItemPointer> ClangCodeCompletionContext::createItems(bool& abort, const QVector<uint>& indices, bool addGroups)
+{
     const auto ctx = DUContextPointer(m_duContext->findContextAt(m_position));
 
     /// Normal completion items, such as 'void Foo::foo()'
@@ -955,9 +995,9 @@ QList<CompletionTreeItemPointer> ClangCodeCompletionContext::completionItems(boo
     // If ctx is/inside the Class context, this represents that context.
     const auto currentClassContext = classDeclarationForContext(ctx, m_position);
 
-    clangDebug() << "Clang found" << m_results->NumResults << "completion results";
+    clangDebug() << "Creating items for" << indices.size() << "of the" << m_results->NumResults << "completion results";
 
-    for (uint i = 0; i < m_results->NumResults; ++i) {
+    for (const uint i : indices) {
         if (abort) {
             return {};
         }
@@ -1220,13 +1260,15 @@ QList<CompletionTreeItemPointer> ClangCodeCompletionContext::completionItems(boo
         return {};
     }
 
-    addImplementationHelperItems();
-    addOverwritableItems();
+    if (addGroups) {
+        addImplementationHelperItems();
+        addOverwritableItems();
 
-    eventuallyAddGroup(i18n("Special"), 700, specialItems);
-    eventuallyAddGroup(i18n("Look-ahead Matches"), 800, lookAheadMatcher.matchedItems());
-    eventuallyAddGroup(i18n("Builtin"), 900, builtin);
-    eventuallyAddGroup(i18n("Macros"), 1000, macros);
+        eventuallyAddGroup(i18n("Special"), 700, specialItems);
+        eventuallyAddGroup(i18n("Look-ahead Matches"), 800, lookAheadMatcher.matchedItems());
+        eventuallyAddGroup(i18n("Builtin"), 900, builtin);
+        eventuallyAddGroup(i18n("Macros"), 1000, macros);
+    }
     return items;
 }
 
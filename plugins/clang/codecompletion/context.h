@@ -56,12 +56,25 @@ public:
 
     QList<KDevelop::CompletionTreeItemPointer> completionItems(bool& abort, bool fullCompletion = true) override;
 
+    /**
+     * Computes the items for the @p count declaration results with the best priority.
+     *
+     * These are separate from the items of completionItems(), and can be shown while those are computed.
+     */
+    QList<KDevelop::CompletionTreeItemPointer> bestMatchItems(bool& abort, int count);
+
+    /// The number of results found by clang, before any filtering
+    int resultCount() const;
+
     QList<KDevelop::CompletionTreeElementPointer> ungroupedElements() override;
 
     ContextFilters filters() const;
     void setFilters(const ContextFilters& filters);
 
 private:
+    /// Creates the items for the results at @p indices, and when @p addGroups is set, the groups of the context
+    QList<KDevelop::CompletionTreeItemPointer> createItems(bool& abort, const QVector<uint>& indices, bool addGroups);
+
     void addOverwritableItems();
     void addImplementationHelperItems();
 
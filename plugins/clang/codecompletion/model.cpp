@@ -33,12 +33,15 @@
 #include <language/duchain/topducontext.h>
 #include <language/duchain/duchainutils.h>
 #include <language/duchain/duchainlock.h>
+#include <language/duchain/parsingenvironment.h>
 
 #include <KTextEditor/View>
 #include <KTextEditor/Document>
 
 #include <QTimer>
 
+#include <algorithm>
+
 using namespace KDevelop;
 
 namespace {
@@ -48,6 +51,20 @@ bool isSpaceOnly(const QString& string)
     return std::find_if(string.begin(), string.end(), [] (const QChar c) { return !c.isSpace(); }) == string.end();
 }
 
+/// Number of results from which on the best matches are shown before the items for all results are created
+const int streamingThreshold = 500;
+/// Number of best matches shown first
+const int bestMatchesCount = 50;
+
+/// @return the length of the identifier at the start of @p text
+int identifierLength(const QString& text)
+{
+    const auto end = std::find_if(text.begin(), text.end(), [] (const QChar c) {
+        return !c.isLetterOrNumber() && c != QLatin1Char('_');
+    });
+    return end - text.begin();
+}
+
 bool includePathCompletionRequired(const QString& text)
 {
     const auto properties = IncludePathProperties::parseText(text);
@@ -79,13 +96,15 @@ public:
     ~ClangCodeCompletionWorker() override = default;
 
 public Q_SLOTS:
-    void completionRequested(const QUrl &url, const KTextEditor::Cursor& position, const QString& text, const QString& followingText)
+    void completionRequested(const QUrl &url, const KTextEditor::Cursor& position, const QString& text, const QString& followingText,
+                             bool reuseResults)
     {
         // group requests and only handle the latest one
         m_url = url;
         m_position = position;
         m_text = text;
         m_followingText = followingText;
+        m_reuseResults = reuseResults;
 
         if (!m_timer) {
             // lazy-load the timer to initialize it in the background thread
@@ -108,6 +127,11 @@ private:
             return;
         }
 
+        if (m_reuseResults && reuseCachedCompletion()) {
+            return;
+        }
+        m_cache = {};
+
         auto top = DUChainUtils::standardContextForUrl(m_url);
         if (!top) {
             qCWarning(KDEV_CLANG) << "No context found for" << m_url;
@@ -140,6 +164,19 @@ private:
         }
 
         bool abort = false;
+        const auto clangContext = completionContext.dynamicCast<ClangCodeCompletionContext>();
+        if (clangContext && clangContext->resultCount() > streamingThreshold) {
+            // show the best matches right away, creating the items for all the results takes a while
+            const auto bestMatches = clangContext->bestMatchItems(abort, bestMatchesCount);
+            if (aborting()) {
+                failed();
+                return;
+            }
+            if (!bestMatches.isEmpty()) {
+                foundDeclarations(computeGroups(bestMatches, {}), {});
+            }
+        }
+
         // NOTE: cursor might be wrong here, but shouldn't matter much I hope...
         //       when the document changed significantly, then the cache is off anyways and we don't get anything sensible
         //       the position here is just a "optimization" to only search up to that position
@@ -159,8 +196,47 @@ private:
 
         tree += completionContext->ungroupedElements();
 
+        if (clangContext && !tree.isEmpty()) {
+            m_cache.url = m_url;
+            m_cache.position = m_position;
+            m_cache.text = m_text;
+            m_cache.followingText = m_followingText.mid(identifierLength(m_followingText));
+            m_cache.revisions = modificationRevisions(top);
+            m_cache.tree = tree;
+        }
+
         foundDeclarations( tree, {} );
     }
+
+    /// @return the revisions of the file and of all its imports that @p top was built from
+    static QPair<ModificationRevision, ModificationRevisionSet> modificationRevisions(const TopDUContext* top)
+    {
+        const auto file = top->parsingEnvironmentFile();
+        if (!file) {
+            return {};
+        }
+        return qMakePair(file->modificationRevision(), file->allModificationRevisions());
+    }
+
+    /// Shows the previous results again, if only the identifier at the completion position changed since then
+    bool reuseCachedCompletion()
+    {
+        if (m_cache.tree.isEmpty() || m_cache.url != m_url || m_cache.position != m_position || m_cache.text != m_text
+            || m_cache.followingText != m_followingText.midRef(identifierLength(m_followingText)))
+        {
+            return false;
+        }
+        // a reparse may have deleted some of the declarations in the meantime
+        DUChainReadLocker lock;
+        const auto top = DUChainUtils::standardContextForUrl(m_url);
+        if (!top || modificationRevisions(top) != m_cache.revisions) {
+            return false;
+        }
+        clangDebug() << "reusing the completion results at" << m_position;
+        foundDeclarations(m_cache.tree, {});
+        return true;
+    }
+
 private:
     ClangIndex* m_index;
     QTimer* m_timer = nullptr;
@@ -168,6 +244,19 @@ private:
     KTextEditor::Cursor m_position;
     QString m_text;
     QString m_followingText;
+    bool m_reuseResults = false;
+
+    struct CachedCompletion
+    {
+        QUrl url;
+        KTextEditor::Cursor position;
+        QString text;
+        // the text following the identifier at the position
+        QString followingText;
+        QPair<ModificationRevision, ModificationRevisionSet> revisions;
+        QList<CompletionTreeElementPointer> tree;
+    };
+    CachedCompletion m_cache;
 };
 }
 
@@ -232,11 +321,13 @@ CodeCompletionWorker* ClangCodeCompletionModel::createCompletionWorker()
 }
 
 void ClangCodeCompletionModel::completionInvokedInternal(KTextEditor::View* view, const KTextEditor::Range& range,
-                                                         CodeCompletionModel::InvocationType /*invocationType*/, const QUrl &url)
+                                                         CodeCompletionModel::InvocationType invocationType, const QUrl &url)
 {
     auto text = view->document()->text({0, 0, range.start().line(), range.start().column()});
     auto followingText = view->document()->text({{range.start().line(), range.start().column()}, view->document()->documentEnd()});
-    emit requestCompletion(url, KTextEditor::Cursor(range.start()), text, followingText);
+    // while typing an identifier, the results for its start are the same, but an explicit request always computes them again
+    const bool reuseResults = invocationType == AutomaticInvocation;
+    emit requestCompletion(url, KTextEditor::Cursor(range.start()), text, followingText, reuseResults);
 }
 
 #include "model.moc"
@@ -44,7 +44,9 @@ public:
     bool shouldAbortCompletion(KTextEditor::View* view, const KTextEditor::Range& range, const QString& currentCompletion) override;
 
 Q_SIGNALS:
-    void requestCompletion(const QUrl &url, const KTextEditor::Cursor& cursor, const QString& text, const QString& followingText);
+    /// @p reuseResults allows to show the previous results again, if only the identifier at @p cursor changed since then
+    void requestCompletion(const QUrl &url, const KTextEditor::Cursor& cursor, const QString& text, const QString& followingText,
+                           bool reuseResults);
 
 protected:
     KDevelop::CodeCompletionWorker* createCompletionWorker() override;
@@ -35,6 +35,7 @@
 #include <util/pushvalue.h>
 
 #include <language/duchain/duchainlock.h>
+#include <language/duchain/duchainupdatebatch.h>
 #include <language/duchain/classdeclaration.h>
 #include <language/duchain/stringhelpers.h>
 #include <language/duchain/duchainutils.h>
@@ -321,8 +322,11 @@ struct CurrentContext
 //BEGIN Visitor
 struct Visitor
 {
-    explicit Visitor(CXTranslationUnit tu, CXFile file,
+    explicit Visitor(CXTranslationUnit tu, const QVector<CXCursor>& topLevelCursors, CXFile file,
                      const IncludeFileContexts& includes, const bool update);
+    /// Only update the existing @p bodyContext of a function from the compound statement @p body
+    explicit Visitor(CXCursor body, DUContext* bodyContext, const QVector<CXCursor>& macroExpansions, CXFile file,
+                     const IncludeFileContexts& includes);
 
     AbstractType *makeType(CXType type, CXCursor parent);
     AbstractType::Ptr makeAbsType(CXType type, CXCursor parent)
@@ -858,6 +862,7 @@ struct Visitor
 
     DeclarationPointer findDeclaration(CXCursor cursor) const;
     void setIdTypeDecl(CXCursor typeCursor, IdentifiedType* idType) const;
+    void createUses(TopDUContext* top);
 
     std::unordered_map<DUContext*, std::vector<CXCursor>> m_uses;
     /// At these location offsets (cf. @ref clang_getExpansionLocation) we encountered macro expansions
@@ -866,6 +871,7 @@ struct Visitor
     CurrentContext *m_parentContext;
 
     const bool m_update;
+    int m_visitedCursors = 0;
 };
 
 //BEGIN setTypeModifiers
@@ -1410,7 +1416,7 @@ RangeInRevision rangeInRevisionForUse(CXCursor cursor, CXCursorKind referencedCu
     return range;
 }
 
-Visitor::Visitor(CXTranslationUnit tu, CXFile file,
+Visitor::Visitor(CXTranslationUnit tu, const QVector<CXCursor>& topLevelCursors, CXFile file,
                  const IncludeFileContexts& includes, const bool update)
     : m_file(file)
     , m_includes(includes)
@@ -1443,12 +1449,72 @@ Visitor::Visitor(CXTranslationUnit tu, CXFile file,
 
     CurrentContext parent(top, keepAliveContexts);
     m_parentContext = &parent;
-    clang_visitChildren(tuCursor, &visitCursor, this);
+    // only walk the cursors of this file, the ones of all other files would be skipped anyways
+    for (const auto& cursor : topLevelCursors) {
+        const auto result = visitCursor(cursor, tuCursor, this);
+        if (result == CXChildVisit_Break
+            || (result == CXChildVisit_Recurse && clang_visitChildren(cursor, &visitCursor, this))) {
+            break;
+        }
+    }
 
     if (m_update) {
         DUChainWriteLocker lock;
         top->deleteUsesRecursively();
     }
+    createUses(top);
+}
+
+Visitor::Visitor(CXCursor body, DUContext* bodyContext, const QVector<CXCursor>& macroExpansions, CXFile file,
+                 const IncludeFileContexts& includes)
+    : m_file(file)
+    , m_includes(includes)
+    , m_parentContext(nullptr)
+    , m_update(true)
+{
+    auto top = includes[file];
+
+    DUContext* functionContext;
+    {
+        DUChainReadLocker lock;
+        functionContext = bodyContext->parentContext();
+    }
+    {
+        // the parameters and everything else of the function stay untouched, only the body is rebuilt
+        CurrentContext parent(functionContext, {});
+        parent.previousChildContexts = {bodyContext};
+        parent.previousChildDeclarations.clear();
+        m_parentContext = &parent;
+        buildCompoundStatement<CXCursor_CompoundStmt>(body);
+    }
+    {
+        CurrentContext parent(top, {});
+        parent.previousChildContexts.clear();
+        parent.previousChildDeclarations.clear();
+        m_parentContext = &parent;
+        for (const auto& cursor : macroExpansions) {
+            buildMacroExpansion(cursor);
+        }
+    }
+    m_parentContext = nullptr;
+
+    {
+        DUChainWriteLocker lock;
+        // the body context was matched by createContext, as it is the only previous child context
+        bodyContext->deleteUsesRecursively();
+        // the macro expansions in the body are uses of the top context
+        const auto bodyRange = bodyContext->range();
+        for (int i = top->usesCount() - 1; i >= 0; --i) {
+            if (bodyRange.contains(top->uses()[i].m_range)) {
+                top->deleteUse(i);
+            }
+        }
+    }
+    createUses(top);
+}
+
+void Visitor::createUses(TopDUContext* top)
+{
     for (const auto &contextUses : m_uses) {
         for (const auto &cursor : contextUses.second) {
             auto referenced = referencedCursor(cursor);
@@ -1512,6 +1578,7 @@ CXChildVisitResult visitCursor(CXCursor cursor, CXCursor parent, CXClientData da
     if (!ClangUtils::isFileEqual(file, visitor->m_file) && (file || kind != CXCursor_MemberRefExpr)) {
         return CXChildVisit_Continue;
     }
+    ++visitor->m_visitedCursors;
 
 #define UseCursorKind(CursorKind, ...) case CursorKind: return visitor->dispatchCursor<CursorKind>(__VA_ARGS__);
     switch (kind)
@@ -1583,9 +1650,72 @@ CXChildVisitResult visitCursor(CXCursor cursor, CXCursor parent, CXClientData da
 
 namespace Builder {
 
-void visit(CXTranslationUnit tu, CXFile file, const IncludeFileContexts& includes, const bool update)
+int visit(CXTranslationUnit tu, const QVector<CXCursor>& topLevelCursors, CXFile file,
+          const IncludeFileContexts& includes, const bool update)
+{
+    // store the uses and definitions of the whole file at once, after the visitor is done
+    DUChainUpdateBatch batch;
+    Visitor visitor(tu, topLevelCursors, file, includes, update);
+    return visitor.m_visitedCursors;
+}
+
+int visitFunctionBody(CXTranslationUnit tu, const QVector<CXCursor>& topLevelCursors, CXFile file,
+                      const IncludeFileContexts& includes, int firstChangedLine, int lastChangedLine)
 {
-    Visitor visitor(tu, file, includes, update);
+    auto top = includes[file];
+    DUContext* bodyContext = nullptr;
+    RangeInRevision bodyRange;
+    {
+        DUChainReadLocker lock;
+        // take the outermost function body, so that the lambdas in it are rebuilt along with it
+        // the lines of the braces must not have changed, as the body could then be a different one
+        for (auto ctx = top->findContextAt(CursorInRevision(firstChangedLine, 0)); ctx; ctx = ctx->parentContext()) {
+            const auto range = ctx->range();
+            if (ctx->type() == DUContext::Other && ctx->parentContext() && ctx->parentContext()->type() == DUContext::Function
+                && range.start.line < firstChangedLine && range.end.line > lastChangedLine)
+            {
+                bodyContext = ctx;
+                bodyRange = range;
+            }
+        }
+        if (!bodyContext) {
+            return -1;
+        }
+        // the macro definitions in the body are declarations of the top context, they may have been edited
+        const auto topDeclarations = top->localDeclarations();
+        for (auto declaration : topDeclarations) {
+            if (bodyRange.contains(declaration->range().start)) {
+                return -1;
+            }
+        }
+    }
+
+    const auto body = ClangUtils::getCXCursor(bodyRange.start.line, bodyRange.start.column, tu, file);
+    if (clang_getCursorKind(body) != CXCursor_CompoundStmt
+        || ClangRange(clang_getCursorExtent(body)).toRangeInRevision() != bodyRange)
+    {
+        clangDebug() << "function body at" << bodyRange << "was not found in the translation unit";
+        return -1;
+    }
+
+    QVector<CXCursor> macroExpansions;
+    for (const auto& cursor : topLevelCursors) {
+        const auto kind = clang_getCursorKind(cursor);
+        if (!clang_isPreprocessing(kind)
+            || !bodyRange.contains(CursorInRevision(ClangLocation(clang_getCursorLocation(cursor)))))
+        {
+            continue;
+        }
+        if (kind != CXCursor_MacroExpansion) {
+            // a new macro definition or include directive in the body
+            return -1;
+        }
+        macroExpansions.append(cursor);
+    }
+
+    DUChainUpdateBatch batch;
+    Visitor visitor(body, bodyContext, macroExpansions, file, includes);
+    return visitor.m_visitedCursors + macroExpansions.size();
 }
 
 }
@@ -27,15 +27,31 @@
 
 #include "clanghelpers.h"
 
+#include <QVector>
+
 namespace Builder {
 
 /**
  * Visit the AST in @p tu and build declarations for cursors belonging to @p file.
  * 
+ * @param topLevelCursors The top-level cursors of @p tu in @p file, see ParseSession::topLevelCursors().
+ *                        Cursors of other files are not visited at all.
  * @param update Set to true when an existing DUChain cache is getting updated.
+ * @return the number of visited cursors
+ */
+KDEVCLANGPRIVATE_EXPORT int visit(CXTranslationUnit tu, const QVector<CXCursor>& topLevelCursors, CXFile file,
+                                  const IncludeFileContexts& includes, const bool update);
+
+/**
+ * Update only the function body of @p file that contains the lines from @p firstChangedLine to @p lastChangedLine,
+ * after @p file was edited in there. The existing DUChain of @p file must already be in the revision of @p tu.
+ *
+ * @param topLevelCursors The top-level cursors of @p tu in @p file, used for the macro expansions in the body.
+ * @return the number of visited cursors, or -1 if the lines are not within a single function body,
+ *         the whole file must be visited then
  */
-KDEVCLANGPRIVATE_EXPORT void visit(CXTranslationUnit tu, CXFile file,
-                                   const IncludeFileContexts& includes, const bool update);
+KDEVCLANGPRIVATE_EXPORT int visitFunctionBody(CXTranslationUnit tu, const QVector<CXCursor>& topLevelCursors, CXFile file,
+                                              const IncludeFileContexts& includes, int firstChangedLine, int lastChangedLine);
 
 }
 
@@ -24,8 +24,10 @@
 #include <language/duchain/duchain.h>
 #include <language/duchain/duchainlock.h>
 #include <language/duchain/declaration.h>
+#include <language/duchain/includegraph.h>
 #include <language/duchain/parsingenvironment.h>
 #include <language/backgroundparser/urlparselock.h>
+#include <util/foregroundlock.h>
 
 #include "builder.h"
 #include "parsesession.h"
@@ -100,7 +102,8 @@ bool importLocationLessThan(const Import& lhs, const Import& rhs)
 
 ReferencedTopDUContext ClangHelpers::buildDUChain(CXFile file, const Imports& imports, const ParseSession& session,
                                                   TopDUContext::Features features, IncludeFileContexts& includedFiles,
-                                                  ClangIndex* index, const std::function<bool()>& abortFunction)
+                                                  ClangIndex* index, const std::function<bool()>& abortFunction,
+                                                  const ChangedLinesFunction& changedLines)
 {
     if (includedFiles.contains(file)) {
         return {};
@@ -130,8 +133,11 @@ ReferencedTopDUContext ClangHelpers::buildDUChain(CXFile file, const Imports& im
     const auto& environment = session.environment();
 
     bool update = false;
+    // the revision the existing duchain was completely built for, or -1 if it has no function bodies to update
+    qint64 previousRevision = -1;
     UrlParseLock urlLock(path);
     ReferencedTopDUContext context;
+    QVector<IndexedString> includes;
     {
         DUChainWriteLocker lock;
         context = DUChain::self()->chainForDocument(path, &environment);
@@ -155,12 +161,18 @@ ReferencedTopDUContext ClangHelpers::buildDUChain(CXFile file, const Imports& im
              *       and also update header files more often when other files included therein got updated.
              */
             if (path != environment.translationUnitUrl() && !envFile->needsUpdate(&environment) && envFile->featuresSatisfied(features)) {
+                DUChainBuildStatistics statistics;
+                statistics.skippedFiles = 1;
+                session.addBuildStatistics(statistics);
                 return context;
             } else {
                 //TODO: don't attempt to update if this environment is worse quality than the outdated one
                 if (index && envFile->environmentQuality() < environment.quality()) {
                     index->pinTranslationUnitForUrl(environment.translationUnitUrl(), path);
                 }
+                if (envFile->featuresSatisfied(TopDUContext::AllDeclarationsContextsAndUses)) {
+                    previousRevision = envFile->modificationRevision().revision;
+                }
                 envFile->setEnvironment(environment);
                 envFile->setModificationRevision(ModificationRevision::revisionForFile(context->url()));
             }
@@ -176,17 +188,61 @@ ReferencedTopDUContext ClangHelpers::buildDUChain(CXFile file, const Imports& im
                 continue;
             }
             context->addImportedParentContext(ctx, import.location);
+            includes.append(ctx->url());
         }
         context->updateImportsCache();
     }
 
+    IncludeGraph::self().setIncludes(path, includes);
+
     const auto problems = session.problemsForFile(file);
-    {
+    const auto topLevelCursors = session.topLevelCursors(file);
+    DUChainBuildStatistics statistics;
+    statistics.builtFiles = 1;
+    statistics.visitedCursors = -1;
+    if (previousRevision != -1 && changedLines) {
+        // The document revisions must be accessed in the foreground, and its lock must be taken before the duchain lock.
+        // The ranges are translated under the same write-lock that the body is rebuilt in, so the duchain never
+        // claims the new revision while the edited body is still stale.
+        ForegroundLock foregroundLock;
+        DUChainWriteLocker lock;
+        const auto lines = changedLines(context, previousRevision);
+        foregroundLock.unlock();
+        context->setProblems(problems);
+        if (lines.isValid()) {
+            statistics.visitedCursors = Builder::visitFunctionBody(session.unit(), topLevelCursors, file, includedFiles,
+                                                                   lines.start.line, lines.end.line);
+            statistics.updatedFunctionBodies = statistics.visitedCursors != -1;
+        }
+    } else {
         DUChainWriteLocker lock;
         context->setProblems(problems);
     }
 
-    Builder::visit(session.unit(), file, includedFiles, update);
+    // Opt-in: let the builders of unrelated files write to the DUChain concurrently
+    static const bool sharedWriteLock = qEnvironmentVariableIsSet("KDEV_CLANG_SHARED_DUCHAIN_WRITES");
+    if (statistics.visitedCursors == -1) {
+        if (sharedWriteLock) {
+            // the builder reads the contexts of the included files, they must not be built concurrently
+            uint topContext;
+            QVector<uint> importedTopContexts;
+            {
+                DUChainReadLocker lock;
+                topContext = context->ownIndex();
+                const auto recursiveImports = context->recursiveImportIndices();
+                for (auto it = recursiveImports.iterator(); it; ++it) {
+                    if ((*it).index() != topContext) {
+                        importedTopContexts.append((*it).index());
+                    }
+                }
+            }
+            DUChainSharedWriteLocker lock(topContext, importedTopContexts);
+            statistics.visitedCursors = Builder::visit(session.unit(), topLevelCursors, file, includedFiles, update);
+        } else {
+            statistics.visitedCursors = Builder::visit(session.unit(), topLevelCursors, file, includedFiles, update);
+        }
+    }
+    session.addBuildStatistics(statistics);
 
     DUChain::self()->emitUpdateReady(path, context);
 
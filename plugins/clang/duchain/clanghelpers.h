@@ -69,16 +69,26 @@ KDevelop::RangeInRevision cursorSpellingNameRange(CXCursor cursor, const KDevelo
  */
 KDEVCLANGPRIVATE_EXPORT Imports tuImports(CXTranslationUnit tu);
 
+using ChangedLinesFunction = std::function<KDevelop::RangeInRevision(KDevelop::TopDUContext* context, qint64 previousRevision)>;
+
 /**
  * Recursively builds a duchain with the specified @a features for the
  * @a file and each of its @a imports using the TU from @a session.
  * The resulting contexts are placed in @a includedFiles.
+ *
+ * When @a file already has a complete duchain, @a changedLines is called with it and the revision it was built for,
+ * while the foreground lock and the duchain write-lock are held. It must translate the duchain to the parsed revision
+ * and return the lines changed since @a previousRevision, or an invalid range if the whole file must be built.
+ * When these lines are all inside a single function body, only that body is rebuilt under the same write-lock,
+ * see Builder::visitFunctionBody().
+ *
  * @returns the context created for @a file
  */
 KDEVCLANGPRIVATE_EXPORT KDevelop::ReferencedTopDUContext buildDUChain(
     CXFile file, const Imports& imports, const ParseSession& session,
     KDevelop::TopDUContext::Features features, IncludeFileContexts& includedFiles,
-    ClangIndex* index = nullptr, const std::function<bool()>& abortFunction = {});
+    ClangIndex* index = nullptr, const std::function<bool()>& abortFunction = {},
+    const ChangedLinesFunction& changedLines = {});
 
 /**
  * @return List of possible header extensions used for definition/declaration fallback switching
@@ -31,6 +31,9 @@
 #include <language/backgroundparser/urlparselock.h>
 #include <language/duchain/duchainlock.h>
 #include <language/duchain/duchain.h>
+#include <language/duchain/includegraph.h>
+
+#include <QStandardPaths>
 
 #include <clang-c/Index.h>
 
@@ -39,6 +42,7 @@ using namespace KDevelop;
 ClangIndex::ClangIndex()
     // NOTE: We don't exclude PCH declarations. That way we could retrieve imports manually, as clang_getInclusions returns nothing on reparse with CXTranslationUnit_PrecompiledPreamble flag.
     : m_index(clang_createIndex(0 /*Exclude PCH Decls*/, qEnvironmentVariableIsSet("KDEV_CLANG_DISPLAY_DIAGS") /*Display diags*/))
+    , m_preambleCache(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QLatin1String("/kdevelop/clang-preambles"))
 {
     // demote the priority of the clang parse threads to reduce potential UI lockups
     // but the code completion threads still retain their normal priority to return
@@ -77,6 +81,16 @@ QSharedPointer<const ClangPCH> ClangIndex::pch(const ClangParsingEnvironment& en
     return pch;
 }
 
+ClangPreambleCache& ClangIndex::preambleCache()
+{
+    return m_preambleCache;
+}
+
+ClangParseWorkers& ClangIndex::parseWorkers()
+{
+    return m_parseWorkers;
+}
+
 ClangIndex::~ClangIndex()
 {
     clang_disposeIndex(m_index);
@@ -96,7 +110,23 @@ IndexedString ClangIndex::translationUnitForUrl(const IndexedString& url)
             return tu.value();
         }
     }
-    // if no explicit pin data is available, follow back the duchain import chain
+    // if no explicit pin data is available, follow back the include graph, that doesn't need to load any top context
+    {
+        IndexedString tu = url;
+        QSet<IndexedString> visited;
+        while (true) {
+            visited.insert(tu);
+            const auto includers = IncludeGraph::self().includers(tu);
+            if (includers.isEmpty() || visited.contains(includers.first())) {
+                break;
+            }
+            tu = includers.first();
+        }
+        if (tu != url && QFile::exists(tu.str())) {
+            return tu;
+        }
+    }
+    // then the duchain import chain, for files parsed before the include graph was maintained
     {
         DUChainReadLocker lock;
         TopDUContext* top = DUChain::self()->chainForDocument(url);
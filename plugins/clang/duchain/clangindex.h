@@ -23,6 +23,8 @@
 #define CLANGINDEX_H
 
 #include "clanghelpers.h"
+#include "clangparseworkers.h"
+#include "clangpreamblecache.h"
 
 #include "clangprivateexport.h"
 #include <serialization/indexedstring.h>
@@ -53,6 +55,16 @@ public:
      */
     QSharedPointer<const ClangPCH> pch(const ClangParsingEnvironment& environment);
 
+    /**
+     * @returns the cache of prefix headers shared between translation units
+     */
+    ClangPreambleCache& preambleCache();
+
+    /**
+     * @returns the helper processes to parse translation units out of process
+     */
+    ClangParseWorkers& parseWorkers();
+
     /**
      * Gets the currently pinned TU for @p url
      *
@@ -76,6 +88,9 @@ private:
     QReadWriteLock m_pchLock;
     QHash<KDevelop::Path, QSharedPointer<const ClangPCH>> m_pch;
 
+    ClangPreambleCache m_preambleCache;
+    ClangParseWorkers m_parseWorkers;
+
     QMutex m_mappingMutex;
     QHash<KDevelop::IndexedString, KDevelop::IndexedString> m_tuForUrl;
 };
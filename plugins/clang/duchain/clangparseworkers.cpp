@@ -0,0 +1,162 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "clangparseworkers.h"
+
+#include "parseworker/protocol.h"
+#include "util/clangdebug.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QList>
+#include <QPair>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <QThread>
+
+namespace {
+
+// a single translation unit that takes longer than this is considered to hang
+const int parseTimeout = 5 * 60 * 1000;
+
+int maximumWorkers()
+{
+    if (!qEnvironmentVariableIsSet("KDEV_CLANG_PARSE_WORKERS")) {
+        return 0;
+    }
+    const int count = qEnvironmentVariableIntValue("KDEV_CLANG_PARSE_WORKERS");
+    return count > 0 ? count : QThread::idealThreadCount();
+}
+
+}
+
+ClangParseWorkers::ClangParseWorkers()
+    : m_slots(maximumWorkers())
+{
+    if (!m_slots.available()) {
+        return;
+    }
+
+    const QString executable = QStringLiteral("kdev_clang_parse_worker");
+    m_executable = QStandardPaths::findExecutable(executable, {QCoreApplication::applicationDirPath()});
+    if (m_executable.isEmpty()) {
+        m_executable = QStandardPaths::findExecutable(executable);
+    }
+    if (m_executable.isEmpty()) {
+        qCWarning(KDEV_CLANG) << "KDEV_CLANG_PARSE_WORKERS is set, but" << executable << "was not found";
+    } else {
+        clangDebug() << "parsing in up to" << m_slots.available() << "helper processes,"
+                 << "clang diagnostics are not reported for the files they parse";
+    }
+}
+
+bool ClangParseWorkers::isEnabled() const
+{
+    return !m_executable.isEmpty();
+}
+
+ClangParseWorkers::Result ClangParseWorkers::parse(CXIndex index, const QByteArray& fileName, const QVector<const char*>& arguments,
+                                                   const QVector<CXUnsavedFile>& unsavedFiles, unsigned flags,
+                                                   CXTranslationUnit* unit, CXErrorCode* code)
+{
+    *unit = nullptr;
+    if (!isEnabled()) {
+        return Unavailable;
+    }
+
+    QTemporaryFile astFile(QDir::tempPath() + QLatin1String("/kdevclang-XXXXXX.ast"));
+    if (!astFile.open()) {
+        qCWarning(KDEV_CLANG) << "failed to create" << astFile.fileName() << astFile.errorString();
+        return LoadFailed;
+    }
+    astFile.close();
+
+    QByteArray request;
+    {
+        QList<QByteArray> requestArguments;
+        requestArguments.reserve(arguments.size());
+        for (const char* argument : arguments) {
+            requestArguments << QByteArray(argument);
+        }
+        QList<QPair<QByteArray, QByteArray>> requestUnsavedFiles;
+        requestUnsavedFiles.reserve(unsavedFiles.size());
+        for (const auto& unsavedFile : unsavedFiles) {
+            requestUnsavedFiles << qMakePair(QByteArray(unsavedFile.Filename),
+                                             QByteArray(unsavedFile.Contents, unsavedFile.Length));
+        }
+
+        QDataStream stream(&request, QIODevice::WriteOnly);
+        stream << quint32(ParseWorker::ProtocolVersion) << fileName << requestArguments << requestUnsavedFiles
+               << quint32(flags) << QFile::encodeName(astFile.fileName());
+    }
+
+    m_slots.acquire();
+    QProcess worker;
+    worker.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    worker.start(m_executable, QStringList());
+    bool finished = false;
+    if (worker.waitForStarted()) {
+        worker.write(request);
+        worker.closeWriteChannel();
+        finished = worker.waitForFinished(parseTimeout);
+        if (!finished) {
+            worker.kill();
+            worker.waitForFinished();
+        }
+    }
+    m_slots.release();
+
+    if (worker.error() == QProcess::FailedToStart) {
+        qCWarning(KDEV_CLANG) << "failed to start" << m_executable << worker.errorString();
+        return Unavailable;
+    }
+    if (!finished || worker.exitStatus() == QProcess::CrashExit) {
+        qCWarning(KDEV_CLANG) << "clang parse worker crashed or hang while parsing" << fileName;
+        *code = CXError_Crashed;
+        return Crashed;
+    }
+
+    switch (worker.exitCode()) {
+    case 0:
+        break;
+    case ParseWorker::InvalidRequest:
+        qCWarning(KDEV_CLANG) << m_executable << "rejected the request for" << fileName << "- does its version match?";
+        return Unavailable;
+    case ParseWorker::SaveFailed:
+        qCWarning(KDEV_CLANG) << "clang parse worker failed to save the translation unit of" << fileName;
+        return LoadFailed;
+    default:
+        clangDebug() << "clang parse worker failed to parse" << fileName << "error code" << worker.exitCode();
+        *code = static_cast<CXErrorCode>(worker.exitCode());
+        return *code == CXError_Crashed ? Crashed : ParseFailed;
+    }
+
+    // the AST file is read or mapped into memory while loading, so it can be removed afterwards
+    const CXErrorCode loadCode = clang_createTranslationUnit2(index, QFile::encodeName(astFile.fileName()).constData(), unit);
+    if (loadCode != CXError_Success) {
+        qCWarning(KDEV_CLANG) << "failed to load the translation unit of" << fileName << "parsed by the worker, error code" << loadCode;
+        *unit = nullptr;
+        return LoadFailed;
+    }
+    *code = CXError_Success;
+    return Parsed;
+}
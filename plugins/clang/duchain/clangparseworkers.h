@@ -0,0 +1,84 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLANGPARSEWORKERS_H
+#define CLANGPARSEWORKERS_H
+
+#include "clangprivateexport.h"
+
+#include <QSemaphore>
+#include <QString>
+#include <QVector>
+
+#include <clang-c/Index.h>
+
+/**
+ * Parses translation units in kdev_clang_parse_worker helper processes.
+ *
+ * Each translation unit is parsed by a new process, which saves it as AST file that is then loaded
+ * into our index. A crash of libclang thus only ends the helper process, and the memory libclang
+ * needs for parsing is returned to the system right after. Loading the AST is much cheaper than
+ * parsing, so more parse jobs can run in parallel.
+ *
+ * Enable with KDEV_CLANG_PARSE_WORKERS, set to the maximum number of helper processes running at
+ * the same time, or to 0 to use one per core.
+ *
+ * @note Translation units loaded from an AST file do not contain the diagnostics of the original parse,
+ *       so no clang errors and warnings are reported for the files parsed by the helpers until they
+ *       are parsed again in process, e.g. when opened in an editor. Translation units loaded from an
+ *       AST file can also not be reparsed. Hence only use this for files that are not open in an editor.
+ *
+ * This class is thread safe.
+ */
+class KDEVCLANGPRIVATE_EXPORT ClangParseWorkers
+{
+public:
+    ClangParseWorkers();
+
+    /// Whether KDEV_CLANG_PARSE_WORKERS is set and the helper executable was found
+    bool isEnabled() const;
+
+    enum Result {
+        Parsed,       ///< The translation unit was parsed and loaded
+        ParseFailed,  ///< libclang failed to parse the translation unit, parsing it in process fails as well
+        Crashed,      ///< libclang crashed or hang in the helper process, don't parse in process
+        Unavailable,  ///< The helper could not be started or rejected the request, parse in process instead
+        LoadFailed    ///< The parsed translation unit could not be saved or loaded, parse in process instead
+    };
+
+    /**
+     * Parse @p fileName in a helper process and load the result into @p index.
+     *
+     * The arguments are the same as for clang_parseTranslationUnit2().
+     *
+     * @param code Set to the error code of libclang for Parsed, ParseFailed and Crashed
+     */
+    Result parse(CXIndex index, const QByteArray& fileName, const QVector<const char*>& arguments,
+                 const QVector<CXUnsavedFile>& unsavedFiles, unsigned flags, CXTranslationUnit* unit,
+                 CXErrorCode* code);
+
+private:
+    Q_DISABLE_COPY(ClangParseWorkers)
+
+    QString m_executable;
+    QSemaphore m_slots;
+};
+
+#endif // CLANGPARSEWORKERS_H
@@ -25,6 +25,7 @@
 #include "clanghelpers.h"
 #include "util/clangtypes.h"
 #include "clangparsingenvironment.h"
+#include "clangindex.h"
 
 using namespace KDevelop;
 
@@ -48,14 +49,38 @@ ClangPCH::ClangPCH(const ClangParsingEnvironment& environment, ClangIndex* index
     const IndexedString doc(pchInclude.pathOrUrl());
 
     ClangParsingEnvironment pchEnv;
+    ParseSessionData::Options options = ParseSessionData::PrecompiledHeader;
+    auto& preambleCache = index->preambleCache();
+    const bool isPrefixHeader = preambleCache.isPrefixHeader(pchInclude);
+    if (isPrefixHeader) {
+        // the system includes of a prefix header must be found the same way as in the translation units using it
+        pchEnv.addIncludes(environment.includes().system);
+        pchEnv.addIncludes(environment.includes().project);
+        pchEnv.addFrameworkDirectories(environment.frameworkDirectories().system);
+        pchEnv.addFrameworkDirectories(environment.frameworkDirectories().project);
+        const auto defines = environment.defines();
+        QHash<QString, QString> pchDefines;
+        for (auto it = defines.constBegin(); it != defines.constEnd(); ++it) {
+            pchDefines.insert(it.key(), it.value());
+        }
+        pchEnv.addDefines(pchDefines);
+        pchEnv.setParserSettings(environment.parserSettings());
+        if (preambleCache.isUpToDate(pchInclude)) {
+            options |= ParseSessionData::LoadPrecompiledHeader;
+        }
+    }
     pchEnv.setPchInclude(Path());
     pchEnv.setTranslationUnitUrl(doc);
-    m_session.setData(ParseSessionData::Ptr(new ParseSessionData({}, index, pchEnv, ParseSessionData::PrecompiledHeader)));
+    m_session.setData(ParseSessionData::Ptr(new ParseSessionData({}, index, pchEnv, options)));
 
     if (!m_session.unit()) {
         return;
     }
 
+    if (isPrefixHeader && !options.testFlag(ParseSessionData::LoadPrecompiledHeader)) {
+        preambleCache.precompiledHeaderWritten(pchInclude, m_session.unit());
+    }
+
     auto imports = ClangHelpers::tuImports(m_session.unit());
     m_context = ClangHelpers::buildDUChain(m_session.mainFile(), imports, m_session, pchFeatures, m_includes);
 }
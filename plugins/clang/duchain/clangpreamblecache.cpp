@@ -0,0 +1,296 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "clangpreamblecache.h"
+
+#include "clangparsingenvironment.h"
+#include "util/clangdebug.h"
+#include "util/clangtypes.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QVector>
+
+#include <algorithm>
+
+using namespace KDevelop;
+
+namespace {
+
+const qint64 defaultMaximumSize = 2048;
+
+/**
+ * @returns the <...> includes at the start of @p contents, in their order
+ *
+ * Stops at the first "..." include, as everything behind it may depend on the macros it defines,
+ * and at the first line that is not an include, a comment or empty.
+ */
+QVector<QByteArray> systemIncludePrefix(const QByteArray& contents)
+{
+    QVector<QByteArray> includes;
+    bool inComment = false;
+    for (const QByteArray& rawLine : contents.split('\n')) {
+        QByteArray line = rawLine.trimmed();
+        if (inComment) {
+            const int end = line.indexOf("*/");
+            if (end == -1) {
+                continue;
+            }
+            inComment = false;
+            line = line.mid(end + 2).trimmed();
+        }
+        if (line.startsWith("/*")) {
+            const int end = line.indexOf("*/", 2);
+            if (end == -1) {
+                inComment = true;
+                continue;
+            }
+            line = line.mid(end + 2).trimmed();
+        }
+        if (line.isEmpty() || line.startsWith("//")) {
+            continue;
+        }
+
+        if (!line.startsWith('#')) {
+            break;
+        }
+        const QByteArray directive = line.mid(1).trimmed();
+        if (!directive.startsWith("include")) {
+            break;
+        }
+        const QByteArray file = directive.mid(7).trimmed();
+        if (file.startsWith('<')) {
+            const int end = file.indexOf('>');
+            if (end == -1) {
+                break;
+            }
+            includes << "#include " + file.left(end + 1);
+        } else {
+            // "..." or computed include
+            break;
+        }
+    }
+    return includes;
+}
+
+void addPaths(QCryptographicHash* hash, const char* option, const Path::List& paths)
+{
+    for (const Path& path : paths) {
+        hash->addData(option);
+        hash->addData(path.toLocalFile().toUtf8());
+        hash->addData("\n");
+    }
+}
+
+QString cacheKey(const ClangParsingEnvironment& environment, const QVector<QByteArray>& includes)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const QByteArray& include : includes) {
+        hash.addData(include);
+        hash.addData("\n");
+    }
+
+    const auto defines = environment.defines();
+    for (auto it = defines.constBegin(); it != defines.constEnd(); ++it) {
+        hash.addData(QByteArray(it.key().toUtf8() + '=' + it.value().toUtf8() + '\n'));
+    }
+
+    const auto includePaths = environment.includes();
+    addPaths(&hash, "-isystem", includePaths.system);
+    addPaths(&hash, "-I", includePaths.project);
+    const auto frameworkDirectories = environment.frameworkDirectories();
+    addPaths(&hash, "-iframework", frameworkDirectories.system);
+    addPaths(&hash, "-F", frameworkDirectories.project);
+
+    hash.addData(environment.parserSettings().parserOptions.toUtf8());
+    hash.addData(ClangString(clang_getClangVersion()).toByteArray());
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+qint64 modificationTime(const QString& fileName)
+{
+    return QFileInfo(fileName).lastModified().toMSecsSinceEpoch();
+}
+
+}
+
+ClangPreambleCache::ClangPreambleCache(const QString& directory)
+    : m_directory(directory)
+    , m_maximumSize((qEnvironmentVariableIsSet("KDEV_CLANG_PREAMBLE_CACHE_SIZE")
+                        ? qEnvironmentVariableIntValue("KDEV_CLANG_PREAMBLE_CACHE_SIZE") : defaultMaximumSize)
+                    * 1024 * 1024)
+{
+    QFile lastUseFile(QDir(directory).filePath(QStringLiteral("lastuse")));
+    if (lastUseFile.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&lastUseFile);
+        stream >> m_lastUse;
+    }
+}
+
+ClangPreambleCache::~ClangPreambleCache()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_used.isEmpty()) {
+        storeLastUse();
+    }
+}
+
+bool ClangPreambleCache::isEnabled()
+{
+    static const bool enabled = qEnvironmentVariableIsSet("KDEV_CLANG_SHARED_PREAMBLES");
+    return enabled;
+}
+
+Path ClangPreambleCache::prefixHeader(const ClangParsingEnvironment& environment, const QByteArray& contents)
+{
+    const auto includes = systemIncludePrefix(contents);
+    if (includes.isEmpty()) {
+        return {};
+    }
+
+    const QString key = cacheKey(environment, includes);
+    const Path prefixHeader(m_directory, key + QLatin1String(".h"));
+    const QString fileName = prefixHeader.toLocalFile();
+
+    QMutexLocker lock(&m_mutex);
+    m_lastUse[key] = QDateTime::currentMSecsSinceEpoch();
+    if (m_used.contains(key)) {
+        return prefixHeader;
+    }
+    m_used.insert(key);
+
+    // The first use in this session. Clang would refuse to use a precompiled header that is out of date,
+    // so remove it, it is then rebuilt by ClangIndex::pch().
+    if (QFile::exists(fileName + QLatin1String(".pch")) && !isUpToDate(prefixHeader)) {
+        clangDebug() << "removing outdated precompiled header" << fileName;
+        QFile::remove(fileName + QLatin1String(".pch"));
+        QFile::remove(fileName + QLatin1String(".deps"));
+    }
+
+    if (!QFile::exists(fileName)) {
+        QDir().mkpath(m_directory.toLocalFile());
+        QFile file(fileName + QLatin1String(".tmp"));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCWarning(KDEV_CLANG) << "could not write prefix header" << fileName;
+            return {};
+        }
+        for (const QByteArray& include : includes) {
+            file.write(include + '\n');
+        }
+        file.close();
+        // written completely before it is visible, it may be used by other translation units right away
+        QFile::rename(file.fileName(), fileName);
+    }
+
+    return prefixHeader;
+}
+
+bool ClangPreambleCache::isPrefixHeader(const Path& pchInclude) const
+{
+    return pchInclude.parent() == m_directory;
+}
+
+bool ClangPreambleCache::isUpToDate(const Path& prefixHeader) const
+{
+    const QString fileName = prefixHeader.toLocalFile();
+    const qint64 pchTime = modificationTime(fileName + QLatin1String(".pch"));
+
+    QFile depsFile(fileName + QLatin1String(".deps"));
+    if (!QFile::exists(fileName + QLatin1String(".pch")) || !depsFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&depsFile);
+    QStringList dependencies;
+    stream >> dependencies;
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    return std::all_of(dependencies.constBegin(), dependencies.constEnd(), [pchTime] (const QString& dependency) {
+        return QFile::exists(dependency) && modificationTime(dependency) <= pchTime;
+    });
+}
+
+void ClangPreambleCache::precompiledHeaderWritten(const Path& prefixHeader, CXTranslationUnit unit)
+{
+    QStringList dependencies;
+    clang_getInclusions(unit, [] (CXFile file, CXSourceLocation* /*stack*/, unsigned /*stackDepth*/, CXClientData data) {
+        static_cast<QStringList*>(data)->append(ClangString(clang_getFileName(file)).toString());
+    }, &dependencies);
+
+    QFile depsFile(prefixHeader.toLocalFile() + QLatin1String(".deps"));
+    if (depsFile.open(QIODevice::WriteOnly)) {
+        QDataStream stream(&depsFile);
+        stream << dependencies;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    evict();
+    storeLastUse();
+}
+
+void ClangPreambleCache::evict()
+{
+    const QDir directory(m_directory.toLocalFile());
+    const auto pchFiles = directory.entryInfoList({QStringLiteral("*.h.pch")}, QDir::Files);
+
+    qint64 size = 0;
+    QVector<QPair<qint64, QString>> evictable;
+    for (const QFileInfo& pchFile : pchFiles) {
+        size += pchFile.size();
+        const QString key = pchFile.fileName().left(pchFile.fileName().size() - 6);
+        if (!m_used.contains(key)) {
+            evictable.append({m_lastUse.value(key), key});
+        }
+    }
+    if (size <= m_maximumSize) {
+        return;
+    }
+
+    std::sort(evictable.begin(), evictable.end());
+    for (const auto& entry : evictable) {
+        if (size <= m_maximumSize) {
+            break;
+        }
+        const QString fileName = directory.filePath(entry.second + QLatin1String(".h"));
+        size -= QFileInfo(fileName + QLatin1String(".pch")).size();
+        QFile::remove(fileName + QLatin1String(".pch"));
+        QFile::remove(fileName + QLatin1String(".deps"));
+        QFile::remove(fileName + QLatin1String(".defines"));
+        QFile::remove(fileName);
+        m_lastUse.remove(entry.second);
+        clangDebug() << "evicted precompiled header" << fileName;
+    }
+}
+
+void ClangPreambleCache::storeLastUse() const
+{
+    QFile lastUseFile(QDir(m_directory.toLocalFile()).filePath(QStringLiteral("lastuse")));
+    if (lastUseFile.open(QIODevice::WriteOnly)) {
+        QDataStream stream(&lastUseFile);
+        stream << m_lastUse;
+    }
+}
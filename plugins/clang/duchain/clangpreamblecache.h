@@ -0,0 +1,91 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLANGPREAMBLECACHE_H
+#define CLANGPREAMBLECACHE_H
+
+#include "clangprivateexport.h"
+
+#include <util/path.h>
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+
+#include <clang-c/Index.h>
+
+class ClangParsingEnvironment;
+
+/**
+ * Shares precompiled headers between translation units that start with the same system includes.
+ *
+ * The leading block of <...> includes of a translation unit is written into a prefix header that is
+ * named after a hash of those includes and of everything else that affects how they are compiled.
+ * The prefix header is then used as PCH include, so all translation units with the same prefix share
+ * one precompiled header, see ClangIndex::pch().
+ *
+ * Prefix headers, their precompiled headers and the defines they are built with stay on disk between sessions. The least recently
+ * used ones are removed when the precompiled headers exceed the size limit, which can be set in MiB
+ * with the KDEV_CLANG_PREAMBLE_CACHE_SIZE environment variable.
+ *
+ * This class is thread safe.
+ */
+class KDEVCLANGPRIVATE_EXPORT ClangPreambleCache
+{
+public:
+    explicit ClangPreambleCache(const QString& directory);
+    ~ClangPreambleCache();
+
+    /// Whether translation units should use shared prefix headers, enabled with KDEV_CLANG_SHARED_PREAMBLES
+    static bool isEnabled();
+
+    /**
+     * @returns the prefix header for a translation unit with @p contents parsed in @p environment,
+     *          or an invalid path if it doesn't start with system includes
+     */
+    KDevelop::Path prefixHeader(const ClangParsingEnvironment& environment, const QByteArray& contents);
+
+    /// Whether @p pchInclude is a prefix header of this cache
+    bool isPrefixHeader(const KDevelop::Path& pchInclude) const;
+
+    /// Whether the precompiled header of @p prefixHeader on disk is newer than all headers it contains
+    bool isUpToDate(const KDevelop::Path& prefixHeader) const;
+
+    /// Records the headers contained in the precompiled header @p unit that was written for @p prefixHeader,
+    /// and removes the least recently used entries if the cache is too large
+    void precompiledHeaderWritten(const KDevelop::Path& prefixHeader, CXTranslationUnit unit);
+
+private:
+    Q_DISABLE_COPY(ClangPreambleCache)
+
+    void evict();
+    void storeLastUse() const;
+
+    const KDevelop::Path m_directory;
+    const qint64 m_maximumSize;
+
+    mutable QMutex m_mutex;
+    // Time of the last use in milliseconds since the epoch for every key
+    QHash<QString, qint64> m_lastUse;
+    // Keys used in this session, those are never evicted
+    QSet<QString> m_used;
+};
+
+#endif // CLANGPREAMBLECACHE_H
@@ -77,11 +77,8 @@ ClangFixits fixitsForDiagnostic(CXDiagnostic diagnostic)
         CXSourceRange range;
         const QString replacementText = ClangString(clang_getDiagnosticFixIt(diagnostic, i, &range)).toString();
 
-        const auto docRange = ClangRange(range).toDocumentRange();
-        auto doc = KDevelop::ICore::self()->documentController()->documentForUrl(docRange.document.toUrl());
-        const QString original = doc ? doc->text(docRange) : QString{};
-
-        fixits << ClangFixit{replacementText, docRange, QString(), original};
+        // the current text is looked up when the actions are created, see ClangFixitAssistant::createActions()
+        fixits << ClangFixit{replacementText, ClangRange(range).toDocumentRange(), QString(), QString()};
     }
     return fixits;
 }
@@ -216,7 +213,14 @@ void ClangFixitAssistant::createActions()
 {
     KDevelop::IAssistant::createActions();
 
-    for (const ClangFixit& fixit : qAsConst(m_fixits)) {
+    auto documentController = ICore::self()->documentController();
+    for (ClangFixit fixit : qAsConst(m_fixits)) {
+        if (fixit.currentText.isEmpty()) {
+            auto doc = documentController->documentForUrl(fixit.range.document.toUrl());
+            if (doc) {
+                fixit.currentText = doc->text(fixit.range);
+            }
+        }
         addAction(IAssistantAction::Ptr(new ClangFixitAction(fixit)));
     }
 }
@@ -36,6 +36,7 @@
 
 #include <language/duchain/duchainlock.h>
 #include <language/duchain/duchain.h>
+#include <qtcompat_p.h>
 
 #include <KShell>
 
@@ -43,6 +44,7 @@
 #include <QFileInfo>
 #include <QMimeDatabase>
 #include <QMimeType>
+#include <QSet>
 
 #include <algorithm>
 
@@ -191,6 +193,21 @@ QVector<CXUnsavedFile> toClangApi(const QVector<UnsavedFile>& unsavedFiles)
     return unsaved;
 }
 
+void writeDefines(QIODevice* device, const QMap<QString, QString>& defines)
+{
+    QTextStream definesStream(device);
+    // don't show warnings about redefined macros
+    definesStream << "#pragma clang system_header\n";
+    for (auto it = defines.begin(); it != defines.end(); ++it) {
+        if (it.key().startsWith(QLatin1String("__has_include("))
+            || it.key().startsWith(QLatin1String("__has_include_next(")))
+        {
+            continue;
+        }
+        definesStream << QStringLiteral("#define ") << it.key() << ' ' << it.value() << '\n';
+    }
+}
+
 bool hasQtIncludes(const Path::List& includePaths)
 {
     return std::find_if(includePaths.begin(), includePaths.end(), [] (const Path& path) {
@@ -229,6 +246,18 @@ ParseSessionData::ParseSessionData(const QVector<UnsavedFile>& unsavedFiles, Cla
     const auto tuUrl = environment.translationUnitUrl();
     Q_ASSERT(!tuUrl.isEmpty());
 
+    if (options.testFlag(LoadPrecompiledHeader)) {
+        const CXErrorCode code = clang_createTranslationUnit2(index->index(),
+            QByteArray(tuUrl.byteArray() + ".pch").constData(), &m_unit);
+        if (code == CXError_Success) {
+            setUnit(m_unit);
+            m_environment = environment;
+            return;
+        }
+        clangDebug() << "failed to load precompiled header, parsing it instead:" << tuUrl << code;
+        m_unit = nullptr;
+    }
+
     const auto arguments = argsForSession(tuUrl.str(), options, environment.parserSettings());
     QVector<const char*> clangArguments;
 
@@ -277,7 +306,9 @@ ParseSessionData::ParseSessionData(const QVector<UnsavedFile>& unsavedFiles, Cla
     smartArgs << ClangIntegration::DUChainUtils::clangBuiltinIncludePath().toUtf8();
     clangArguments << "-isystem" << smartArgs.last().constData();
 
-    smartArgs << writeDefinesFile(environment.defines());
+    // the precompiled header of a prefix header is reused in later sessions, so its defines file must stay
+    const bool isPrefixHeader = options.testFlag(PrecompiledHeader) && index->preambleCache().isPrefixHeader(Path(tuUrl.str()));
+    smartArgs << writeDefinesFile(environment.defines(), isPrefixHeader ? tuUrl.str() + QLatin1String(".defines") : QString());
     clangArguments << "-imacros" << smartArgs.last().constData();
 
     // append extra args from environment variable
@@ -302,13 +333,26 @@ ParseSessionData::ParseSessionData(const QVector<UnsavedFile>& unsavedFiles, Cla
         out << " " << tuUrl.byteArray().constData() << "\n";
     }
 
-    const CXErrorCode code = clang_parseTranslationUnit2(
-        index->index(), tuUrl.byteArray().constData(),
-        clangArguments.constData(), clangArguments.size(),
-        unsaved.data(), unsaved.size(),
-        flags,
-        &m_unit
-    );
+    CXErrorCode code = CXError_Failure;
+    bool parseInProcess = true;
+    if (options.testFlag(ParseInWorker) && index->parseWorkers().isEnabled()) {
+        const auto result = index->parseWorkers().parse(index->index(), tuUrl.byteArray(), clangArguments,
+                                                        unsaved, flags, &m_unit, &code);
+        // only fall back when the worker itself failed, libclang would fail or crash in process the same way
+        parseInProcess = (result == ClangParseWorkers::Unavailable || result == ClangParseWorkers::LoadFailed);
+        if (parseInProcess) {
+            qCWarning(KDEV_CLANG) << "parsing" << tuUrl.str() << "in process, the clang parse worker failed";
+        }
+    }
+    if (parseInProcess) {
+        code = clang_parseTranslationUnit2(
+            index->index(), tuUrl.byteArray().constData(),
+            clangArguments.constData(), clangArguments.size(),
+            unsaved.data(), unsaved.size(),
+            flags,
+            &m_unit
+        );
+    }
     if (code != CXError_Success) {
         qCWarning(KDEV_CLANG) << "clang_parseTranslationUnit2 return with error code" << code;
         if (!qEnvironmentVariableIsSet("KDEV_CLANG_DISPLAY_DIAGS")) {
@@ -333,24 +377,28 @@ ParseSessionData::~ParseSessionData()
     clang_disposeTranslationUnit(m_unit);
 }
 
-QByteArray ParseSessionData::writeDefinesFile(const QMap<QString, QString>& defines)
+QByteArray ParseSessionData::writeDefinesFile(const QMap<QString, QString>& defines, const QString& fileName)
 {
-    m_definesFile.open();
-    Q_ASSERT(m_definesFile.isWritable());
-
-    {
-        QTextStream definesStream(&m_definesFile);
-        // don't show warnings about redefined macros
-        definesStream << "#pragma clang system_header\n";
-        for (auto it = defines.begin(); it != defines.end(); ++it) {
-            if (it.key().startsWith(QLatin1String("__has_include("))
-                || it.key().startsWith(QLatin1String("__has_include_next(")))
-            {
-                continue;
+    if (!fileName.isEmpty()) {
+        // the defines are part of the name of the prefix header, so an existing file has the same contents
+        // and is not touched, precompiled headers built with it stay up to date
+        if (!QFile::exists(fileName)) {
+            QFile file(fileName + QLatin1String(".tmp"));
+            if (file.open(QIODevice::WriteOnly)) {
+                writeDefines(&file, defines);
+                file.close();
+                QFile::rename(file.fileName(), fileName);
             }
-            definesStream << QStringLiteral("#define ") << it.key() << ' ' << it.value() << '\n';
         }
+        if (QFile::exists(fileName)) {
+            return fileName.toUtf8();
+        }
+        qCWarning(KDEV_CLANG) << "could not write defines file" << fileName;
     }
+
+    m_definesFile.open();
+    Q_ASSERT(m_definesFile.isWritable());
+    writeDefines(&m_definesFile, defines);
     m_definesFile.close();
 
     if (qEnvironmentVariableIsSet("KDEV_CLANG_DISPLAY_DEFINES")) {
@@ -370,6 +418,13 @@ void ParseSessionData::setUnit(CXTranslationUnit unit)
 {
     m_unit = unit;
     m_diagnosticsCache.clear();
+    m_diagnosticsByFile.clear();
+    m_propagatedDiagnostics.clear();
+    m_diagnosticsGrouped = false;
+    m_topLevelCursors.clear();
+    m_topLevelCursorGroups.clear();
+    m_topLevelCursorsCollected = false;
+    m_buildStatistics = {};
     if (m_unit) {
         const ClangString unitFile(clang_getTranslationUnitSpelling(unit));
         m_file = clang_getFile(m_unit, unitFile.c_str());
@@ -438,29 +493,55 @@ QList<ProblemPointer> ParseSession::problemsForFile(CXFile file) const
 
     // extra clang diagnostics
     const uint numDiagnostics = clang_getNumDiagnostics(d->m_unit);
-    problems.reserve(numDiagnostics);
-    d->m_diagnosticsCache.resize(numDiagnostics);
-
-    for (uint i = 0; i < numDiagnostics; ++i) {
-        auto diagnostic = clang_getDiagnostic(d->m_unit, i);
-
-        CXSourceLocation location = clang_getDiagnosticLocation(diagnostic);
-        CXFile diagnosticFile;
-        clang_getFileLocation(location, &diagnosticFile, nullptr, nullptr, nullptr);
-        // missing-include problems are so severe in clang that we always propagate
-        // them to this document, to ensure that the user will see the error.
-        if (diagnosticFile != file && ClangDiagnosticEvaluator::diagnosticType(diagnostic) != ClangDiagnosticEvaluator::IncludeFileNotFoundProblem) {
-            continue;
+    if (!d->m_diagnosticsGrouped) {
+        // group the diagnostics by file once, instead of looking at all of them for every file of the translation unit
+        d->m_diagnosticsGrouped = true;
+        d->m_diagnosticsCache.resize(numDiagnostics);
+        // the same diagnostic can be reported more than once, e.g. for a header included twice.
+        // Only the first one is kept, so the others are never turned into problems
+        QSet<QByteArray> reported;
+        for (uint i = 0; i < numDiagnostics; ++i) {
+            auto diagnostic = clang_getDiagnostic(d->m_unit, i);
+
+            CXSourceLocation location = clang_getDiagnosticLocation(diagnostic);
+            CXFile diagnosticFile;
+            unsigned line, column;
+            clang_getFileLocation(location, &diagnosticFile, &line, &column, nullptr);
+
+            const ClangString spelling(clang_getDiagnosticSpelling(diagnostic));
+            QByteArray key(reinterpret_cast<const char*>(&diagnosticFile), sizeof(diagnosticFile));
+            key += QByteArray::number(line) + ':' + QByteArray::number(column) + ' ' + spelling.c_str();
+            if (!reported.contains(key)) {
+                reported.insert(key);
+                // missing-include problems are so severe in clang that we always propagate
+                // them to this document, to ensure that the user will see the error.
+                if (ClangDiagnosticEvaluator::diagnosticType(diagnostic) == ClangDiagnosticEvaluator::IncludeFileNotFoundProblem) {
+                    d->m_propagatedDiagnostics.append(i);
+                } else {
+                    d->m_diagnosticsByFile[diagnosticFile].append(i);
+                }
+            }
+
+            clang_disposeDiagnostic(diagnostic);
         }
+    }
+
+    // both lists are sorted, merge them to keep the order of clang
+    const auto& fileDiagnostics = d->m_diagnosticsByFile.value(file);
+    QVector<uint> indices(fileDiagnostics.size() + d->m_propagatedDiagnostics.size());
+    std::merge(fileDiagnostics.begin(), fileDiagnostics.end(),
+               d->m_propagatedDiagnostics.constBegin(), d->m_propagatedDiagnostics.constEnd(), indices.begin());
+    problems.reserve(indices.size());
 
+    // the problems are only created for the files that are actually updated
+    for (const uint i : qAsConst(indices)) {
         auto& problem = d->m_diagnosticsCache[i];
         if (!problem) {
+            auto diagnostic = clang_getDiagnostic(d->m_unit, i);
             problem = ClangDiagnosticEvaluator::createProblem(diagnostic, d->m_unit);
+            clang_disposeDiagnostic(diagnostic);
         }
-
         problems << problem;
-
-        clang_disposeDiagnostic(diagnostic);
     }
 
     // other problem sources
@@ -529,6 +610,82 @@ bool ParseSession::reparse(const QVector<UnsavedFile>& unsavedFiles, const Clang
     return true;
 }
 
+QVector<CXCursor> ParseSession::topLevelCursors(CXFile file) const
+{
+    if (!d || !d->m_unit) {
+        return {};
+    }
+
+    if (!d->m_topLevelCursorsCollected) {
+        // group null-file cursors at index 0, they are visited for every file
+        d->m_topLevelCursors.resize(1);
+        d->m_topLevelCursorsCollected = true;
+        clang_visitChildren(clang_getTranslationUnitCursor(d->m_unit), [] (CXCursor cursor, CXCursor /*parent*/, CXClientData data) {
+            auto sessionData = static_cast<ParseSessionData*>(data);
+            CXFile file;
+            clang_getFileLocation(clang_getCursorLocation(cursor), &file, nullptr, nullptr, nullptr);
+
+            auto group = sessionData->m_topLevelCursorGroups.constFind(file);
+            if (group == sessionData->m_topLevelCursorGroups.constEnd()) {
+                // different CXFile handles may refer to the same file
+                int index = sessionData->m_topLevelCursors.size();
+                if (file) {
+                    for (auto it = sessionData->m_topLevelCursorGroups.constBegin(); it != sessionData->m_topLevelCursorGroups.constEnd(); ++it) {
+                        if (it.key() && ClangUtils::isFileEqual(it.key(), file)) {
+                            index = it.value();
+                            break;
+                        }
+                    }
+                } else {
+                    index = 0;
+                }
+                if (index == sessionData->m_topLevelCursors.size()) {
+                    sessionData->m_topLevelCursors.append({});
+                }
+                group = sessionData->m_topLevelCursorGroups.insert(file, index);
+            }
+
+            sessionData->m_topLevelCursors[group.value()].append(cursor);
+            if (file) {
+                // counted as skipped until they are requested for a file
+                ++sessionData->m_buildStatistics.skippedCursors;
+            }
+            return CXChildVisit_Continue;
+        }, d.data());
+    }
+
+    QVector<CXCursor> cursors;
+    for (auto it = d->m_topLevelCursorGroups.constBegin(); it != d->m_topLevelCursorGroups.constEnd(); ++it) {
+        if (it.key() && ClangUtils::isFileEqual(it.key(), file)) {
+            cursors = d->m_topLevelCursors.at(it.value());
+            d->m_buildStatistics.skippedCursors -= cursors.size();
+            break;
+        }
+    }
+    cursors += d->m_topLevelCursors.at(0);
+    return cursors;
+}
+
+DUChainBuildStatistics ParseSession::buildStatistics() const
+{
+    if (!d) {
+        return {};
+    }
+    return d->m_buildStatistics;
+}
+
+void ParseSession::addBuildStatistics(const DUChainBuildStatistics& statistics) const
+{
+    if (!d) {
+        return;
+    }
+    d->m_buildStatistics.builtFiles += statistics.builtFiles;
+    d->m_buildStatistics.skippedFiles += statistics.skippedFiles;
+    d->m_buildStatistics.visitedCursors += statistics.visitedCursors;
+    d->m_buildStatistics.skippedCursors += statistics.skippedCursors;
+    d->m_buildStatistics.updatedFunctionBodies += statistics.updatedFunctionBodies;
+}
+
 ClangParsingEnvironment ParseSession::environment() const
 {
     return d->m_environment;
@@ -23,6 +23,7 @@
 #ifndef PARSESESSION_H
 #define PARSESESSION_H
 
+#include <QHash>
 #include <QList>
 #include <QTemporaryFile>
 
@@ -42,15 +43,34 @@
 
 class ClangIndex;
 
+/**
+ * Counters of the DUChain builder for one parse of a translation unit.
+ */
+struct DUChainBuildStatistics
+{
+    /// Files whose DUChain was built or updated
+    int builtFiles = 0;
+    /// Files whose DUChain was up to date, their cursors were not visited
+    int skippedFiles = 0;
+    /// Cursors visited by the builder, including nested ones
+    int visitedCursors = 0;
+    /// Top-level cursors that were pruned together with all their children
+    int skippedCursors = 0;
+    /// Built files of which only the edited function body was updated
+    int updatedFunctionBodies = 0;
+};
+
 class KDEVCLANGPRIVATE_EXPORT ParseSessionData : public KDevelop::IAstContainer
 {
 public:
     using Ptr = QExplicitlySharedDataPointer<ParseSessionData>;
 
     enum Option {
-        NoOption,                     ///< No special options
-        SkipFunctionBodies,           ///< Pass CXTranslationUnit_SkipFunctionBodies (likely unwanted)
-        PrecompiledHeader             ///< Pass CXTranslationUnit_PrecompiledPreamble and others to cache precompiled headers
+        NoOption = 0,                 ///< No special options
+        SkipFunctionBodies = 1,       ///< Pass CXTranslationUnit_SkipFunctionBodies (likely unwanted)
+        PrecompiledHeader = 2,        ///< Pass CXTranslationUnit_PrecompiledPreamble and others to cache precompiled headers
+        LoadPrecompiledHeader = 4,    ///< Together with PrecompiledHeader: load the precompiled header written before instead of parsing
+        ParseInWorker = 8             ///< Parse in a helper process if enabled, see ClangParseWorkers; the unit cannot be reparsed
     };
     Q_DECLARE_FLAGS(Options, Option)
 
@@ -69,7 +89,8 @@ public:
 private:
     friend class ParseSession;
     void setUnit(CXTranslationUnit unit);
-    QByteArray writeDefinesFile(const QMap<QString, QString>& defines);
+    /// Writes @p defines to @p fileName if it doesn't exist yet, or to a temporary file if @p fileName is empty
+    QByteArray writeDefinesFile(const QMap<QString, QString>& defines, const QString& fileName = QString());
 
     QMutex m_mutex;
 
@@ -81,6 +102,15 @@ private:
     QTemporaryFile m_definesFile;
     // cached ProblemPointer representation for diagnostics
     QVector<KDevelop::ProblemPointer> m_diagnosticsCache;
+    // indices of the diagnostics of each file, and of those shown for every file, see ParseSession::problemsForFile()
+    QHash<CXFile, QVector<uint>> m_diagnosticsByFile;
+    QVector<uint> m_propagatedDiagnostics;
+    bool m_diagnosticsGrouped = false;
+    // top-level cursors grouped by file, collected on first use, see ParseSession::topLevelCursors()
+    QVector<QVector<CXCursor>> m_topLevelCursors;
+    QHash<CXFile, int> m_topLevelCursorGroups;
+    bool m_topLevelCursorsCollected = false;
+    DUChainBuildStatistics m_buildStatistics;
 };
 
 /**
@@ -124,6 +154,20 @@ public:
 
     QList<KDevelop::ProblemPointer> problemsForFile(CXFile file) const;
 
+    /**
+     * @return the top-level cursors of the translation unit that are located in @p file, in their order
+     *
+     * This allows to visit the cursors of a single file without walking over the whole translation unit.
+     * Top-level cursors without a location are always included.
+     */
+    QVector<CXCursor> topLevelCursors(CXFile file) const;
+
+    /**
+     * @return the statistics of the DUChain builder since the last (re)parse
+     */
+    DUChainBuildStatistics buildStatistics() const;
+    void addBuildStatistics(const DUChainBuildStatistics& statistics) const;
+
     CXTranslationUnit unit() const;
 
     bool reparse(const QVector<UnsavedFile>& unsavedFiles, const ClangParsingEnvironment& environment);
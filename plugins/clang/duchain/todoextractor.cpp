@@ -24,134 +24,224 @@
 #include "../util/clangtypes.h"
 
 #include <language/duchain/problem.h>
-#include <language/duchain/stringhelpers.h>
 #include <language/editor/documentrange.h>
 #include <interfaces/icore.h>
 #include <interfaces/ilanguagecontroller.h>
 #include <interfaces/icompletionsettings.h>
 
-#include <QStringList>
+#include <QByteArrayMatcher>
+#include <QCache>
 #include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+#include <qtcompat_p.h>
 
 #include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <limits>
 
 using namespace KDevelop;
 
 namespace {
 
-inline int findEndOfLineOrEnd(const QString& str, int from = 0)
+struct Todo
 {
-    const int index = str.indexOf(QLatin1Char('\n'), from);
-    return (index == -1 ? str.length() : index);
-}
+    QString description;
+    KTextEditor::Range range;
+};
 
-inline int findBeginningOfLineOrStart(const QString& str, int from = 0)
-{
-    const int index = str.lastIndexOf(QLatin1Char('\n'), from);
-    return (index == -1 ? 0 : index+1);
 }
 
-inline int findEndOfCommentOrEnd(const QString& str, int from = 0)
+Q_DECLARE_TYPEINFO(Todo, Q_MOVABLE_TYPE);
+
+namespace {
+
+/// The length of the UTF-8 encoded text in UTF-16 code units, i.e. in columns of the editor
+int utf16Length(const char* begin, const char* end)
 {
-    const int index = str.indexOf(QLatin1String("*/"), from);
-    return (index == -1 ? str.length() : index);
+    int length = 0;
+    for (auto it = begin; it != end; ++it) {
+        const auto byte = static_cast<uchar>(*it);
+        if ((byte & 0xc0) != 0x80) {
+            // four byte sequences are surrogate pairs in UTF-16
+            length += byte >= 0xf0 ? 2 : 1;
+        }
+    }
+    return length;
 }
 
 /**
- * @brief Class for parsing to-do items out of a given comment string
- *
- * Make sure this class is very performant as it will be used for every comment string
- * throughout the code base.
+ * Appends the to-do items found in the comment @p data [@p begin, @p end)
  *
- * So: No unnecessary deep-copies of strings if possible!
+ * @p line is the line of @p begin, @p column its column.
+ * Every line of the comment yields at most one item, starting at the first marker word
+ * and ending at the end of the line or comment.
  */
-class CommentTodoParser
+void findTodosInComment(const char* data, int begin, int end, int line, int column,
+                        const QVector<QByteArrayMatcher>& markers, QVector<Todo>* todos)
 {
-public:
-    struct Result {
-        /// Description of the problem
-        QString description;
-        /// Range within the comment
-        KTextEditor::Range localRange;
-    };
-
-    CommentTodoParser(const QString& str, const QStringList& markerWords)
-        : m_str(str)
-        , m_todoMarkerWords(markerWords)
-    {
-        skipUntilMarkerWord();
-    }
+    int lineBegin = begin;
+    int position = begin;
+    while (position < end) {
+        int found = -1;
+        for (const QByteArrayMatcher& marker : markers) {
+            const int index = marker.indexIn(data, end, position);
+            if (index != -1 && (found == -1 || index < found)) {
+                found = index;
+            }
+        }
+        if (found == -1) {
+            return;
+        }
 
-    QVector<Result> results() const
-    {
-        return m_results;
-    }
+        for (int i = position; i < found; ++i) {
+            if (data[i] == '\n') {
+                ++line;
+                lineBegin = i + 1;
+                column = 0;
+            }
+        }
 
-private:
-    void skipUntilMarkerWord()
-    {
-        // in the most-cases, we won't find a to-do item
-        // make sure this case is sufficiently fast
-
-        // for each to-do marker, scan the comment text
-        foreach (const QString& todoMarker, m_todoMarkerWords) {
-            int offset = m_str.indexOf(todoMarker, m_offset);
-            if (offset != -1) {
-                m_offset = offset;
-                parseTodoMarker();
+        const auto newline = static_cast<const char*>(memchr(data + found, '\n', end - found));
+        const int lineEnd = newline ? newline - data : end;
+        int textEnd = lineEnd;
+        for (int i = found; i + 1 < lineEnd; ++i) {
+            if (data[i] == '*' && data[i + 1] == '/') {
+                textEnd = i;
+                break;
             }
         }
-    }
 
-    void skipUntilNewline()
-    {
-        m_offset = findEndOfLineOrEnd(m_str, m_offset);
+        const QString description = QString::fromUtf8(data + found, textEnd - found).trimmed();
+        const int start = column + utf16Length(data + lineBegin, data + found);
+        todos->append({description, {line, start, line, start + description.length()}});
+
+        position = lineEnd;
     }
+}
 
-    void parseTodoMarker()
-    {
-        // okay, we've found something
-        // m_offset points to the start of the to-do item
-        const int lineStart = findBeginningOfLineOrStart(m_str, m_offset);
-        const int lineEnd = findEndOfLineOrEnd(m_str, m_offset);
-        Q_ASSERT(lineStart <= m_offset);
-        Q_ASSERT(lineEnd > m_offset);
-
-        QString text = m_str.mid(m_offset, lineEnd - m_offset);
-        Q_ASSERT(!text.contains(QLatin1Char('\n')));
-
-        // there's nothing to be stripped on the left side, hence ignore that
-        text.chop(text.length() - findEndOfCommentOrEnd(text));
-        text = text.trimmed(); // remove additional whitespace from the end
-
-        // check at what line within the comment we are by just counting the newlines until now
-        const int line = std::count(m_str.constBegin(), m_str.constBegin() + m_offset, QLatin1Char('\n'));
-        KTextEditor::Cursor start = {line, m_offset - lineStart};
-        KTextEditor::Cursor end = {line, start.column() + text.length()};
-        m_results << Result{text, {start, end}};
-
-        skipUntilNewline();
-        skipUntilMarkerWord();
+/**
+ * Scans the contents of a whole file for to-do items in its comments
+ *
+ * Make sure this is very performant as it will be used for every file throughout the code base.
+ * Most files don't contain a marker word at all, those are skipped without looking for comments.
+ * Otherwise string and character literals are skipped, but the file is not preprocessed.
+ */
+QVector<Todo> findTodos(const char* data, int size, const QVector<QByteArrayMatcher>& markers)
+{
+    QVector<Todo> todos;
+    const bool hasMarker = std::any_of(markers.begin(), markers.end(), [data, size] (const QByteArrayMatcher& marker) {
+        return marker.indexIn(data, size) != -1;
+    });
+    if (!hasMarker) {
+        return todos;
     }
 
-    inline bool atEnd() const
-    {
-        return m_offset < m_str.length();
+    int line = 0;
+    int lineBegin = 0;
+    int position = 0;
+    // moves the position behind a comment or literal that ends at @p end
+    auto skipTo = [&] (int end) {
+        for (; position < end; ++position) {
+            if (data[position] == '\n') {
+                ++line;
+                lineBegin = position + 1;
+            }
+        }
+    };
+    // finds the end of a string or character literal that starts at position
+    auto literalEnd = [&] (char quote) {
+        int end = position + 1;
+        while (end < size && data[end] != quote && data[end] != '\n') {
+            end += data[end] == '\\' ? 2 : 1;
+        }
+        return qMin(end + 1, size);
+    };
+
+    while (position < size) {
+        const char c = data[position];
+        const char next = position + 1 < size ? data[position + 1] : '\0';
+        if (c == '\n') {
+            skipTo(position + 1);
+        } else if (c == '/' && next == '/') {
+            // a line comment, it is continued by a backslash at the end of the line
+            int end = position + 2;
+            while (true) {
+                const auto newline = static_cast<const char*>(memchr(data + end, '\n', size - end));
+                end = newline ? newline - data : size;
+                const int last = end > 0 && data[end - 1] == '\r' ? end - 2 : end - 1;
+                if (!newline || data[last] != '\\') {
+                    break;
+                }
+                ++end;
+            }
+            findTodosInComment(data, position, end, line, utf16Length(data + lineBegin, data + position), markers, &todos);
+            skipTo(end);
+        } else if (c == '/' && next == '*') {
+            const char* close = nullptr;
+            for (auto it = data + position + 2; it + 1 < data + size; ++it) {
+                it = static_cast<const char*>(memchr(it, '*', data + size - 1 - it));
+                if (!it) {
+                    break;
+                }
+                if (it[1] == '/') {
+                    close = it;
+                    break;
+                }
+            }
+            const int end = close ? close - data + 2 : size;
+            findTodosInComment(data, position, end, line, utf16Length(data + lineBegin, data + position), markers, &todos);
+            skipTo(end);
+        } else if (c == '"' && position > 0 && data[position - 1] == 'R') {
+            // a raw string literal, R"delimiter( ... )delimiter"
+            const auto open = static_cast<const char*>(memchr(data + position, '(', qMin(size - position, 18)));
+            if (!open) {
+                skipTo(literalEnd('"'));
+                continue;
+            }
+            const QByteArray terminator = ')' + QByteArray(data + position + 1, open - data - position - 1) + '"';
+            const int end = QByteArrayMatcher(terminator).indexIn(data, size, open - data);
+            skipTo(end == -1 ? size : end + terminator.size());
+        } else if (c == '"') {
+            skipTo(literalEnd('"'));
+        } else if (c == '\'' && !(position > 0 && isalnum(static_cast<uchar>(data[position - 1])))) {
+            // the quote is not a digit separator
+            skipTo(literalEnd('\''));
+        } else {
+            ++position;
+        }
     }
 
-private:
-    const QString m_str;
-    const QStringList m_todoMarkerWords;
+    return todos;
+}
+
+#if CINDEX_VERSION_MINOR >= 47
+/// How many files the to-do items are cached for, those of the least recently parsed files are dropped first
+const int maxCachedFiles = 5000;
 
-    int m_offset = 0;
+/// The to-do items of a file, for the contents with the given hash and size
+struct CachedTodos
+{
+    uint hash;
+    size_t size;
+    QVector<Todo> todos;
+};
 
-    QVector<Result> m_results;
+/// The to-do items of the recently parsed files, for the marker words they were searched with
+struct TodoCache
+{
+    QMutex mutex;
+    QStringList markerWords;
+    QCache<IndexedString, CachedTodos> files{maxCachedFiles};
 };
 
-}
+Q_GLOBAL_STATIC(TodoCache, todoCache)
+#endif
 
-Q_DECLARE_TYPEINFO(CommentTodoParser::Result, Q_MOVABLE_TYPE);
+}
 
 TodoExtractor::TodoExtractor(CXTranslationUnit unit, CXFile file)
     : m_unit(unit)
@@ -163,6 +253,49 @@ TodoExtractor::TodoExtractor(CXTranslationUnit unit, CXFile file)
 
 void TodoExtractor::extractTodos()
 {
+    IndexedString path(QDir(ClangString(clang_getFileName(m_file)).toString()).canonicalPath());
+
+    QVector<QByteArrayMatcher> markers;
+    markers.reserve(m_todoMarkerWords.size());
+    for (const QString& markerWord : m_todoMarkerWords) {
+        if (!markerWord.isEmpty()) {
+            markers.append(QByteArrayMatcher(markerWord.toUtf8()));
+        }
+    }
+    if (markers.isEmpty()) {
+        return;
+    }
+
+    QVector<Todo> todos;
+
+#if CINDEX_VERSION_MINOR >= 47
+    // scan the file buffer clang already has in memory, unless it is unchanged since the last time
+    size_t size = 0;
+    const char* data = clang_getFileContents(m_unit, m_file, &size);
+    if (!data) {
+        return;
+    }
+
+    const uint hash = qHashBits(data, size);
+    {
+        QMutexLocker lock(&todoCache->mutex);
+        if (todoCache->markerWords != m_todoMarkerWords) {
+            todoCache->files.clear();
+            todoCache->markerWords = m_todoMarkerWords;
+        }
+        const auto cached = todoCache->files.object(path);
+        if (cached && cached->hash == hash && cached->size == size) {
+            todos = cached->todos;
+        } else {
+            lock.unlock();
+            todos = findTodos(data, int(size), markers);
+            lock.relock();
+            if (todoCache->markerWords == m_todoMarkerWords) {
+                todoCache->files.insert(path, new CachedTodos{hash, size, todos});
+            }
+        }
+    }
+#else
     using uintLimits = std::numeric_limits<uint>;
 
     auto start = clang_getLocation(m_unit, m_file, 1, 1);
@@ -170,8 +303,6 @@ void TodoExtractor::extractTodos()
 
     auto range = clang_getRange(start, end);
 
-    IndexedString path(QDir(ClangString(clang_getFileName(m_file)).toString()).canonicalPath());
-
     if(clang_Range_isNull(range)){
         return;
     }
@@ -183,30 +314,20 @@ void TodoExtractor::extractTodos()
             continue;
         }
 
-        CXString tokenSpelling = clang_getTokenSpelling(m_unit, token);
-        auto tokenRange = ClangRange(clang_getTokenExtent(m_unit, token)).toRange();
-        const QString text = ClangString(tokenSpelling).toString();
-
-        CommentTodoParser parser(text, m_todoMarkerWords);
-        const auto parserResults = parser.results();
-        m_problems.reserve(m_problems.size() + parserResults.size());
-        for (const CommentTodoParser::Result& result : parserResults) {
-            ProblemPointer problem(new Problem);
-            problem->setDescription(result.description);
-            problem->setSeverity(IProblem::Hint);
-            problem->setSource(IProblem::ToDo);
-
-            // move the local range to the correct location
-            // note: localRange is the range *within* the comment only
-            auto localRange = result.localRange;
-            KTextEditor::Range todoRange{
-                tokenRange.start().line() + localRange.start().line(),
-                localRange.start().column(),
-                tokenRange.start().line() + localRange.end().line(),
-                localRange.end().column()};
-            problem->setFinalLocation({path, todoRange});
-            m_problems << problem;
-        }
+        const QByteArray text = ClangString(clang_getTokenSpelling(m_unit, token)).toByteArray();
+        const auto tokenStart = ClangRange(clang_getTokenExtent(m_unit, token)).toRange().start();
+        findTodosInComment(text.constData(), 0, text.size(), tokenStart.line(), tokenStart.column(), markers, &todos);
+    }
+#endif
+
+    m_problems.reserve(todos.size());
+    for (const Todo& todo : qAsConst(todos)) {
+        ProblemPointer problem(new Problem);
+        problem->setDescription(todo.description);
+        problem->setSeverity(IProblem::Hint);
+        problem->setSource(IProblem::ToDo);
+        problem->setFinalLocation({path, todo.range});
+        m_problems << problem;
     }
 }
 
@@ -45,6 +45,16 @@ CXUnsavedFile UnsavedFile::toClangApi() const
     return file;
 }
 
+QString UnsavedFile::fileName() const
+{
+    return m_fileName;
+}
+
+QStringList UnsavedFile::contents() const
+{
+    return m_contents;
+}
+
 void UnsavedFile::convertToUtf8()
 {
     m_fileNameUtf8 = m_fileName.toUtf8();
@@ -38,6 +38,9 @@ public:
 
     CXUnsavedFile toClangApi() const;
 
+    QString fileName() const;
+    QStringList contents() const;
+
 private:
     QString m_fileName;
     QStringList m_contents;
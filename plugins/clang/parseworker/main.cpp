@@ -0,0 +1,96 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Parses a single translation unit with libclang and saves it as AST file, which is then loaded by
+ * the clang plugin. This keeps crashes and the memory of libclang out of the KDevelop process.
+ */
+
+#include "protocol.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+#include <clang-c/Index.h>
+
+int main()
+{
+    QFile input;
+    if (!input.open(stdin, QIODevice::ReadOnly)) {
+        return ParseWorker::InvalidRequest;
+    }
+    const QByteArray request = input.readAll();
+
+    QDataStream stream(request);
+    quint32 version = 0;
+    QByteArray fileName;
+    QList<QByteArray> arguments;
+    QList<QPair<QByteArray, QByteArray>> unsavedFiles;
+    quint32 flags = 0;
+    QByteArray outputFile;
+    stream >> version;
+    if (version != ParseWorker::ProtocolVersion) {
+        return ParseWorker::InvalidRequest;
+    }
+    stream >> fileName >> arguments >> unsavedFiles >> flags >> outputFile;
+    if (stream.status() != QDataStream::Ok) {
+        return ParseWorker::InvalidRequest;
+    }
+
+    QVector<const char*> clangArguments;
+    clangArguments.reserve(arguments.size());
+    for (const QByteArray& argument : arguments) {
+        clangArguments << argument.constData();
+    }
+
+    QVector<CXUnsavedFile> clangUnsavedFiles;
+    clangUnsavedFiles.reserve(unsavedFiles.size());
+    for (const auto& unsavedFile : unsavedFiles) {
+        CXUnsavedFile file;
+        file.Filename = unsavedFile.first.constData();
+        file.Contents = unsavedFile.second.constData();
+        file.Length = unsavedFile.second.size();
+        clangUnsavedFiles << file;
+    }
+
+    // the translation unit is parsed once and never reparsed here, so don't bother with a preamble
+    flags &= ~(CXTranslationUnit_PrecompiledPreamble | CXTranslationUnit_CacheCompletionResults);
+#if CINDEX_VERSION_MINOR >= 32
+    flags &= ~CXTranslationUnit_CreatePreambleOnFirstParse;
+#endif
+    flags |= CXTranslationUnit_ForSerialization;
+
+    CXIndex index = clang_createIndex(0, 0);
+    CXTranslationUnit unit = nullptr;
+    const CXErrorCode code = clang_parseTranslationUnit2(index, fileName.constData(),
+                                                         clangArguments.constData(), clangArguments.size(),
+                                                         clangUnsavedFiles.data(), clangUnsavedFiles.size(),
+                                                         flags, &unit);
+    if (code != CXError_Success) {
+        return code;
+    }
+
+    const int saved = clang_saveTranslationUnit(unit, outputFile.constData(), CXSaveTranslationUnit_None);
+    // no need to clean up, the process ends anyways
+    return saved == CXSaveError_None ? 0 : ParseWorker::SaveFailed;
+}
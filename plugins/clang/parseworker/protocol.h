@@ -0,0 +1,51 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARSEWORKER_PROTOCOL_H
+#define PARSEWORKER_PROTOCOL_H
+
+#include <QtGlobal>
+
+/**
+ * The request to kdev_clang_parse_worker is written to its stdin as QDataStream of:
+ *
+ * - quint32: ParseWorker::ProtocolVersion
+ * - QByteArray: the file name of the translation unit
+ * - QList<QByteArray>: the arguments passed to clang
+ * - QList<QPair<QByteArray, QByteArray>>: file names and contents of unsaved files
+ * - quint32: the CXTranslationUnit_Flags
+ * - QByteArray: the file the parsed translation unit is saved to
+ *
+ * The exit code is the CXErrorCode of clang_parseTranslationUnit2() or one of the ExitCode values.
+ */
+namespace ParseWorker {
+
+enum : quint32 {
+    ProtocolVersion = 1
+};
+
+enum ExitCode {
+    InvalidRequest = 100,
+    SaveFailed = 101
+};
+
+}
+
+#endif // PARSEWORKER_PROTOCOL_H
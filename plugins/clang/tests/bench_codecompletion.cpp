@@ -24,6 +24,8 @@
 #include <QSignalSpy>
 
 #include <KTextEditor/Cursor>
+#include <KTextEditor/Document>
+#include <KTextEditor/View>
 
 #include <tests/testfile.h>
 
@@ -87,6 +89,8 @@ void BenchCodeCompletion::benchCodeCompletion()
 
     auto view = createView(file.url().toUrl(), this);
 
+    // measures the time until the first items are shown, with the best matches of large results shown ahead of the others
+    // the results of a user invocation are never reused
     QSignalSpy spy(m_model, &QAbstractItemModel::modelReset);
     QBENCHMARK {
         m_model->completionInvoked(view.get(), {position, position}, KTextEditor::CodeCompletionModel::UserInvocation);
@@ -95,3 +99,36 @@ void BenchCodeCompletion::benchCodeCompletion()
         } while (!m_model->rowCount());
     }
 }
+
+void BenchCodeCompletion::benchRefilter_data()
+{
+    benchCodeCompletion_data();
+}
+
+void BenchCodeCompletion::benchRefilter()
+{
+    QFETCH(QString, code);
+    QFETCH(KTextEditor::Cursor, position);
+
+    TestFile file(code, "cpp");
+    QVERIFY(file.parseAndWait(TopDUContext::AllDeclarationsContextsUsesAndAST, 1, 5000));
+
+    auto view = createView(file.url().toUrl(), this);
+
+    QSignalSpy spy(m_model, &QAbstractItemModel::modelReset);
+    m_model->completionInvoked(view.get(), {position, position}, KTextEditor::CodeCompletionModel::UserInvocation);
+    do {
+        spy.wait();
+    } while (!m_model->rowCount());
+
+    // every keystroke of an identifier requests the completion for its start again
+    auto end = position;
+    QBENCHMARK {
+        view->document()->insertText(end, QStringLiteral("i"));
+        end.setColumn(end.column() + 1);
+        m_model->completionInvoked(view.get(), {position, end}, KTextEditor::CodeCompletionModel::AutomaticInvocation);
+        do {
+            spy.wait();
+        } while (!m_model->rowCount());
+    }
+}
@@ -37,6 +37,8 @@ public:
 private Q_SLOTS:
     void benchCodeCompletion_data();
     void benchCodeCompletion();
+    void benchRefilter_data();
+    void benchRefilter();
 
 private:
     QScopedPointer<ClangIndex> m_index;
@@ -1120,6 +1120,30 @@ void TestCodeCompletion::testVariableScope()
     QCOMPARE(item->declaration()->range().start, CursorInRevision(1, 14));
 }
 
+void TestCodeCompletion::testBestMatchItems()
+{
+    TestFile file(QStringLiteral("int globalFoo; int main() { int localBar; \n }"), QStringLiteral("cpp"));
+    QVERIFY(file.parseAndWait(TopDUContext::AllDeclarationsContextsUsesAndAST));
+    DUChainReadLocker lock;
+    auto top = file.topContext();
+    QVERIFY(top);
+    const ParseSessionData::Ptr sessionData(dynamic_cast<ParseSessionData*>(top->ast().data()));
+    QVERIFY(sessionData);
+
+    lock.unlock();
+
+    const auto context = createContext(top, sessionData, {1, 0});
+    context->setFilters(NoMacroOrBuiltin);
+    QVERIFY(context->resultCount() > 1);
+    lock.lock();
+
+    bool abort = false;
+    const auto items = context->bestMatchItems(abort, 1);
+    QCOMPARE(items.size(), 1);
+    QVERIFY(items.first()->declaration());
+    QCOMPARE(items.first()->declaration()->identifier().toString(), QStringLiteral("localBar"));
+}
+
 struct HintItem
 {
     QString hint;
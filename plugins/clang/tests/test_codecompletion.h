@@ -52,6 +52,7 @@ private Q_SLOTS:
 
     void testOverloadedFunctions();
     void testVariableScope();
+    void testBestMatchItems();
     void testArgumentHintCompletionDefaultParameters();
 
     void testCompleteFunction_data();
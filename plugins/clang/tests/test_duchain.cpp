@@ -51,10 +51,13 @@
 #include "duchain/clangparsingenvironmentfile.h"
 #include "duchain/clangparsingenvironment.h"
 #include "duchain/parsesession.h"
+#include "duchain/clangindex.h"
+#include "duchain/clangpch.h"
 
 #include <custom-definesandincludes/idefinesandincludesmanager.h>
 
 #include <KConfigGroup>
+#include <KTextEditor/Document>
 
 #include <QTest>
 #include <QSignalSpy>
@@ -1721,6 +1724,89 @@ void TestDUChain::testReparseUnchanged()
     checkProblems(true);
 }
 
+void TestDUChain::testSkipUpToDateHeaders()
+{
+    TestFile header(QStringLiteral("#pragma once\nstruct Foo { int bar; };\nint foo();\n"), QStringLiteral("h"));
+    TestFile impl("#include \"" + header.url().str() + "\"\nint main() { return Foo().bar + foo(); }\n", QStringLiteral("cpp"), &header);
+
+    auto buildStatistics = [&] () {
+        DUChainReadLocker lock;
+        auto top = impl.topContext();
+        auto sessionData = top ? ParseSessionData::Ptr(dynamic_cast<ParseSessionData*>(top->ast().data())) : ParseSessionData::Ptr();
+        lock.unlock();
+        ParseSession session(sessionData);
+        return session.buildStatistics();
+    };
+
+    const auto features = TopDUContext::Features(TopDUContext::AllDeclarationsContextsAndUses | TopDUContext::AST);
+    impl.parseAndWait(features);
+    auto statistics = buildStatistics();
+    QVERIFY(statistics.builtFiles >= 2);
+    QCOMPARE(statistics.skippedFiles, 0);
+    QVERIFY(statistics.visitedCursors > 0);
+
+    // the header is unchanged, so only the translation unit itself needs to be visited again
+    impl.parseAndWait(TopDUContext::Features(features | TopDUContext::ForceUpdate));
+    statistics = buildStatistics();
+    QVERIFY(statistics.builtFiles >= 1);
+    QVERIFY(statistics.skippedFiles >= 1);
+    QVERIFY(statistics.skippedCursors >= 2);
+
+    DUChainReadLocker lock;
+    auto implCtx = impl.topContext();
+    QVERIFY(implCtx);
+    QCOMPARE(implCtx->localDeclarations().size(), 1);
+}
+
+void TestDUChain::testUpdateFunctionBody()
+{
+    TestFile file(QStringLiteral("int foo() { return 42; }\nint main()\n{\n    int a = foo();\n    return a;\n}\n"), QStringLiteral("cpp"));
+
+    auto backgroundParser = ICore::self()->languageController()->backgroundParser();
+    QSignalSpy spy(backgroundParser, &BackgroundParser::parseJobFinished);
+    auto doc = ICore::self()->documentController()->openDocument(file.url().toUrl());
+    QVERIFY(doc);
+    QVERIFY(spy.wait());
+
+    DeclarationPointer foo;
+    {
+        DUChainReadLocker lock;
+        auto top = file.topContext();
+        QVERIFY(top);
+        QCOMPARE(top->localDeclarations().size(), 2);
+        foo = top->localDeclarations().first();
+    }
+
+    // an edit inside the body of main, spanning multiple lines
+    spy.clear();
+    doc->textDocument()->insertText(KTextEditor::Cursor(4, 4), QStringLiteral("int b = foo();\n    "));
+    QVERIFY(spy.wait());
+
+    DUChainReadLocker lock;
+    auto top = file.topContext();
+    QVERIFY(top);
+    auto sessionData = ParseSessionData::Ptr(dynamic_cast<ParseSessionData*>(top->ast().data()));
+    QVERIFY(sessionData);
+    lock.unlock();
+    QCOMPARE(ParseSession(sessionData).buildStatistics().updatedFunctionBodies, 1);
+    lock.lock();
+
+    // the declarations outside of the body are kept
+    QCOMPARE(top->localDeclarations().size(), 2);
+    QCOMPARE(top->localDeclarations().first(), foo.data());
+    auto mainCtx = top->localDeclarations().last()->internalContext();
+    QVERIFY(mainCtx);
+    QCOMPARE(mainCtx->childContexts().size(), 1);
+    auto body = mainCtx->childContexts().first();
+    QCOMPARE(body->range(), RangeInRevision(2, 0, 6, 1));
+    QCOMPARE(body->localDeclarations().size(), 2);
+    QCOMPARE(body->localDeclarations().last()->range(), RangeInRevision(4, 8, 4, 9));
+    QCOMPARE(foo->uses().value(top->url()).size(), 2);
+
+    lock.unlock();
+    doc->close(KDevelop::IDocument::Discard);
+}
+
 void TestDUChain::testTypeAliasTemplate()
 {
     TestFile file(QStringLiteral("template <typename T> using Alias = T; using Foo = Alias<int>;"), QStringLiteral("cpp"));
@@ -2086,3 +2172,45 @@ void TestDUChain::testHasInclude()
         }
     }
 }
+
+void TestDUChain::testSharedPreambleReuse()
+{
+    QTemporaryDir includeDir;
+    {
+        QFile header(includeDir.path() + "/shared.h");
+        QVERIFY(header.open(QIODevice::WriteOnly | QIODevice::Text));
+        header.write("struct Shared { int value = SHARED_VALUE; };\n");
+    }
+
+    ClangParsingEnvironment environment;
+    environment.addIncludes({Path(includeDir.path())});
+    environment.addDefines({{QStringLiteral("SHARED_VALUE"), QStringLiteral("42")}});
+    const QByteArray contents("#include <shared.h>\nint main() { return Shared().value; }\n");
+
+    Path prefixHeader;
+    QDateTime pchTime;
+    {
+        ClangIndex index;
+        prefixHeader = index.preambleCache().prefixHeader(environment, contents);
+        QVERIFY(prefixHeader.isValid());
+        environment.setPchInclude(prefixHeader);
+        const auto pch = index.pch(environment);
+        QVERIFY(pch && pch->context());
+        QVERIFY(index.preambleCache().isUpToDate(prefixHeader));
+        pchTime = QFileInfo(prefixHeader.toLocalFile() + ".pch").lastModified();
+    }
+
+    // the files of the first session are gone, the precompiled header must still be up to date and be loaded
+    {
+        ClangIndex index;
+        QCOMPARE(index.preambleCache().prefixHeader(environment, contents), prefixHeader);
+        QVERIFY(index.preambleCache().isUpToDate(prefixHeader));
+        const auto pch = index.pch(environment);
+        QVERIFY(pch && pch->context());
+        QCOMPARE(QFileInfo(prefixHeader.toLocalFile() + ".pch").lastModified(), pchTime);
+    }
+
+    for (const auto& suffix : {".pch", ".deps", ".defines", ""}) {
+        QFile::remove(prefixHeader.toLocalFile() + suffix);
+    }
+}
@@ -91,6 +91,8 @@ private Q_SLOTS:
     void testLambda();
     void testReparseUnchanged_data();
     void testReparseUnchanged();
+    void testSkipUpToDateHeaders();
+    void testUpdateFunctionBody();
     void testTypeAliasTemplate();
     void testDeclarationsInsideMacroExpansion();
     void testForwardTemplateTypeParameterContext();
@@ -101,6 +103,7 @@ private Q_SLOTS:
     void testGccCompatibility();
     void testQtIntegration();
     void testHasInclude();
+    void testSharedPreambleReuse();
 
 private:
     QScopedPointer<TestEnvironmentProvider> m_provider;
@@ -413,6 +413,18 @@ void TestProblems::testTodoProblems_data()
     QTest::newRow("non-ascii-todo")
         << "/* TODO: 例えば */"
         << ExpectedTodos{{"TODO: 例えば", {0, 3}, {0, 12}}};
+    QTest::newRow("todo-after-code")
+        << "int a; // TODO: x\n"
+        << ExpectedTodos{{"TODO: x", {0, 10}, {0, 17}}};
+    QTest::newRow("todo-in-string-literal")
+        << "const char* s = \"// TODO: no\"; // FIXME: yes\n"
+        << ExpectedTodos{{"FIXME: yes", {0, 34}, {0, 44}}};
+    QTest::newRow("different-markers")
+        << "/* FIXME: a\n   TODO: b */\n"
+        << ExpectedTodos{
+            {"FIXME: a", {0, 3}, {0, 11}},
+            {"TODO: b", {1, 3}, {1, 10}}
+        };
 }
 
 void TestProblems::testProblemsForIncludedFiles()
@@ -0,0 +1,129 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "compilationdatabase.h"
+
+#include <KShell>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+using namespace KDevelop;
+
+bool CompilationDatabase::load(const QString& fileName, QString* errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error) {
+        *errorMessage = error.errorString();
+        return false;
+    }
+    if (!document.isArray()) {
+        *errorMessage = QStringLiteral("the top-level value is not an array of compile commands");
+        return false;
+    }
+
+    foreach (const QJsonValue& value, document.array()) {
+        const QJsonObject object = value.toObject();
+        const QDir directory(object.value(QStringLiteral("directory")).toString());
+        const QString path = QFileInfo(directory, object.value(QStringLiteral("file")).toString()).canonicalFilePath();
+        if (path.isEmpty() || m_entries.contains(path)) {
+            continue;
+        }
+
+        QStringList arguments;
+        if (object.contains(QStringLiteral("arguments"))) {
+            foreach (const QJsonValue& argument, object.value(QStringLiteral("arguments")).toArray()) {
+                arguments << argument.toString();
+            }
+        } else {
+            arguments = KShell::splitArgs(object.value(QStringLiteral("command")).toString());
+        }
+
+        Entry entry;
+        for (int i = 0; i < arguments.size(); ++i) {
+            const QString& argument = arguments.at(i);
+            // the value of an option is either attached to it, or the next argument
+            auto optionValue = [&](const char* option, QString* value) {
+                const QLatin1String name(option);
+                if (!argument.startsWith(name)) {
+                    return false;
+                }
+                if (argument.size() > name.size()) {
+                    *value = argument.mid(name.size());
+                } else if (i + 1 < arguments.size()) {
+                    *value = arguments.at(++i);
+                } else {
+                    return false;
+                }
+                return true;
+            };
+
+            QString value;
+            if (optionValue("-isystem", &value) || optionValue("-iquote", &value) || optionValue("-idirafter", &value)
+                || optionValue("-I", &value)) {
+                entry.includes << Path(directory.absoluteFilePath(value));
+            } else if (optionValue("-iframework", &value) || optionValue("-F", &value)) {
+                entry.frameworkDirectories << Path(directory.absoluteFilePath(value));
+            } else if (optionValue("-D", &value)) {
+                const int assignment = value.indexOf(QLatin1Char('='));
+                if (assignment == -1) {
+                    entry.defines[value] = QStringLiteral("1");
+                } else {
+                    entry.defines[value.left(assignment)] = value.mid(assignment + 1);
+                }
+            } else if (optionValue("-U", &value)) {
+                entry.defines.remove(value);
+            }
+        }
+
+        m_entries.insert(path, entry);
+    }
+    return true;
+}
+
+Path::List CompilationDatabase::includesInBackground(const QString& path) const
+{
+    return m_entries.value(path).includes;
+}
+
+Path::List CompilationDatabase::frameworkDirectoriesInBackground(const QString& path) const
+{
+    return m_entries.value(path).frameworkDirectories;
+}
+
+Defines CompilationDatabase::definesInBackground(const QString& path) const
+{
+    return m_entries.value(path).defines;
+}
+
+IDefinesAndIncludesManager::Type CompilationDatabase::type() const
+{
+    return IDefinesAndIncludesManager::ProjectSpecific;
+}
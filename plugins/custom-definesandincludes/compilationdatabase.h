@@ -0,0 +1,56 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef COMPILATIONDATABASE_H
+#define COMPILATIONDATABASE_H
+
+#include "idefinesandincludesmanager.h"
+
+#include <QHash>
+
+/**
+ * Provides the include paths, framework directories and defines of the entries of a compile_commands.json
+ * to files that are parsed in the background.
+ *
+ * It is registered by DefinesAndIncludesManager when KDEV_COMPILATION_DATABASE is set to the path of the
+ * database, e.g. by duchainify to index the files of a build without a project.
+ *
+ * The database is only read after load(), so it can be queried from the parse threads.
+ */
+class CompilationDatabase : public KDevelop::IDefinesAndIncludesManager::BackgroundProvider
+{
+public:
+    /// @return false if @p fileName could not be read, @p errorMessage is set to the reason then
+    bool load(const QString& fileName, QString* errorMessage);
+
+    KDevelop::Path::List includesInBackground(const QString& path) const override;
+    KDevelop::Path::List frameworkDirectoriesInBackground(const QString& path) const override;
+    KDevelop::Defines definesInBackground(const QString& path) const override;
+    KDevelop::IDefinesAndIncludesManager::Type type() const override;
+
+private:
+    struct Entry {
+        KDevelop::Path::List includes;
+        KDevelop::Path::List frameworkDirectories;
+        KDevelop::Defines defines;
+    };
+    QHash<QString, Entry> m_entries;
+};
+
+#endif // COMPILATIONDATABASE_H
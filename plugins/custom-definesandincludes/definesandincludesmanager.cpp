@@ -20,11 +20,13 @@
  */
 
 #include "definesandincludesmanager.h"
+#include "compilationdatabase.h"
 
 #include "kcm_widget/definesandincludesconfigpage.h"
 #include "compilerprovider/compilerprovider.h"
 #include "compilerprovider/widget/compilerswidget.h"
 #include "noprojectincludesanddefines/noprojectincludepathsmanager.h"
+#include "debug.h"
 
 #include <interfaces/icore.h>
 #include <interfaces/iprojectcontroller.h>
@@ -36,6 +38,7 @@
 
 #include <QThread>
 #include <QCoreApplication>
+#include <QFile>
 
 #include <algorithm>
 
@@ -117,6 +120,19 @@ DefinesAndIncludesManager::DefinesAndIncludesManager( QObject* parent, const QVa
     , m_noProjectIPM(new NoProjectIncludePathsManager())
 {
     registerProvider(m_settings->provider());
+
+    // used by duchainify to index the files of a build without a project
+    if (qEnvironmentVariableIsSet("KDEV_COMPILATION_DATABASE")) {
+        const QString fileName = QFile::decodeName(qgetenv("KDEV_COMPILATION_DATABASE"));
+        m_compilationDatabase.reset(new CompilationDatabase);
+        QString errorMessage;
+        if (m_compilationDatabase->load(fileName, &errorMessage)) {
+            registerBackgroundProvider(m_compilationDatabase.data());
+        } else {
+            qCWarning(DEFINESANDINCLUDES) << "Failed to read the compilation database" << fileName << ":" << errorMessage;
+            m_compilationDatabase.reset();
+        }
+    }
 #ifdef Q_OS_OSX
     m_defaultFrameworkDirectories += Path(QStringLiteral("/Library/Frameworks"));
     m_defaultFrameworkDirectories += Path(QStringLiteral("/System/Library/Frameworks"));
@@ -32,6 +32,7 @@
 
 #include "compilerprovider/settingsmanager.h"
 
+class CompilationDatabase;
 class CompilerProvider;
 class NoProjectIncludePathsManager;
 
@@ -82,6 +83,7 @@ private:
     QVector<BackgroundProvider*> m_backgroundProviders;
     SettingsManager* m_settings;
     QScopedPointer<NoProjectIncludePathsManager> m_noProjectIPM;
+    QScopedPointer<CompilationDatabase> m_compilationDatabase;
     KDevelop::Path::List m_defaultFrameworkDirectories;
 };
 
@@ -2,7 +2,11 @@
 #include "debug.h"
 
 #include <QDir>
+#include <QDirIterator>
+#include <QRegExp>
 #include <QSet>
+#include <QtConcurrentMap>
+#include <qplatformdefs.h>
 
 #include <project/projectmodel.h>
 #include <interfaces/iproject.h>
@@ -11,6 +15,10 @@
 
 #include <serialization/indexedstring.h>
 
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#endif
+
 
 using KDevelop::IndexedString;
 
@@ -32,11 +40,173 @@ static bool isInDirectory(const QUrl& url, const QUrl& dir, int maxDepth)
     return false;
 }
 
+namespace {
+
+/// The include and exclude patterns of a search, compiled once.
+/// QRegExp keeps the state of the last match, so every thread has to match with its own copy().
+class FileFilter
+{
+public:
+    FileFilter(const QStringList& include, const QStringList& exclude)
+    {
+        m_include.reserve(include.size());
+        for (const QString& pattern : include) {
+            m_include << QRegExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+            // compiles the pattern, copies share the compiled pattern
+            m_include.last().isValid();
+        }
+        m_exclude.reserve(exclude.size());
+        for (const QString& pattern : exclude) {
+            m_exclude << QRegExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+            m_exclude.last().isValid();
+            // "*foo*" matches every path in a directory whose path matches it
+            m_excludesSubtrees &= pattern.startsWith(QLatin1Char('*')) && pattern.endsWith(QLatin1Char('*'));
+        }
+    }
+
+    /// Returns a filter with its own match state
+    FileFilter copy() const
+    {
+        FileFilter ret(*this);
+        for (QRegExp& re : ret.m_include) {
+            re = QRegExp(re);
+        }
+        for (QRegExp& re : ret.m_exclude) {
+            re = QRegExp(re);
+        }
+        return ret;
+    }
+
+    /// Equivalent to QDir::match(include, fileName), but an empty include list matches everything
+    bool isIncluded(const QString& fileName) const
+    {
+        if (m_include.isEmpty())
+            return true;
+        for (const QRegExp& re : m_include) {
+            if (re.exactMatch(fileName))
+                return true;
+        }
+        return false;
+    }
+
+    /// Equivalent to QDir::match(exclude, path)
+    bool isExcluded(const QString& path) const
+    {
+        for (const QRegExp& re : m_exclude) {
+            if (re.exactMatch(path))
+                return true;
+        }
+        return false;
+    }
+
+    /// Whether all files in the directory @p path are excluded, so it does not need to be listed
+    bool isExcludedDirectory(const QString& path) const
+    {
+        return m_excludesSubtrees && isExcluded(path + QLatin1Char('/'));
+    }
+
+private:
+    QVector<QRegExp> m_include;
+    QVector<QRegExp> m_exclude;
+    bool m_excludesSubtrees = true;
+};
+
+struct DirectoryListing
+{
+    QList<QUrl> files;
+    QStringList directories;
+};
+
+/// Lists a canonical directory, used from the threads of the global thread pool
+struct DirectoryLister
+{
+    typedef DirectoryListing result_type;
+
+    DirectoryListing operator()(const QString& dir) const;
+
+    FileFilter filter;
+    // whether the subdirectories are listed too
+    bool recursive;
+    volatile bool* abort;
+};
+
+DirectoryListing DirectoryLister::operator()(const QString& dir) const
+{
+    DirectoryListing listing;
+    if (*abort)
+        return listing;
+
+    // the lister is shared by the threads
+    const FileFilter filter = this->filter.copy();
+
+    auto addFile = [&](const QString& path, bool isSymLink) {
+        const QString canonical = isSymLink ? QFileInfo(path).canonicalFilePath() : path;
+        if (!canonical.isEmpty() && !filter.isExcluded(canonical))
+            listing.files << QUrl::fromLocalFile(canonical);
+    };
+    auto addDirectory = [&](const QString& path) {
+        if (recursive && !filter.isExcludedDirectory(path))
+            listing.directories << path;
+    };
+
+#ifdef Q_OS_UNIX
+    // list the raw entries, their type is known without a stat() on most file systems
+    QByteArray encodedDir = QFile::encodeName(dir);
+    DIR* handle = opendir(encodedDir.constData());
+    if (!handle)
+        return listing;
+    if (!encodedDir.endsWith('/'))
+        encodedDir += '/';
+
+    while (const dirent* entry = readdir(handle)) {
+        // skips hidden entries like QDir does by default, as well as "." and ".."
+        if (entry->d_name[0] == '.')
+            continue;
+
+        const QByteArray encodedPath = encodedDir + entry->d_name;
+        bool isDir = entry->d_type == DT_DIR;
+        bool isFile = entry->d_type == DT_REG;
+        bool isSymLink = false;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+            QT_STATBUF info;
+            if (QT_LSTAT(encodedPath.constData(), &info) != 0)
+                continue;
+            isSymLink = S_ISLNK(info.st_mode);
+            if (isSymLink && QT_STAT(encodedPath.constData(), &info) != 0)
+                continue;
+            isDir = S_ISDIR(info.st_mode);
+            isFile = S_ISREG(info.st_mode);
+        }
+
+        if (isFile && filter.isIncluded(QFile::decodeName(entry->d_name))) {
+            addFile(QFile::decodeName(encodedPath), isSymLink);
+        } else if (isDir && !isSymLink) {
+            addDirectory(QFile::decodeName(encodedPath));
+        }
+    }
+    closedir(handle);
+#else
+    QDirIterator it(dir, QDir::NoDotAndDotDot | QDir::Files | QDir::AllDirs | QDir::Readable);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isFile() && filter.isIncluded(info.fileName())) {
+            addFile(info.absoluteFilePath(), info.isSymLink());
+        } else if (info.isDir() && !info.isSymLink()) {
+            addDirectory(info.absoluteFilePath());
+        }
+    }
+#endif
+
+    return listing;
+}
+
+}
+
 // the abort parameter must be volatile so that it
 // is evaluated every time - optimization might prevent that
 
-static QList<QUrl> thread_getProjectFiles(const QUrl& dir, int depth, const QStringList& include,
-                                         const QStringList& exlude, volatile bool &abort)
+static QList<QUrl> thread_getProjectFiles(const QUrl& dir, int depth, const FileFilter& filter, volatile bool &abort)
 {
     ///@todo This is not thread-safe!
     KDevelop::IProject *project = KDevelop::ICore::self()->projectController()->findProjectForUrl( dir );
@@ -66,44 +236,47 @@ static QList<QUrl> thread_getProjectFiles(const QUrl& dir, int depth, const QStr
                     continue;
             }
         }
-        if( QDir::match(include, url.fileName()) && !QDir::match(exlude, url.toLocalFile()) )
+        if( filter.isIncluded(url.fileName()) && !filter.isExcluded(url.toLocalFile()) )
             res << url;
     }
 
     return res;
 }
 
-static QList<QUrl> thread_findFiles(const QDir& dir, int depth, const QStringList& include,
-                                   const QStringList& exclude, volatile bool &abort)
+/**
+ * Lists the files below @p dir level by level, the directories of a level are listed in parallel.
+ */
+static QList<QUrl> thread_findFiles(const QString& dir, int depth, const FileFilter& filter, volatile bool &abort)
 {
-    QFileInfoList infos = dir.entryInfoList(include, QDir::NoDotAndDotDot|QDir::Files|QDir::Readable);
-
-    if(!QFileInfo(dir.path()).isDir())
-        infos << QFileInfo(dir.path());
-
     QList<QUrl> dirFiles;
-    foreach(const QFileInfo &currFile, infos)
+
+    const QFileInfo info(dir);
+    if(!info.isDir())
     {
-        QString currName = currFile.canonicalFilePath();
-        if(!QDir::match(exclude, currName))
+        const QString currName = info.canonicalFilePath();
+        if(!currName.isEmpty() && !filter.isExcluded(currName))
             dirFiles << QUrl::fromLocalFile(currName);
+        return dirFiles;
     }
-    if(depth != 0)
+
+    const QString canonical = info.canonicalFilePath();
+    if (filter.isExcludedDirectory(canonical))
+        return dirFiles;
+
+    QStringList level(canonical);
+    while(!level.isEmpty() && !abort)
     {
-        static const QDir::Filters dirFilter = QDir::NoDotAndDotDot|QDir::AllDirs|QDir::Readable|QDir::NoSymLinks;
-        foreach(const QFileInfo &currDir, dir.entryInfoList(QStringList(), dirFilter))
-        {
-            if(abort)
-                break;
-            QString canonical = currDir.canonicalFilePath();
-            if (!canonical.startsWith(dir.canonicalPath()))
-                continue;
+        const DirectoryLister lister{filter, depth != 0, &abort};
+        const QList<DirectoryListing> listings = QtConcurrent::blockingMapped<QList<DirectoryListing>>(level, lister);
 
-            if ( depth > 0 ) {
-                depth--;
-            }
+        level.clear();
+        for (const DirectoryListing& listing : listings) {
+            dirFiles += listing.files;
+            level += listing.directories;
+        }
 
-            dirFiles << thread_findFiles(canonical, depth, include, exclude, abort);
+        if ( depth > 0 ) {
+            depth--;
         }
     }
     return dirFiles;
@@ -137,18 +310,18 @@ bool GrepFindFilesThread::triesToAbort() const
 
 void GrepFindFilesThread::run()
 {
-    QStringList include = GrepFindFilesThread::parseInclude(m_patString);
-    QStringList exclude = GrepFindFilesThread::parseExclude(m_exclString);
+    const FileFilter filter(GrepFindFilesThread::parseInclude(m_patString),
+                            GrepFindFilesThread::parseExclude(m_exclString));
 
     qCDebug(PLUGIN_GREPVIEW) << "running with start dir" << m_startDirs;
 
     foreach(const QUrl& directory, m_startDirs)
     {
         if(m_project)
-            m_files += thread_getProjectFiles(directory, m_depth, include, exclude, m_tryAbort);
+            m_files += thread_getProjectFiles(directory, m_depth, filter, m_tryAbort);
         else
         {
-            m_files += thread_findFiles(directory.toLocalFile(), m_depth, include, exclude, m_tryAbort);
+            m_files += thread_findFiles(directory.toLocalFile(), m_depth, filter, m_tryAbort);
         }
     }
 }
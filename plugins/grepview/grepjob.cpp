@@ -21,7 +21,10 @@
 #include <QFile>
 #include <QList>
 #include <QRegExp>
-#include <QTextStream>
+#include <QTextCodec>
+#include <QtConcurrentMap>
+
+#include <cstring>
 
 #include <KEncodingProber>
 #include <KLocalizedString>
@@ -33,6 +36,174 @@
 using namespace KDevelop;
 
 
+namespace {
+
+/// Returns a string each match of @p re has to contain, or an empty string when none is known.
+/// Only literal characters outside of groups, alternations and optional parts are considered.
+QString requiredLiteral(const QRegExp& re)
+{
+    const QString pattern = re.pattern();
+    switch (re.patternSyntax()) {
+    case QRegExp::FixedString:
+        return pattern;
+    case QRegExp::Wildcard:
+    case QRegExp::WildcardUnix:
+        for (const QChar c : pattern) {
+            if (c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('[') || c == QLatin1Char('\\')) {
+                return QString();
+            }
+        }
+        return pattern;
+    default:
+        break;
+    }
+
+    if (pattern.contains(QLatin1Char('|'))) {
+        return QString();
+    }
+
+    QString best;
+    QString current;
+    auto endRun = [&]() {
+        if (current.length() > best.length()) {
+            best = current;
+        }
+        current.clear();
+    };
+
+    int depth = 0;
+    for (int i = 0; i < pattern.length(); ++i) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('(')) {
+            ++depth;
+            endRun();
+        } else if (c == QLatin1Char(')')) {
+            --depth;
+            endRun();
+        } else if (c == QLatin1Char('[')) {
+            // skip the character class, a ']' right after the opening bracket is part of it
+            endRun();
+            ++i;
+            if (i < pattern.length() && pattern.at(i) == QLatin1Char('^')) {
+                ++i;
+            }
+            if (i < pattern.length() && pattern.at(i) == QLatin1Char(']')) {
+                ++i;
+            }
+            while (i < pattern.length() && pattern.at(i) != QLatin1Char(']')) {
+                if (pattern.at(i) == QLatin1Char('\\')) {
+                    ++i;
+                }
+                ++i;
+            }
+        } else if (c == QLatin1Char('?') || c == QLatin1Char('*') || c == QLatin1Char('{')) {
+            // the preceding character is optional
+            current.chop(1);
+            endRun();
+            if (c == QLatin1Char('{')) {
+                const int close = pattern.indexOf(QLatin1Char('}'), i);
+                if (close == -1) {
+                    return QString();
+                }
+                i = close;
+            }
+        } else if (c == QLatin1Char('+') || c == QLatin1Char('.') || c == QLatin1Char('^') || c == QLatin1Char('$')) {
+            endRun();
+        } else if (c == QLatin1Char('\\')) {
+            if (i + 1 == pattern.length()) {
+                return QString();
+            }
+            const QChar escaped = pattern.at(++i);
+            if (escaped.isDigit() || escaped == QLatin1Char('x') || escaped == QLatin1Char('u')) {
+                // back references and character codes like \x41, whose digits must not be taken for literal characters
+                return QString();
+            }
+            if (escaped.isLetter()) {
+                // character classes and assertions like \s or \b, the literal runs around them are kept
+                endRun();
+            } else if (depth == 0) {
+                current += escaped;
+            } else {
+                endRun();
+            }
+        } else if (depth == 0) {
+            current += c;
+        }
+    }
+    endRun();
+    return best;
+}
+
+/// Returns the position of @p needle in the buffer from @p from on, or -1
+qint64 findLiteral(const char* data, qint64 size, qint64 from, const QByteArray& needle, Qt::CaseSensitivity cs)
+{
+    const qint64 length = needle.size();
+    if (cs == Qt::CaseSensitive) {
+        const char first = needle.at(0);
+        while (from + length <= size) {
+            const char* candidate = static_cast<const char*>(memchr(data + from, first, size - length + 1 - from));
+            if (!candidate) {
+                return -1;
+            }
+            if (memcmp(candidate, needle.constData(), length) == 0) {
+                return candidate - data;
+            }
+            from = candidate - data + 1;
+        }
+        return -1;
+    }
+
+    // the needle is lower case ASCII
+    const char first = needle.at(0);
+    for (qint64 i = from; i + length <= size; ++i) {
+        if (QChar::toLower(uchar(data[i])) == uint(first) && qstrnicmp(data + i, needle.constData(), length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void grepLine(QString data, int lineno, const QString& filename, const QRegExp& re, GrepOutputItem::List& res)
+{
+    // remove line terminators (in order to not match them)
+    for (int pos = data.length()-1; pos >= 0 && (data[pos] == QLatin1Char('\r') || data[pos] == QLatin1Char('\n')); pos--) {
+        data.chop(1);
+    }
+
+    int offset = 0;
+    // allow empty string matching result in an infinite loop !
+    while( re.indexIn(data, offset)!=-1 && re.cap(0).length() > 0 )
+    {
+        int start = re.pos(0);
+        int end = start + re.cap(0).length();
+
+        DocumentChangePointer change = DocumentChangePointer(new DocumentChange(
+            IndexedString(filename),
+            KTextEditor::Range(lineno, start, lineno, end),
+            re.cap(0), QString()));
+
+        res << GrepOutputItem(change, data, false);
+        offset = end;
+    }
+}
+
+/// Greps the files of a job, used from the threads of the global thread pool
+struct FileGrepper
+{
+    typedef GrepOutputItem::List result_type;
+
+    GrepOutputItem::List operator()(const QUrl& url) const
+    {
+        // a QRegExp must not be used from multiple threads at once
+        const QRegExp re = regExp;
+        return grepFile(url.toLocalFile(), re);
+    }
+
+    QRegExp regExp;
+};
+
+}
+
 GrepOutputItem::List grepFile(const QString &filename, const QRegExp &re)
 {
     GrepOutputItem::List res;
@@ -40,47 +211,88 @@ GrepOutputItem::List grepFile(const QString &filename, const QRegExp &re)
 
     if(!file.open(QIODevice::ReadOnly))
         return res;
-    int lineno = 0;
 
+    // search in a mapping of the file, fall back to reading it for special files
+    QByteArray contents;
+    qint64 size = file.size();
+    const char* data = size > 0 ? reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+    if (!data) {
+        contents = file.readAll();
+        data = contents.constData();
+        size = contents.size();
+    }
 
     // detect encoding (unicode files can be feed forever, stops when confidence reachs 99%
     KEncodingProber prober;
-    while(!file.atEnd() && prober.state() == KEncodingProber::Probing && prober.confidence() < 0.99) {
-        prober.feed(file.read(0xFF));
+    for (qint64 pos = 0; pos < size && prober.state() == KEncodingProber::Probing && prober.confidence() < 0.99; pos += 0xFF) {
+        prober.feed(data + pos, qMin<qint64>(0xFF, size - pos));
     }
 
-    // reads file with detected encoding
-    file.seek(0);
-    QTextStream stream(&file);
-    if(prober.confidence()>0.7)
-        stream.setCodec(prober.encoding().constData());
-    while( !stream.atEnd() )
-    {
-        QString data = stream.readLine();
-
-        // remove line terminators (in order to not match them)
-        for (int pos = data.length()-1; pos >= 0 && (data[pos] == QLatin1Char('\r') || data[pos] == QLatin1Char('\n')); pos--) {
-            data.chop(1);
+    QTextCodec* codec = nullptr;
+    if (prober.confidence() > 0.7)
+        codec = QTextCodec::codecForName(prober.encoding());
+    if (!codec)
+        codec = QTextCodec::codecForLocale();
+    // like QTextStream, honor a byte order mark
+    codec = QTextCodec::codecForUtfText(QByteArray::fromRawData(data, qMin<qint64>(size, 4)), codec);
+
+    if (codec->fromUnicode(QStringLiteral("\n")) != "\n") {
+        // lines cannot be found in the raw data, e.g. for UTF-16
+        const QString text = codec->toUnicode(data, size);
+        int lineno = 0;
+        for (int start = 0; start < text.length(); ++lineno) {
+            int end = text.indexOf(QLatin1Char('\n'), start);
+            if (end == -1)
+                end = text.length();
+            grepLine(text.mid(start, end - start), lineno, filename, re, res);
+            start = end + 1;
         }
+        return res;
+    }
 
-        int offset = 0;
-        // allow empty string matching result in an infinite loop !
-        while( re.indexIn(data, offset)!=-1 && re.cap(0).length() > 0 )
-        {
-            int start = re.pos(0);
-            int end = start + re.cap(0).length();
-
-            DocumentChangePointer change = DocumentChangePointer(new DocumentChange(
-                IndexedString(filename),
-                KTextEditor::Range(lineno, start, lineno, end),
-                re.cap(0), QString()));
+    // only decode lines containing the literal part of the pattern, if there is one
+    QByteArray needle;
+    const QString literal = requiredLiteral(re);
+    if (!literal.isEmpty()) {
+        bool ascii = true;
+        for (const QChar c : literal) {
+            ascii &= c.unicode() < 0x80;
+        }
+        if (ascii && codec->fromUnicode(literal) == literal.toLatin1()) {
+            needle = literal.toLatin1();
+        }
+        if (re.caseSensitivity() == Qt::CaseInsensitive) {
+            // non-ASCII characters like the Kelvin sign or the dotted capital I are equal to 'k' and 'i' when
+            // ignoring case, search for the longest part without those letters
+            const QList<QByteArray> parts = needle.toLower().replace('k', 'i').split('i');
+            needle.clear();
+            for (const QByteArray& part : parts) {
+                if (part.size() > needle.size())
+                    needle = part;
+            }
+        }
+    }
 
-            res << GrepOutputItem(change, data, false);
-            offset = end;
+    int lineno = 0;
+    qint64 start = 0;
+    while (start < size) {
+        if (!needle.isEmpty()) {
+            const qint64 match = findLiteral(data, size, start, needle, re.caseSensitivity());
+            if (match == -1)
+                break;
+            // skip to the line of the match
+            for (const char* newline; (newline = static_cast<const char*>(memchr(data + start, '\n', match - start)));) {
+                start = newline - data + 1;
+                ++lineno;
+            }
         }
-        lineno++;
+
+        const char* newline = static_cast<const char*>(memchr(data + start, '\n', size - start));
+        const qint64 end = newline ? newline - data : size;
+        grepLine(codec->toUnicode(data + start, end - start), lineno, filename, re, res);
+        start = end + 1;
+        ++lineno;
     }
-    file.close();
     return res;
 }
 
@@ -96,6 +308,10 @@ GrepJob::GrepJob( QObject* parent )
     KDevelop::ICore::self()->uiController()->registerStatus(this);
 
     connect(this, &GrepJob::result, this, &GrepJob::testFinishState);
+    connect(&m_grepWatcher, &QFutureWatcher<GrepOutputItem::List>::resultsReadyAt,
+            this, &GrepJob::slotGrepResultsReady);
+    connect(&m_grepWatcher, &QFutureWatcher<GrepOutputItem::List>::finished,
+            this, &GrepJob::slotGrepFinished);
 }
 
 QString GrepJob::statusName() const
@@ -188,31 +404,9 @@ void GrepJob::slotWork()
             m_findThread->start();
             break;
         case WorkGrep:
-            if(m_fileIndex < m_fileList.length())
-            {
-                emit showProgress(this, 0, m_fileList.length(), m_fileIndex);
-                if(m_fileIndex < m_fileList.length()) {
-                    QString file = m_fileList[m_fileIndex].toLocalFile();
-                    GrepOutputItem::List items = grepFile(file, m_regExp);
-
-                    if(!items.isEmpty())
-                    {
-                        m_findSomething = true;
-                        emit foundMatches(file, items);
-                    }
-
-                    m_fileIndex++;
-                }
-                QMetaObject::invokeMethod(this, "slotWork", Qt::QueuedConnection);
-            }
-            else
-            {
-                emit hideProgress(this);
-                emit clearMessage(this);
-                m_workState = WorkIdle;
-                //model()->slotCompleted();
-                emitResult();
-            }
+            // the files are searched in parallel, their results are reported in order
+            emit showProgress(this, 0, m_fileList.length(), m_fileIndex);
+            m_grepWatcher.setFuture(QtConcurrent::mapped(m_fileList, FileGrepper{m_regExp}));
             break;
         case WorkCancelled:
             emit hideProgress(this);
@@ -223,6 +417,34 @@ void GrepJob::slotWork()
     }
 }
 
+void GrepJob::slotGrepResultsReady()
+{
+    const QFuture<GrepOutputItem::List> future = m_grepWatcher.future();
+    while (m_fileIndex < m_fileList.length() && future.isResultReadyAt(m_fileIndex)) {
+        const GrepOutputItem::List items = future.resultAt(m_fileIndex);
+        if(!items.isEmpty())
+        {
+            m_findSomething = true;
+            emit foundMatches(m_fileList[m_fileIndex].toLocalFile(), items);
+        }
+        m_fileIndex++;
+    }
+    emit showProgress(this, 0, m_fileList.length(), m_fileIndex);
+}
+
+void GrepJob::slotGrepFinished()
+{
+    if (m_workState != WorkGrep)
+        return;
+
+    slotGrepResultsReady();
+    emit hideProgress(this);
+    emit clearMessage(this);
+    m_workState = WorkIdle;
+    //model()->slotCompleted();
+    emitResult();
+}
+
 void GrepJob::start()
 {
     if(m_workState!=WorkIdle)
@@ -249,6 +471,16 @@ bool GrepJob::doKill()
         m_findThread->tryAbort();
         return false;
     }
+    else if(m_workState == WorkGrep)
+    {
+        // wait for the files that are searched right now, the others are skipped
+        m_workState = WorkCancelled;
+        m_grepWatcher.cancel();
+        m_grepWatcher.waitForFinished();
+        emit hideProgress(this);
+        emit clearMessage(this);
+        emit showErrorMessage(i18n("Search aborted"), 5000);
+    }
     else
     {
         m_workState = WorkCancelled;
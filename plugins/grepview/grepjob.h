@@ -16,6 +16,7 @@
 #ifndef KDEVPLATFORM_PLUGIN_GREPJOB_H
 #define KDEVPLATFORM_PLUGIN_GREPJOB_H
 
+#include <QFutureWatcher>
 #include <QPointer>
 #include <QUrl>
 
@@ -85,6 +86,8 @@ protected:
 
 private Q_SLOTS:
     void slotFindFinished();
+    void slotGrepResultsReady();
+    void slotGrepFinished();
     void testFinishState(KJob *job);
 
 Q_SIGNALS:
@@ -115,6 +118,7 @@ private:
     QList<QUrl> m_fileList;
     int m_fileIndex;
     QPointer<GrepFindFilesThread> m_findThread;
+    QFutureWatcher<GrepOutputItem::List> m_grepWatcher;
 
     GrepJobSettings m_settings;
 
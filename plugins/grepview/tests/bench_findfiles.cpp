@@ -0,0 +1,112 @@
+/***************************************************************************
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+***************************************************************************/
+
+#include "bench_findfiles.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "../grepfindthread.h"
+
+QTEST_GUILESS_MAIN(BenchFindFiles)
+
+namespace {
+
+/// The file enumeration as done before GrepFindFilesThread listed directories in parallel
+QList<QUrl> entryInfoListFiles(const QDir& dir, const QStringList& include, const QStringList& exclude)
+{
+    QList<QUrl> files;
+    foreach(const QFileInfo& file, dir.entryInfoList(include, QDir::NoDotAndDotDot|QDir::Files|QDir::Readable))
+    {
+        const QString name = file.canonicalFilePath();
+        if(!QDir::match(exclude, name))
+            files << QUrl::fromLocalFile(name);
+    }
+    foreach(const QFileInfo& subDir, dir.entryInfoList(QStringList(), QDir::NoDotAndDotDot|QDir::AllDirs|QDir::Readable|QDir::NoSymLinks))
+    {
+        files << entryInfoListFiles(subDir.canonicalFilePath(), include, exclude);
+    }
+    return files;
+}
+
+}
+
+QString BenchFindFiles::tree(int files)
+{
+    auto& dir = m_trees[files];
+    if (!dir) {
+        dir.reset(new QTemporaryDir);
+        // 100 files per directory, 100 directories per parent, and a build directory that is excluded
+        const QDir root(dir->path());
+        for (int i = 0; i < files; ++i) {
+            const QString subDir = QStringLiteral("dir%1/sub%2").arg(i / 10000).arg(i / 100 % 100);
+            if (i % 100 == 0) {
+                root.mkpath(QLatin1String("src/") + subDir);
+                root.mkpath(QLatin1String("build/") + subDir);
+            }
+            const QString path = QStringLiteral("%1/%2/file%3.%4")
+                .arg(i % 10 ? QStringLiteral("src") : QStringLiteral("build"), subDir)
+                .arg(i).arg(i % 3 ? QStringLiteral("cpp") : QStringLiteral("h"));
+            QFile file(root.filePath(path));
+            file.open(QIODevice::WriteOnly);
+        }
+    }
+    return dir->path();
+}
+
+void BenchFindFiles::getData()
+{
+    QTest::addColumn<int>("files");
+
+    QTest::newRow("5000") << 5000;
+    QTest::newRow("50000") << 50000;
+    QTest::newRow("500000") << 500000;
+}
+
+void BenchFindFiles::benchGrepFindFilesThread()
+{
+    QFETCH(int, files);
+    if (files > 5000 && !qEnvironmentVariableIsSet("KDEV_BENCH_LARGE_TREES")) {
+        QSKIP("set KDEV_BENCH_LARGE_TREES to run with large trees");
+    }
+    const QUrl root = QUrl::fromLocalFile(tree(files));
+
+    QBENCHMARK {
+        GrepFindFilesThread thread(nullptr, {root}, -1, QStringLiteral("*.cpp"), QStringLiteral("/build/"), false);
+        thread.start();
+        thread.wait();
+        QCOMPARE(thread.files().size(), files * 9 / 10 * 2 / 3);
+    }
+}
+
+void BenchFindFiles::benchGrepFindFilesThread_data()
+{
+    getData();
+}
+
+void BenchFindFiles::benchEntryInfoList()
+{
+    QFETCH(int, files);
+    if (files > 5000 && !qEnvironmentVariableIsSet("KDEV_BENCH_LARGE_TREES")) {
+        QSKIP("set KDEV_BENCH_LARGE_TREES to run with large trees");
+    }
+    const QString root = tree(files);
+    const QStringList include = GrepFindFilesThread::parseInclude(QStringLiteral("*.cpp"));
+    const QStringList exclude = GrepFindFilesThread::parseExclude(QStringLiteral("/build/"));
+
+    QBENCHMARK {
+        QCOMPARE(entryInfoListFiles(root, include, exclude).size(), files * 9 / 10 * 2 / 3);
+    }
+}
+
+void BenchFindFiles::benchEntryInfoList_data()
+{
+    getData();
+}
@@ -0,0 +1,36 @@
+/***************************************************************************
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+***************************************************************************/
+
+#ifndef KDEVPLATFORM_PLUGIN_BENCH_FINDFILES_H
+#define KDEVPLATFORM_PLUGIN_BENCH_FINDFILES_H
+
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+
+class QTemporaryDir;
+
+class BenchFindFiles : public QObject
+{
+    Q_OBJECT
+
+private:
+    void getData();
+    /// Returns a tree with @p files files, created on first use
+    QString tree(int files);
+
+    QHash<int, QSharedPointer<QTemporaryDir>> m_trees;
+
+private Q_SLOTS:
+    void benchGrepFindFilesThread();
+    void benchGrepFindFilesThread_data();
+    void benchEntryInfoList();
+    void benchEntryInfoList_data();
+};
+
+#endif // KDEVPLATFORM_PLUGIN_BENCH_FINDFILES_H
@@ -65,6 +65,20 @@ void FindReplaceTest::testFind_data()
                            << (MatchList() << Match(0, 0, 6));
     QTest::newRow("Matching empty string anywhere") << "foobar\n" << QRegExp("")
                            << (MatchList());
+    QTest::newRow("Optional character") << "color\ncolour\ncolr" << QRegExp("colou?r")
+                           << (MatchList() << Match(0, 0, 5) << Match(1, 0, 6));
+    QTest::newRow("Alternation") << "foo\nbar\nbaz" << QRegExp("baz|foo")
+                           << (MatchList() << Match(0, 0, 3) << Match(2, 0, 3));
+    QTest::newRow("Case insensitive") << "xfoo\nbar\nFoO" << QRegExp("FOO", Qt::CaseInsensitive)
+                           << (MatchList() << Match(0, 1, 4) << Match(2, 0, 3));
+    QTest::newRow("Literal in later lines (Windows style)") << "foo\r\n\r\nbar\r\n\r\nxbar" << QRegExp("bar")
+                           << (MatchList() << Match(2, 0, 3) << Match(4, 1, 4));
+    QTest::newRow("Hexadecimal character code") << "x41\nAx\nxA" << QRegExp("\\x41x")
+                           << (MatchList() << Match(1, 0, 2));
+    QTest::newRow("Octal character code") << "0101\nA" << QRegExp("\\0101")
+                           << (MatchList() << Match(1, 0, 1));
+    QTest::newRow("Word boundaries") << "foobar\nbar foo()\nfoo" << QRegExp("\\bfoo\\b")
+                           << (MatchList() << Match(1, 4, 7) << Match(2, 0, 3));
 }
 
 void FindReplaceTest::testFind()
@@ -95,6 +109,62 @@ void FindReplaceTest::testFind()
 }
 
 
+void FindReplaceTest::testFindFiles_data()
+{
+    QTest::addColumn<int>("depth");
+    QTest::addColumn<QString>("include");
+    QTest::addColumn<QString>("exclude");
+    QTest::addColumn<QStringList>("files");
+
+    QTest::newRow("Recursive") << -1 << "*" << ""
+        << QStringList{QStringLiteral("a.cpp"), QStringLiteral("a.h"), QStringLiteral("build/b.cpp"),
+                       QStringLiteral("src/c.cpp"), QStringLiteral("src/sub/d.cpp"), QStringLiteral("src2/e.cpp")};
+    QTest::newRow("No recursion") << 0 << "*" << ""
+        << QStringList{QStringLiteral("a.cpp"), QStringLiteral("a.h")};
+    QTest::newRow("One level") << 1 << "*" << ""
+        << QStringList{QStringLiteral("a.cpp"), QStringLiteral("a.h"), QStringLiteral("build/b.cpp"),
+                       QStringLiteral("src/c.cpp"), QStringLiteral("src2/e.cpp")};
+    QTest::newRow("Include") << -1 << "*.h, *.txt" << ""
+        << QStringList{QStringLiteral("a.h")};
+    QTest::newRow("Exclude directory") << -1 << "*.cpp" << "/build/ /sub/"
+        << QStringList{QStringLiteral("a.cpp"), QStringLiteral("src/c.cpp"), QStringLiteral("src2/e.cpp")};
+    QTest::newRow("Exclude file") << -1 << "*" << "c.cpp,.h"
+        << QStringList{QStringLiteral("a.cpp"), QStringLiteral("build/b.cpp"),
+                       QStringLiteral("src/sub/d.cpp"), QStringLiteral("src2/e.cpp")};
+}
+
+void FindReplaceTest::testFindFiles()
+{
+    QFETCH(int, depth);
+    QFETCH(QString, include);
+    QFETCH(QString, exclude);
+    QFETCH(QStringList, files);
+
+    QTemporaryDir tempDir;
+    QDir dir(tempDir.path());
+    const QStringList allFiles = {
+        QStringLiteral("a.cpp"), QStringLiteral("a.h"), QStringLiteral("build/b.cpp"), QStringLiteral("src/c.cpp"),
+        QStringLiteral("src/sub/d.cpp"), QStringLiteral("src2/e.cpp"), QStringLiteral(".hidden/f.cpp")
+    };
+    for (const QString& fileName : allFiles) {
+        QVERIFY(dir.mkpath(QFileInfo(fileName).path()));
+        QFile file(dir.filePath(fileName));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+
+    GrepFindFilesThread thread(nullptr, {QUrl::fromLocalFile(dir.path())}, depth, include, exclude, false);
+    thread.start();
+    QVERIFY(thread.wait());
+
+    QStringList found;
+    const QString root = QFileInfo(dir.path()).canonicalFilePath() + QLatin1Char('/');
+    foreach (const QUrl& url, thread.files()) {
+        QVERIFY(url.toLocalFile().startsWith(root));
+        found << url.toLocalFile().mid(root.length());
+    }
+    QCOMPARE(found, files);
+}
+
 void FindReplaceTest::testReplace_data()
 {
     QTest::addColumn<FileList>("subject");
@@ -51,6 +51,9 @@ private Q_SLOTS:
     void testFind();
     void testFind_data();
 
+    void testFindFiles();
+    void testFindFiles_data();
+
     void testReplace();
     void testReplace_data();
 };
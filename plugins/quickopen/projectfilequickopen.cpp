@@ -222,7 +222,7 @@ void BaseFileDataProvider::setFilterText(const QString& text)
 
 uint BaseFileDataProvider::itemCount() const
 {
-    return filteredItems().count();
+    return filteredItemCount();
 }
 
 uint BaseFileDataProvider::unfilteredItemCount() const
@@ -232,7 +232,7 @@ uint BaseFileDataProvider::unfilteredItemCount() const
 
 QuickOpenDataPointer BaseFileDataProvider::data(uint row) const
 {
-    return QuickOpenDataPointer(new ProjectFileData(filteredItems().at(row)));
+    return QuickOpenDataPointer(new ProjectFileData(filteredItem(row)));
 }
 
 ProjectFileDataProvider::ProjectFileDataProvider()
@@ -280,6 +280,7 @@ void ProjectFileDataProvider::fileAddedToSet(ProjectFileItem* file)
     f.path = file->path();
     f.indexedPath = file->indexedPath();
     f.outsideOfProject = !f.projectPath.isParentOf(f.path);
+    f.signature = PathFilter::itemSignature(f);
     auto it = std::lower_bound(m_projectFiles.begin(), m_projectFiles.end(), f);
     if (it == m_projectFiles.end() || it->path != f.path) {
         m_projectFiles.insert(it, f);
@@ -351,6 +352,7 @@ void OpenFilesDataProvider::reset()
     for (IDocument* doc : docs) {
         ProjectFile f;
         f.path = Path(doc->url());
+        f.signature = PathFilter::itemSignature(f);
         IProject* project = projCtrl->findProjectForUrl(doc->url());
         if (project) {
             f.projectPath = project->path();
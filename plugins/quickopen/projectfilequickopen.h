@@ -46,6 +46,8 @@ struct ProjectFile
     // true for files which reside outside of the project root
     // this happens e.g. for generated files in out-of-source build folders
     bool outsideOfProject = false;
+    // characters of the path, see KDevelop::FilterIndex
+    quint64 signature = 0;
 };
 
 inline bool operator<(const ProjectFile& left, const ProjectFile& right)
@@ -108,6 +110,14 @@ public:
     {
         return data.projectPath;
     }
+
+    inline quint64 itemSignature(const ProjectFile& data) const
+    {
+        if (data.signature) {
+            return data.signature;
+        }
+        return PathFilter::itemSignature(data);
+    }
 };
 
 /**
@@ -48,6 +48,9 @@ void BenchQuickOpen::getData()
     QTest::newRow("0500-1__") << 500  << "1";
     QTest::newRow("0100-f/b") << 100  << "f/b";
     QTest::newRow("0500-f/b") << 500  << "f/b";
+    QTest::newRow("5000-bar") << 5000 << "bar";
+    QTest::newRow("5000-1__") << 5000 << "1";
+    QTest::newRow("5000-f/b") << 5000 << "f/b";
 }
 
 void BenchQuickOpen::benchProjectFileFilter_addRemoveProject()
@@ -111,6 +114,71 @@ void BenchQuickOpen::benchProjectFileFilter_setFilter_data()
     getData();
 }
 
+void BenchQuickOpen::benchProjectFileFilter_typeFilter()
+{
+    QFETCH(int, files);
+    QFETCH(QString, filter);
+
+    ProjectFileDataProvider provider;
+    TestProject* project = getProjectWithFiles(files);
+
+    projectController->addProject(project);
+
+    provider.reset();
+
+    // the first keystrokes filter the whole data, the following ones refine the previous result
+    QBENCHMARK {
+        for (int i = 1; i <= filter.size(); ++i) {
+            provider.setFilterText(filter.left(i));
+        }
+        provider.setFilterText(QString());
+    }
+}
+
+void BenchQuickOpen::benchProjectFileFilter_typeFilter_data()
+{
+    getData();
+}
+
+void BenchQuickOpen::benchPathFilter_keystroke()
+{
+    QFETCH(int, files);
+    QFETCH(QString, filter);
+
+    QVector<QString> items;
+    items.reserve(files);
+    for (int i = 0; i < files; ++i) {
+        items << QStringLiteral("/home/user/project/dir%1/sub%2/file%3.cpp").arg(i % 100).arg(i % 1000).arg(i);
+    }
+
+    PathTestFilter pathFilter;
+    pathFilter.setItems(items);
+
+    // a single keystroke filtering all items, including the access of the first row
+    const QStringList text = filter.split(QLatin1Char('/'), QString::SkipEmptyParts);
+    QBENCHMARK {
+        pathFilter.setFilter(text);
+        if (pathFilter.filteredItemCount()) {
+            pathFilter.filteredItem(0);
+        }
+        pathFilter.clearFilter();
+    }
+}
+
+void BenchQuickOpen::benchPathFilter_keystroke_data()
+{
+    QTest::addColumn<int>("files");
+    QTest::addColumn<QString>("filter");
+
+    for (int files : {100000, 400000, 1000000}) {
+        const QByteArray size = QByteArray::number(files / 1000) + "k-";
+        QTest::newRow((size + "f").constData()) << files << "f";
+        QTest::newRow((size + "file12").constData()) << files << "file12";
+        QTest::newRow((size + "d/s/f").constData()) << files << "d/s/f";
+        QTest::newRow((size + "sub99/1").constData()) << files << "sub99/1";
+    }
+}
+
 void BenchQuickOpen::benchProjectFileFilter_providerData()
 {
     QFETCH(int, files);
@@ -38,6 +38,10 @@ private Q_SLOTS:
     void benchProjectFileFilter_reset_data();
     void benchProjectFileFilter_setFilter();
     void benchProjectFileFilter_setFilter_data();
+    void benchProjectFileFilter_typeFilter();
+    void benchProjectFileFilter_typeFilter_data();
+    void benchPathFilter_keystroke();
+    void benchPathFilter_keystroke_data();
     void benchProjectFileFilter_providerData();
     void benchProjectFileFilter_providerData_data();
     void benchProjectFileFilter_providerDataIcon();
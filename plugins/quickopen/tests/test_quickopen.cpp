@@ -25,6 +25,8 @@
 #include <QTest>
 #include <QTemporaryFile>
 
+#include <algorithm>
+
 QTEST_MAIN(TestQuickOpen)
 
 using namespace KDevelop;
@@ -119,6 +121,61 @@ void TestQuickOpen::testAbbreviations_data()
     QTest::newRow("path_segment_multi_mixed") << items << "ftfoo.h" << StringList({ items.at(2) });
 }
 
+void TestQuickOpen::testIncrementalFilter()
+{
+    const StringList items = {
+        QStringLiteral("/foo/bar/caz/a.h"),
+        QStringLiteral("/KateThing/CMakeLists.txt"),
+        QStringLiteral("/FooBar/FooBar/Footestfoo.h"),
+        QStringLiteral("/project/src/\u017Ftream.cpp") };
+
+    // typing and deleting must give the same result as filtering from scratch
+    const QStringList filters = {
+        QStringLiteral("c"), QStringLiteral("cm"), QStringLiteral("cma"), QStringLiteral("cm"),
+        QStringLiteral("cm/l"), QStringLiteral("f"), QStringLiteral("fo"), QStringLiteral("foo.h"),
+        QStringLiteral("st"), QStringLiteral("str"), QStringLiteral("q"), QString(), QStringLiteral("a") };
+
+    PathTestFilter incrementalFilter;
+    incrementalFilter.setItems(items);
+    for (const QString& filter : filters) {
+        const QStringList text = filter.split('/', QString::SkipEmptyParts);
+        incrementalFilter.setFilter(text);
+
+        PathTestFilter filterItems;
+        filterItems.setItems(items);
+        filterItems.setFilter(text);
+        QCOMPARE(incrementalFilter.filteredItems(), filterItems.filteredItems());
+    }
+
+    // non-ASCII characters can match ASCII ones when ignoring case
+    incrementalFilter.setFilter({ QStringLiteral("str") });
+    QCOMPARE(incrementalFilter.filteredItems(), StringList({ items.at(3) }));
+}
+
+void TestQuickOpen::testLazySorting()
+{
+    // more matches than are sorted at once, with two different qualities
+    StringList items;
+    for (int i = 1500; i > 0; --i) {
+        items << QStringLiteral("/home/user/project/src/%1foo%2.h").arg(i % 7 ? QString() : QStringLiteral("x")).arg(i);
+    }
+    StringList sorted = items;
+    std::stable_partition(sorted.begin(), sorted.end(), [](const QString& item) {
+        return !item.contains(QLatin1String("xfoo"));
+    });
+
+    PathTestFilter filterItems;
+    filterItems.setItems(items);
+    filterItems.setFilter({ QStringLiteral("foo") });
+    QCOMPARE(filterItems.filteredItemCount(), items.size());
+    StringList lazy;
+    for (int i = 0; i < filterItems.filteredItemCount(); ++i) {
+        lazy << filterItems.filteredItem(i);
+    }
+    QCOMPARE(lazy, sorted);
+    QCOMPARE(filterItems.filteredItems(), sorted);
+}
+
 void TestQuickOpen::testSorting()
 {
     QFETCH(StringList, items);
@@ -35,6 +35,8 @@ private Q_SLOTS:
     void testStableSort();
     void testAbbreviations();
     void testAbbreviations_data();
+    void testIncrementalFilter();
+    void testLazySorting();
     void testDuchainFilter();
     void testDuchainFilter_data();
 